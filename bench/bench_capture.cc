@@ -0,0 +1,155 @@
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+
+#include <gabs/alloc/std.hh>
+
+#include <rlc/rlc.h>
+#include <rlc/capture.h>
+
+#include "loopback.hh"
+
+inline gabs::memory::allocator alloc;
+
+namespace
+{
+
+::rlc_config am_config()
+{
+        ::rlc_config conf = {};
+
+        conf.type = ::RLC_AM;
+        conf.window_size = 4096;
+        conf.pdu_without_poll_max = 16;
+        conf.byte_without_poll_max = 16000;
+        conf.time_reassembly_us = 2000;
+        conf.time_poll_retransmit_us = 5000;
+        conf.time_status_prohibit_us = 1000;
+        conf.max_retx_threshhold = 16;
+        conf.sn_width = ::RLC_SN_18BIT;
+
+        return conf;
+}
+
+int write_vector(void *arg, const void *data, std::size_t size)
+{
+        auto out = static_cast<std::vector<std::uint8_t> *>(arg);
+        auto bytes = static_cast<const std::uint8_t *>(data);
+
+        out->insert(out->end(), bytes, bytes + size);
+        return 0;
+}
+
+template <class T> T read_at(const std::vector<std::uint8_t> &data, size_t at)
+{
+        T value;
+
+        std::memcpy(&value, data.data() + at, sizeof(value));
+        return value;
+}
+
+}; // namespace
+
+TEST_CASE("PDU capture to pcap", "[capture]")
+{
+        const std::size_t snaplen = 64;
+        ::rlc_capture cap;
+
+        REQUIRE(::rlc_capture_init(&cap, alloc, 4096, snaplen, false) == 0);
+
+        {
+                bench::loopback link(alloc, am_config(), 0.05, 1234);
+
+                ::rlc_capture_attach(link.context(0), &cap, 0);
+                ::rlc_capture_attach(link.context(1), &cap, 1);
+
+                for (auto i = 0; i < 500; i++) {
+                        link.send(1000);
+                        link.pump(1500);
+                }
+
+                REQUIRE(link.run(1500, std::chrono::seconds(10)));
+
+                /* Flush status PDUs still in flight */
+                while (link.pump(1500)) {
+                }
+
+                ::rlc_capture_attach(link.context(0), nullptr, 0);
+                ::rlc_capture_attach(link.context(1), nullptr, 0);
+
+                std::vector<std::uint8_t> out;
+
+                REQUIRE(::rlc_capture_pcap_header(&cap, write_vector, &out) ==
+                        0);
+                auto count = ::rlc_capture_drain_pcap(&cap, write_vector, &out);
+
+                auto stats = link.get_stats();
+
+                /* Every PDU is captured when sent, and again when received
+                 * unless it was lost */
+                REQUIRE(cap.dropped == 0);
+                REQUIRE(count == static_cast<std::ptrdiff_t>(
+                                         2 * stats.pdus_sent -
+                                         stats.pdus_lost));
+
+                REQUIRE(read_at<std::uint32_t>(out, 0) == 0xa1b2c3d4);
+
+                std::size_t at = 24;
+                for (auto i = 0; i < count; i++) {
+                        auto incl_len = read_at<std::uint32_t>(out, at + 8);
+                        auto packet = at + 16;
+
+                        REQUIRE(incl_len <= 43 + snaplen);
+                        REQUIRE(std::memcmp(out.data() + packet + 28, "rlc-nr",
+                                            6) == 0);
+
+                        at = packet + incl_len;
+                }
+
+                REQUIRE(at == out.size());
+
+                std::printf("captured %td PDUs into %zu bytes of pcap\n",
+                            count, out.size());
+        }
+
+        ::rlc_capture_deinit(&cap);
+}
+
+TEST_CASE("PDU capture overhead", "[capture][!benchmark]")
+{
+        auto capture = GENERATE(false, true);
+        ::rlc_capture cap;
+
+        REQUIRE(::rlc_capture_init(&cap, alloc, 1 << 16, 64, false) == 0);
+
+        bench::loopback link(alloc, am_config(), 0, 1234);
+
+        if (capture) {
+                ::rlc_capture_attach(link.context(0), &cap, 0);
+                ::rlc_capture_attach(link.context(1), &cap, 1);
+        }
+
+        BENCHMARK(capture ? "200 SDUs, capturing" : "200 SDUs")
+        {
+                for (auto i = 0; i < 200; i++) {
+                        link.send(1000);
+                        link.pump(1500);
+                }
+
+                REQUIRE(link.run(1500, std::chrono::seconds(10)));
+
+                /* Keep the ring from filling up between runs */
+                return ::rlc_capture_drain_pcap(
+                        &cap,
+                        [](void *, const void *, std::size_t) { return 0; },
+                        nullptr);
+        };
+
+        ::rlc_capture_attach(link.context(0), nullptr, 0);
+        ::rlc_capture_attach(link.context(1), nullptr, 0);
+
+        ::rlc_capture_deinit(&cap);
+}
@@ -0,0 +1,187 @@
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+#include <catch2/catch_all.hpp>
+
+#include <gabs/alloc/std.hh>
+
+#include <rlc/rlc.h>
+
+#include "channel.hh"
+#include "loopback.hh"
+
+inline gabs::memory::allocator alloc;
+
+namespace
+{
+
+::rlc_config am_config()
+{
+        ::rlc_config conf = {};
+
+        conf.type = ::RLC_AM;
+        conf.window_size = 4096;
+        conf.pdu_without_poll_max = 16;
+        conf.byte_without_poll_max = 16000;
+        conf.time_reassembly_us = 5000;
+        conf.time_poll_retransmit_us = 10000;
+        conf.time_status_prohibit_us = 1000;
+        conf.max_retx_threshhold = 16;
+        conf.sn_width = ::RLC_SN_18BIT;
+
+        return conf;
+}
+
+struct scenario {
+        const char *name;
+        bench::channel_config link;
+};
+
+/* Whether @p value is within @p rel of @p expected */
+bool near(double value, double expected, double rel)
+{
+        return std::abs(value - expected) <= rel * expected;
+}
+
+bench::channel_config with_delay(bench::channel_config link)
+{
+        link.delay = std::chrono::milliseconds(2);
+        return link;
+}
+
+}; // namespace
+
+TEST_CASE("Channel model", "[channel]")
+{
+        const int pdus = 200000;
+
+        bench::channel_config link;
+        link.loss = 0.01;
+        link.burst_loss = 0.5;
+        link.enter_burst = 0.01;
+        link.leave_burst = 0.2;
+        link.duplicate = 0.05;
+        link.reorder = 0.1;
+        link.reorder_delay = std::chrono::milliseconds(3);
+        link.delay = std::chrono::milliseconds(2);
+        link.jitter = std::chrono::microseconds(500);
+
+        bench::channel a(link, 42);
+        bench::channel b(link, 42);
+
+        int lost = 0;
+        int duplicated = 0;
+        int reordered = 0;
+        int bursts = 0;
+        int burst_pdus = 0;
+        bool in_burst = false;
+
+        for (int i = 0; i < pdus; i++) {
+                auto x = a.next();
+                auto y = b.next();
+
+                /* Same seed, same fates */
+                REQUIRE(x.lost == y.lost);
+                REQUIRE(x.copies == y.copies);
+                REQUIRE(x.delay[0] == y.delay[0]);
+
+                if (a.in_burst()) {
+                        burst_pdus++;
+                        bursts += in_burst ? 0 : 1;
+                }
+
+                in_burst = a.in_burst();
+
+                if (x.lost) {
+                        lost++;
+                        continue;
+                }
+
+                duplicated += x.copies - 1;
+
+                REQUIRE(x.delay[0] >= link.delay);
+                REQUIRE(x.delay[0] <=
+                        link.delay + link.jitter + link.reorder_delay);
+
+                reordered += x.delay[0] > link.delay + link.jitter;
+        }
+
+        auto loss_rate = static_cast<double>(lost) / pdus;
+        auto delivered = pdus - lost;
+
+        REQUIRE(near(loss_rate, link.mean_loss(), 0.1));
+        REQUIRE(near(static_cast<double>(burst_pdus) / bursts,
+                     1 / link.leave_burst, 0.1));
+        REQUIRE(near(static_cast<double>(duplicated) / delivered,
+                     link.duplicate, 0.1));
+        REQUIRE(near(static_cast<double>(reordered) / delivered, link.reorder,
+                     0.1));
+
+        /* A different seed gives a different sequence */
+        bench::channel c(link, 43);
+        int differ = 0;
+
+        for (int i = 0; i < 1000; i++) {
+                differ += a.next().delay[0] != c.next().delay[0];
+        }
+
+        REQUIRE(differ > 0);
+}
+
+/* Figures of merit of AM under a set of reproducible channel conditions. Run
+ * before and after a change to the ARQ to compare them. */
+TEST_CASE("AM across channel scenarios", "[channel]")
+{
+        bench::channel_config bursty;
+        bursty.burst_loss = 0.5;
+        bursty.enter_burst = 0.005;
+        bursty.leave_burst = 0.2;
+
+        bench::channel_config duplicating;
+        duplicating.duplicate = 0.05;
+
+        bench::channel_config reordering;
+        reordering.reorder = 0.05;
+        reordering.reorder_delay = std::chrono::milliseconds(3);
+
+        bench::channel_config jittery;
+        jittery.loss = 0.01;
+        jittery.jitter = std::chrono::milliseconds(1);
+
+        auto test = GENERATE_COPY(
+                scenario{"lossless", with_delay({})},
+                scenario{"1% loss", with_delay({0.01})},
+                scenario{"5% loss", with_delay({0.05})},
+                scenario{"bursty loss", with_delay(bursty)},
+                scenario{"duplication", with_delay(duplicating)},
+                scenario{"reordering", with_delay(reordering)},
+                scenario{"1% loss, jitter", with_delay(jittery)});
+
+        bench::loopback link(alloc, am_config(), test.link, 1234);
+
+        for (auto i = 0; i < 2000; i++) {
+                link.send(1000);
+                link.pump(1500);
+        }
+
+        REQUIRE(link.run(1500, std::chrono::seconds(20)));
+
+        auto stats = link.get_stats();
+        auto summary = bench::summarize(stats);
+
+        REQUIRE(stats.sdus_delivered == stats.sdus_sent);
+        REQUIRE(summary.retx_ratio >= 0);
+
+        if (test.link.mean_loss() == 0) {
+                REQUIRE(stats.pdus_lost == 0);
+        }
+
+        std::printf("%-16s: mean loss %4.1f%%, goodput %6.2f Mbit/s, "
+                    "retx %6.4f, status %6.4f, p50 %8.1f us, p99 %8.1f us\n",
+                    test.name, test.link.mean_loss() * 100,
+                    summary.goodput_mbps, summary.retx_ratio,
+                    summary.status_ratio, summary.latency_p50_us,
+                    summary.latency_p99_us);
+}
@@ -0,0 +1,498 @@
+
+/*
+ * Microbenchmarks of the PDU header and status codecs.
+ *
+ * Every combination of function, RLC mode, SN width and PDU shape is timed
+ * over batches of prepared buffers, so that allocating and filling the
+ * buffers is kept out of the measurement. Decoders are run on both
+ * contiguous buffers and chains where the header is split across links.
+ *
+ * Usage: bench_codec [--filter SUBSTR] [--min-time MS] [--out FILE]
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gabs/alloc/std.hh>
+
+#include <rlc/rlc.h>
+
+#include "encode.h"
+#include "micro.hh"
+
+namespace
+{
+
+using bench::micro::sink;
+
+gabs::memory::allocator alloc;
+
+constexpr std::size_t batch_size = 256;
+constexpr std::size_t payload_size = 64;
+
+/* A benchmark case. `setup` prepares a batch outside of the timed region,
+ * and `run` does `batch_size` operations on it. */
+struct codec_case {
+        std::string name;
+        const char *function;
+        const char *mode;
+        unsigned int sn_bits;
+        const char *shape;
+        const char *input;
+
+        std::size_t bytes_per_op;
+        std::function<void()> setup;
+        std::function<void()> run;
+        std::function<void()> teardown;
+};
+
+struct mode_config {
+        const char *name;
+        ::rlc_sn_width width;
+        ::rlc_service_type type;
+        unsigned int sn_bits;
+};
+
+const mode_config modes[] = {
+        {"tm", ::RLC_SN_6BIT, ::RLC_TM, 0},
+        {"um", ::RLC_SN_6BIT, ::RLC_UM, 6},
+        {"um", ::RLC_SN_12BIT, ::RLC_UM, 12},
+        {"am", ::RLC_SN_12BIT, ::RLC_AM, 12},
+        {"am", ::RLC_SN_18BIT, ::RLC_AM, 18},
+};
+
+/* Backend that is never called, the codec only needs the configuration */
+::rlc_errno null_submit(::rlc_context *, ::gabs_pbuf buf)
+{
+        ::gabs_pbuf_decref(buf);
+        return 0;
+}
+
+::rlc_errno null_request(::rlc_context *)
+{
+        return 0;
+}
+
+constexpr ::rlc_backend null_backend = {
+        null_submit,
+        null_request,
+        nullptr,
+};
+
+/* One context per mode, kept alive for the whole run */
+struct mode_context {
+        ::rlc_config conf = {};
+        ::rlc_context ctx;
+};
+
+::rlc_pdu make_pdu(const char *shape, std::uint32_t sn_mask,
+                   std::uint32_t index)
+{
+        ::rlc_pdu pdu = {};
+
+        pdu.sn = (index * 7919) & sn_mask;
+        pdu.size = payload_size;
+
+        if (std::strcmp(shape, "status") == 0) {
+                pdu.flags.is_status = 1;
+                pdu.flags.ext = 1;
+        } else if (std::strcmp(shape, "whole") == 0) {
+                pdu.flags.is_first = 1;
+                pdu.flags.is_last = 1;
+        } else {
+                /* Middle segment, which carries both SN and SO */
+                pdu.seg_offset = (index * 131) & 0x7fff;
+        }
+
+        pdu.flags.polled = index & 1;
+
+        return pdu;
+}
+
+::rlc_pdu_status make_nack(const char *shape, std::uint32_t sn_mask,
+                           std::uint32_t index)
+{
+        ::rlc_pdu_status status = {};
+
+        status.nack_sn = (index * 7919) & sn_mask;
+        status.ext.has_more = 1;
+
+        if (std::strcmp(shape, "so_range") == 0) {
+                status.ext.has_offset = 1;
+                status.ext.has_range = 1;
+                status.offset.start = (index * 131) & 0x7fff;
+                status.offset.end = status.offset.start + 100;
+                status.range = 1 + (index & 0x7f);
+        }
+
+        return status;
+}
+
+/* Put @p data into a buffer, split after the first byte into two links if
+ * @p chained */
+::gabs_pbuf make_input(const std::vector<std::uint8_t> &data, bool chained)
+{
+        ::gabs_pbuf buf;
+        ::gabs_pbuf tail;
+
+        if (!chained) {
+                buf = ::gabs_pbuf_new(alloc, data.size());
+                ::gabs_pbuf_put(&buf, data.data(), data.size());
+
+                return buf;
+        }
+
+        buf = ::gabs_pbuf_new(alloc, 1);
+        ::gabs_pbuf_put(&buf, data.data(), 1);
+
+        tail = ::gabs_pbuf_new(alloc, data.size() - 1);
+        ::gabs_pbuf_put(&tail, data.data() + 1, data.size() - 1);
+
+        ::gabs_pbuf_chain_back(&buf, tail);
+
+        return buf;
+}
+
+std::vector<std::uint8_t> encode_pdu(::rlc_context *ctx,
+                                     const ::rlc_pdu &pdu)
+{
+        std::vector<std::uint8_t> data(RLC_PDU_HEADER_MAX_SIZE);
+
+        data.resize(::rlc_pdu_encode_raw(ctx, &pdu, data.data()));
+
+        if (!pdu.flags.is_status) {
+                data.resize(data.size() + payload_size, 0xa5);
+        }
+
+        return data;
+}
+
+std::vector<std::uint8_t> encode_nack(::rlc_context *ctx,
+                                      const ::rlc_pdu_status &status)
+{
+        std::vector<std::uint8_t> data(RLC_STATUS_MAX_SIZE);
+        ::gabs_pbuf buf;
+
+        buf = ::gabs_pbuf_new(alloc, RLC_STATUS_MAX_SIZE);
+        ::rlc_status_encode(ctx, &status, &buf);
+
+        data.resize(::gabs_pbuf_copy(buf, data.data(), 0, data.size()));
+        ::gabs_pbuf_decref(buf);
+
+        return data;
+}
+
+/* State shared by the closures of a case */
+struct batch {
+        std::vector<::rlc_pdu> pdus;
+        std::vector<::rlc_pdu_status> nacks;
+        std::vector<::gabs_pbuf> bufs;
+        std::vector<::gabs_pbuf> payloads;
+
+        void release()
+        {
+                for (auto buf : bufs) {
+                        ::gabs_pbuf_decref(buf);
+                }
+
+                for (auto buf : payloads) {
+                        ::gabs_pbuf_decref(buf);
+                }
+
+                bufs.clear();
+                payloads.clear();
+        }
+};
+
+void add_pdu_cases(std::vector<codec_case> &cases, ::rlc_context *ctx,
+                   const mode_config &mode, const char *shape)
+{
+        auto sn_mask = (1u << mode.sn_bits) - 1;
+        auto state = std::make_shared<batch>();
+        std::size_t header_size;
+        std::string prefix;
+
+        for (std::uint32_t i = 0; i < batch_size; i++) {
+                state->pdus.push_back(make_pdu(shape, sn_mask, i));
+        }
+
+        header_size = ::rlc_pdu_header_size(ctx, &state->pdus[0]);
+
+        prefix = std::string(mode.name);
+        if (mode.sn_bits != 0) {
+                prefix += std::to_string(mode.sn_bits);
+        }
+
+        prefix += "/";
+        prefix += shape;
+
+        auto add = [&](const char *function, const char *input,
+                       std::function<void()> setup, std::function<void()> run) {
+                cases.push_back(codec_case{
+                        std::string(function) + "/" + prefix + "/" + input,
+                        function,
+                        mode.name,
+                        mode.sn_bits,
+                        shape,
+                        input,
+                        header_size,
+                        std::move(setup),
+                        std::move(run),
+                        [state] { state->release(); },
+                });
+        };
+
+        /* Header into a buffer with room for it */
+        add(
+                "rlc_pdu_encode", "contiguous",
+                [state] {
+                        state->release();
+
+                        for (std::size_t i = 0; i < batch_size; i++) {
+                                state->bufs.push_back(::gabs_pbuf_new(
+                                        alloc, RLC_PDU_HEADER_MAX_SIZE));
+                        }
+                },
+                [state, ctx] {
+                        for (std::size_t i = 0; i < batch_size; i++) {
+                                ::rlc_pdu_encode(ctx, &state->pdus[i],
+                                                 &state->bufs[i]);
+                        }
+                });
+
+        /* Header into its own buffer, chained in front of the payload as on
+         * the TX path */
+        add(
+                "rlc_pdu_encode", "chained",
+                [state] {
+                        std::vector<std::uint8_t> payload(payload_size, 0xa5);
+
+                        state->release();
+
+                        for (std::size_t i = 0; i < batch_size; i++) {
+                                state->bufs.push_back(::gabs_pbuf_new(
+                                        alloc, RLC_PDU_HEADER_MAX_SIZE));
+                                state->payloads.push_back(
+                                        make_input(payload, false));
+                        }
+                },
+                [state, ctx] {
+                        for (std::size_t i = 0; i < batch_size; i++) {
+                                ::rlc_pdu_encode(ctx, &state->pdus[i],
+                                                 &state->bufs[i]);
+                                ::gabs_pbuf_chain_front(&state->payloads[i],
+                                                        state->bufs[i]);
+                        }
+
+                        /* The headers are now owned by the payloads */
+                        state->bufs.clear();
+                });
+
+        for (auto chained : {false, true}) {
+                add(
+                        "rlc_pdu_decode", chained ? "chained" : "contiguous",
+                        [state, ctx, chained] {
+                                state->release();
+
+                                for (auto &pdu : state->pdus) {
+                                        state->bufs.push_back(make_input(
+                                                encode_pdu(ctx, pdu),
+                                                chained));
+                                }
+                        },
+                        [state, ctx] {
+                                ::rlc_pdu pdu;
+                                std::size_t sum = 0;
+
+                                for (std::size_t i = 0; i < batch_size; i++) {
+                                        (void)::rlc_pdu_decode(ctx, &pdu,
+                                                               &state->bufs[i]);
+                                        sum += pdu.sn;
+                                }
+
+                                sink = sum;
+                        });
+        }
+
+        add(
+                "rlc_pdu_header_size", "none", [] {},
+                [state, ctx] {
+                        std::size_t sum = 0;
+
+                        for (std::size_t i = 0; i < batch_size; i++) {
+                                sum += ::rlc_pdu_header_size(ctx,
+                                                             &state->pdus[i]);
+                        }
+
+                        sink = sum;
+                });
+}
+
+void add_status_cases(std::vector<codec_case> &cases, ::rlc_context *ctx,
+                      const mode_config &mode, const char *shape)
+{
+        auto sn_mask = (1u << mode.sn_bits) - 1;
+        auto state = std::make_shared<batch>();
+        std::string suffix;
+        std::size_t size;
+
+        for (std::uint32_t i = 0; i < batch_size; i++) {
+                state->nacks.push_back(make_nack(shape, sn_mask, i));
+        }
+
+        size = ::rlc_status_size(ctx, &state->nacks[0]);
+        suffix = std::string(mode.name) + std::to_string(mode.sn_bits) + "/" +
+                 shape;
+
+        auto add = [&](const char *function, const char *input,
+                       std::function<void()> setup, std::function<void()> run) {
+                cases.push_back(codec_case{
+                        std::string(function) + "/" + suffix + "/" + input,
+                        function,
+                        mode.name,
+                        mode.sn_bits,
+                        shape,
+                        input,
+                        size,
+                        std::move(setup),
+                        std::move(run),
+                        [state] { state->release(); },
+                });
+        };
+
+        add(
+                "rlc_status_encode", "contiguous",
+                [state] {
+                        state->release();
+
+                        for (std::size_t i = 0; i < batch_size; i++) {
+                                state->bufs.push_back(::gabs_pbuf_new(
+                                        alloc, RLC_STATUS_MAX_SIZE));
+                        }
+                },
+                [state, ctx] {
+                        for (std::size_t i = 0; i < batch_size; i++) {
+                                ::rlc_status_encode(ctx, &state->nacks[i],
+                                                    &state->bufs[i]);
+                        }
+                });
+
+        for (auto chained : {false, true}) {
+                add(
+                        "rlc_status_decode", chained ? "chained" : "contiguous",
+                        [state, ctx, chained] {
+                                state->release();
+
+                                for (auto &nack : state->nacks) {
+                                        state->bufs.push_back(make_input(
+                                                encode_nack(ctx, nack),
+                                                chained));
+                                }
+                        },
+                        [state, ctx] {
+                                ::rlc_pdu_status status;
+                                std::size_t sum = 0;
+
+                                for (std::size_t i = 0; i < batch_size; i++) {
+                                        (void)::rlc_status_decode(
+                                                ctx, &status, &state->bufs[i]);
+                                        sum += status.nack_sn;
+                                }
+
+                                sink = sum;
+                        });
+        }
+}
+
+bench::micro::result measure(codec_case &c, const bench::micro::options &opts)
+{
+        bench::micro::result r;
+
+        r.name = c.name;
+        r.labels = {
+                {"function", c.function},
+                {"mode", c.mode},
+                {"shape", c.shape},
+                {"input", c.input},
+        };
+
+        r.time = bench::micro::measure(c.setup, c.run, batch_size,
+                                       opts.min_time);
+        c.teardown();
+
+        r.metrics = {
+                {"sn_bits", c.sn_bits},
+                {"bytes_per_op", c.bytes_per_op},
+                {"bytes_per_second", c.bytes_per_op * (1e9 / r.time.ns_per_op)},
+        };
+
+        return r;
+}
+
+}; // namespace
+
+int main(int argc, char **argv)
+{
+        bench::micro::options opts;
+        std::vector<codec_case> cases;
+        std::vector<bench::micro::result> results;
+        std::vector<mode_context> contexts(std::size(modes));
+
+        if (!bench::micro::parse_options(argc, argv, opts)) {
+                return 2;
+        }
+
+        for (std::size_t i = 0; i < std::size(modes); i++) {
+                auto &mode = modes[i];
+                auto &mc = contexts[i];
+
+                mc.conf.type = mode.type;
+                mc.conf.sn_width = mode.width;
+
+                if (::rlc_init(&mc.ctx, &null_backend, alloc, alloc) != 0) {
+                        std::fprintf(stderr, "Context init failed\n");
+                        return 1;
+                }
+
+                ::rlc_set_config(&mc.ctx, &mc.conf);
+
+                if (mode.type == ::RLC_TM) {
+                        add_pdu_cases(cases, &mc.ctx, mode, "whole");
+                        continue;
+                }
+
+                add_pdu_cases(cases, &mc.ctx, mode, "whole");
+                add_pdu_cases(cases, &mc.ctx, mode, "segment");
+
+                if (mode.type == ::RLC_AM) {
+                        add_pdu_cases(cases, &mc.ctx, mode, "status");
+                        add_status_cases(cases, &mc.ctx, mode, "nack");
+                        add_status_cases(cases, &mc.ctx, mode, "so_range");
+                }
+        }
+
+        for (auto &c : cases) {
+                if (!opts.selected(c.name)) {
+                        continue;
+                }
+
+                results.push_back(measure(c, opts));
+
+                auto &r = results.back();
+                std::fprintf(stderr, "%-48s %8.2f ns/op %10.1f MB/s\n",
+                             r.name.c_str(), r.time.ns_per_op,
+                             c.bytes_per_op * (1e3 / r.time.ns_per_op));
+        }
+
+        for (auto &mc : contexts) {
+                (void)::rlc_deinit(&mc.ctx);
+        }
+
+        return bench::micro::finish(results, opts,
+                                    {{"batch_size", batch_size}});
+}
@@ -0,0 +1,160 @@
+
+#include <cstdio>
+#include <cinttypes>
+
+#include <catch2/catch_all.hpp>
+
+#include <gabs/alloc/std.hh>
+
+#include <rlc/rlc.h>
+#include <rlc/latency.h>
+
+#include "loopback.hh"
+
+inline gabs::memory::allocator alloc;
+
+namespace
+{
+
+::rlc_config am_config()
+{
+        ::rlc_config conf = {};
+
+        conf.type = ::RLC_AM;
+        conf.window_size = 4096;
+        conf.pdu_without_poll_max = 16;
+        conf.byte_without_poll_max = 16000;
+        conf.time_reassembly_us = 2000;
+        conf.time_poll_retransmit_us = 5000;
+        conf.time_status_prohibit_us = 1000;
+        conf.max_retx_threshhold = 16;
+        conf.sn_width = ::RLC_SN_18BIT;
+
+        return conf;
+}
+
+void print_hist(const char *name, const ::rlc_hist &hist)
+{
+        std::printf("%-10s: %5" PRIu64 " SDUs, mean %8.1f us, p50 %7" PRIu32
+                    " us, p99 %7" PRIu32 " us, max %7" PRIu32 " us\n",
+                    name, hist.count,
+                    hist.count == 0 ? 0.0
+                                    : static_cast<double>(hist.sum_us) /
+                                              hist.count,
+                    ::rlc_hist_value_at(&hist, 0.5),
+                    ::rlc_hist_value_at(&hist, 0.99), hist.max_us);
+}
+
+}; // namespace
+
+TEST_CASE("Latency histogram buckets", "[latency]")
+{
+        ::rlc_hist hist = {};
+
+        for (std::uint64_t value = 0; value < (1ull << 33);
+             value = value * 17 / 16 + 1) {
+                auto index = ::rlc_hist_bucket(value);
+                auto clamped = std::min<std::uint64_t>(value, UINT32_MAX);
+
+                REQUIRE(index < RLC_HIST_BUCKETS);
+                REQUIRE(::rlc_hist_bucket_start(index) <= clamped);
+
+                if (index + 1 < RLC_HIST_BUCKETS) {
+                        REQUIRE(clamped < ::rlc_hist_bucket_start(index + 1));
+                }
+
+                /* Bounded relative error */
+                REQUIRE(clamped - ::rlc_hist_bucket_start(index) <=
+                        clamped / RLC_HIST_SUB_COUNT);
+        }
+
+        REQUIRE(::rlc_hist_value_at(&hist, 0.5) == 0);
+
+        for (std::uint32_t value = 1; value <= 1000; value++) {
+                ::rlc_hist_add(&hist, value);
+        }
+
+        REQUIRE(hist.count == 1000);
+        REQUIRE(hist.min_us == 1);
+        REQUIRE(hist.max_us == 1000);
+        REQUIRE(hist.sum_us == 500500);
+
+        auto p50 = ::rlc_hist_value_at(&hist, 0.5);
+        REQUIRE(p50 >= 500);
+        REQUIRE(p50 <= 500 + 500 / RLC_HIST_SUB_COUNT);
+        REQUIRE(::rlc_hist_value_at(&hist, 1.0) == 1000);
+        REQUIRE(::rlc_hist_value_at(&hist, 0.0) == 1);
+
+        ::rlc_hist_reset(&hist);
+        REQUIRE(hist.count == 0);
+}
+
+TEST_CASE("SDU latency histograms under loss", "[latency]")
+{
+        const std::size_t sdus = 1000;
+        ::rlc_latency tx_lat;
+        ::rlc_latency rx_lat;
+        ::rlc_latency snap;
+
+        bench::loopback link(alloc, am_config(), 0.05, 1234);
+        link.set_delay(std::chrono::milliseconds(2));
+
+        ::rlc_latency_attach(link.context(0), &tx_lat);
+        ::rlc_latency_attach(link.context(1), &rx_lat);
+
+        for (std::size_t i = 0; i < sdus; i++) {
+                link.send(1000);
+                link.pump(1500);
+        }
+
+        REQUIRE(link.run(1500, std::chrono::seconds(10)));
+
+        /* Let the last status PDUs through */
+        auto deadline = bench::clock::now() + std::chrono::milliseconds(50);
+        while (bench::clock::now() < deadline) {
+                link.pump(1500);
+        }
+
+        ::rlc_latency_snapshot(link.context(0), &snap, true);
+
+        auto &queue = snap.hist[::RLC_LATENCY_TX_QUEUE];
+        auto &ack = snap.hist[::RLC_LATENCY_TX_ACK];
+
+        REQUIRE(queue.count == sdus);
+        REQUIRE(ack.count == sdus);
+
+        /* Acknowledgement takes at least a round trip */
+        REQUIRE(ack.min_us >= 4000);
+        REQUIRE(::rlc_hist_value_at(&ack, 0.5) <=
+                ::rlc_hist_value_at(&ack, 0.99));
+
+        print_hist("TX queue", queue);
+        print_hist("TX ACK", ack);
+
+        ::rlc_latency_snapshot(link.context(1), &snap, false);
+
+        auto &deliver = snap.hist[::RLC_LATENCY_RX_DELIVER];
+        auto &hold = snap.hist[::RLC_LATENCY_RX_HOLD];
+
+        REQUIRE(deliver.count == sdus);
+        REQUIRE(hold.count == sdus);
+
+        /* Lost PDUs hold back the SDUs behind them */
+        REQUIRE(hold.max_us > 0);
+        REQUIRE(deliver.sum_us >= hold.sum_us);
+
+        print_hist("RX deliver", deliver);
+        print_hist("RX hold", hold);
+
+        /* Reset only when asked to */
+        ::rlc_latency_snapshot(link.context(1), &snap, false);
+        REQUIRE(snap.hist[::RLC_LATENCY_RX_DELIVER].count == sdus);
+        ::rlc_latency_snapshot(link.context(0), &snap, false);
+        REQUIRE(snap.hist[::RLC_LATENCY_TX_ACK].count == 0);
+
+        ::rlc_latency_attach(link.context(0), nullptr);
+        ::rlc_latency_attach(link.context(1), nullptr);
+
+        ::rlc_latency_snapshot(link.context(1), &snap, false);
+        REQUIRE(snap.hist[::RLC_LATENCY_RX_DELIVER].count == 0);
+}
@@ -0,0 +1,121 @@
+
+#include <memory>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+
+#include <gabs/pbuf.h>
+#include <gabs/alloc/std.hh>
+
+#include <rlc/rlc.h>
+#include <rlc/lcp.h>
+
+inline gabs::memory::allocator alloc;
+
+namespace
+{
+
+::rlc_errno discard_submit(::rlc_context *, ::gabs_pbuf buf)
+{
+        ::gabs_pbuf_decref(buf);
+        return 0;
+}
+
+const ::rlc_backend discard_backend = {
+        .tx_submit = discard_submit,
+        .tx_request = nullptr,
+        .tx_submit_handle = nullptr,
+};
+
+::rlc_config um_config()
+{
+        ::rlc_config conf = {};
+
+        conf.type = ::RLC_UM;
+        conf.window_size = 2048;
+        conf.time_reassembly_us = 500000;
+        conf.sn_width = ::RLC_SN_12BIT;
+
+        return conf;
+}
+
+const ::rlc_config conf = um_config();
+
+struct channel {
+        ::rlc_context ctx;
+        ::rlc_lcp_channel lcp;
+
+        channel(unsigned int priority)
+        {
+                auto status = ::rlc_init(&ctx, &discard_backend, alloc, alloc);
+                REQUIRE(status == 0);
+
+                ::rlc_set_config(&ctx, &conf);
+                (void)::rlc_reset(&ctx);
+
+                /* 1 Mbit/s with a 50 ms bucket */
+                ::rlc_lcp_channel_init(&lcp, &ctx, priority, 125000, 50000);
+        }
+
+        ~channel()
+        {
+                (void)::rlc_deinit(&ctx);
+        }
+
+        /* Keep at least one SDU queued so every channel competes for every
+         * grant. */
+        void top_up(size_t sdu_size)
+        {
+                struct ::rlc_tx_buffer_status status;
+                ::gabs_pbuf buf;
+
+                ::rlc_tx_buffer_status(&ctx, &status);
+                if (status.new_bytes > 0) {
+                        return;
+                }
+
+                buf = ::gabs_pbuf_new(alloc, sdu_size);
+                REQUIRE(::gabs_pbuf_okay(buf));
+
+                std::vector<std::uint8_t> data(sdu_size, 0xa5);
+                ::gabs_pbuf_put(&buf, data.data(), data.size());
+
+                REQUIRE(::rlc_tx(&ctx, buf, nullptr) == 0);
+                ::gabs_pbuf_decref(buf);
+        }
+};
+
+}; // namespace
+
+TEST_CASE("LCP grant across many channels", "[lcp][!benchmark]")
+{
+        auto num_channels = GENERATE(64, 256, 512);
+        std::vector<std::unique_ptr<channel>> channels;
+        ::rlc_lcp lcp;
+
+        REQUIRE(::rlc_lcp_init(&lcp) == 0);
+
+        for (auto i = 0; i < num_channels; i++) {
+                channels.push_back(std::make_unique<channel>(i % 16));
+                ::rlc_lcp_add(&lcp, &channels.back()->lcp);
+        }
+
+        /* One slot of a 100 Mbit/s link every 500 us */
+        const size_t grant = 6250;
+
+        BENCHMARK("grant, " + std::to_string(num_channels) + " channels")
+        {
+                for (auto &chan : channels) {
+                        chan->top_up(300);
+                }
+
+                ::rlc_lcp_tick(&lcp, 500);
+                return ::rlc_lcp_grant(&lcp, grant);
+        };
+
+        for (auto &chan : channels) {
+                ::rlc_lcp_remove(&lcp, &chan->lcp);
+        }
+
+        (void)::rlc_lcp_deinit(&lcp);
+}
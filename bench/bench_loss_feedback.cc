@@ -0,0 +1,64 @@
+
+#include <cstdio>
+
+#include <catch2/catch_all.hpp>
+
+#include <gabs/alloc/std.hh>
+
+#include <rlc/rlc.h>
+
+#include "loopback.hh"
+
+inline gabs::memory::allocator alloc;
+
+namespace
+{
+
+::rlc_config am_config()
+{
+        ::rlc_config conf = {};
+
+        conf.type = ::RLC_AM;
+        conf.window_size = 4096;
+        conf.pdu_without_poll_max = 16;
+        conf.byte_without_poll_max = 16000;
+        conf.time_reassembly_us = 2000;
+        conf.time_poll_retransmit_us = 10000;
+        conf.time_status_prohibit_us = 1000;
+        conf.max_retx_threshhold = 16;
+        conf.sn_width = ::RLC_SN_18BIT;
+
+        return conf;
+}
+
+}; // namespace
+
+/* Compares recovery through status PDUs with recovery through the lower layer
+ * reporting lost PDUs as soon as it knows about them. */
+TEST_CASE("AM delivery latency with lower layer loss feedback",
+          "[tx][latency][!benchmark]")
+{
+        auto loss = GENERATE(0.01, 0.05, 0.1);
+        auto feedback = GENERATE(false, true);
+
+        bench::loopback link(alloc, am_config(), loss, 1234);
+
+        link.set_delay(std::chrono::milliseconds(2));
+        link.set_loss_feedback(feedback);
+
+        for (auto i = 0; i < 2000; i++) {
+                link.send(1000);
+                link.pump(1500);
+        }
+
+        REQUIRE(link.run(1500, std::chrono::seconds(20)));
+
+        auto stats = link.get_stats();
+
+        std::printf("loss %4.1f%%, %-11s: p50 %8.1f us, p99 %8.1f us, "
+                    "%4zu status PDUs\n",
+                    loss * 100, feedback ? "feedback" : "status only",
+                    bench::percentile(stats.latency_us, 0.5),
+                    bench::percentile(stats.latency_us, 0.99),
+                    stats.status_pdus);
+}
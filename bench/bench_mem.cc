@@ -0,0 +1,397 @@
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+
+#include <gabs/alloc/std.hh>
+
+#include <rlc/rlc.h>
+#include <rlc/mem.h>
+#include <rlc/vclock.h>
+
+#include "channel.hh"
+#include "encode.h"
+#include "loopback.hh"
+
+inline gabs::memory::allocator alloc;
+
+namespace
+{
+
+::rlc_config am_config()
+{
+        ::rlc_config conf = {};
+
+        conf.type = ::RLC_AM;
+        conf.window_size = 4096;
+        conf.pdu_without_poll_max = 16;
+        conf.byte_without_poll_max = 16000;
+        conf.time_reassembly_us = 35000;
+        conf.time_poll_retransmit_us = 45000;
+        conf.time_status_prohibit_us = 10000;
+        conf.max_retx_threshhold = 16;
+        conf.sn_width = ::RLC_SN_18BIT;
+
+        return conf;
+}
+
+void print_usage(const char *name, const ::rlc_mem_stats &stats)
+{
+        std::printf("%s: %zu bytes, peak %zu\n", name, stats.bytes,
+                    stats.peak_bytes);
+
+        for (auto i = 0; i < ::RLC_MEM_COUNT; i++) {
+                auto &kind = stats.kind[i];
+
+                std::printf("  %-10s %8zu bytes %6zu objects, peak %8zu "
+                            "bytes %6zu objects\n",
+                            ::rlc_mem_kind_str(static_cast<::rlc_mem_kind>(i)),
+                            kind.bytes, kind.count, kind.peak_bytes,
+                            kind.peak_count);
+        }
+}
+
+::rlc_errno null_submit(::rlc_context *, ::gabs_pbuf buf)
+{
+        ::gabs_pbuf_decref(buf);
+        return 0;
+}
+
+::rlc_errno null_request(::rlc_context *)
+{
+        return 0;
+}
+
+constexpr ::rlc_backend null_backend = {
+        null_submit,
+        null_request,
+        nullptr,
+};
+
+/* Receiving end of a peer that starts many SDUs without finishing them.
+ * Timers run on a clock that is never advanced, so that nothing is
+ * reassembled or dropped but for the budget. */
+struct rx_entity {
+        ::rlc_config conf = {};
+        ::rlc_context ctx;
+        std::size_t rx_fail = 0;
+
+        rx_entity(::rlc_vclock *vclock, std::size_t budget,
+                  ::rlc_rx_budget_policy policy)
+        {
+                conf.type = ::RLC_UM;
+                conf.window_size = 2048;
+                conf.time_reassembly_us = 35000;
+                conf.sn_width = ::RLC_SN_12BIT;
+                conf.rx_budget_bytes = budget;
+                conf.rx_budget_policy = policy;
+
+                REQUIRE(::rlc_init(&ctx, &null_backend, alloc, alloc) == 0);
+                ::rlc_set_config(&ctx, &conf);
+                (void)::rlc_reset(&ctx);
+
+                REQUIRE(::rlc_vclock_attach(&ctx, vclock) == 0);
+                REQUIRE(::rlc_attach_listener(&ctx, on_event) == 0);
+                entities().push_back(this);
+        }
+
+        ~rx_entity()
+        {
+                ::rlc_detach_listener(&ctx);
+                (void)::rlc_deinit(&ctx);
+                auto &list = entities();
+                list.erase(std::remove(list.begin(), list.end(), this),
+                           list.end());
+        }
+
+        /* Submit @p size bytes at @p so of SN=@p sn */
+        void submit(std::uint32_t sn, std::uint32_t so, std::size_t size,
+                    bool last)
+        {
+                ::rlc_pdu pdu = {};
+                std::vector<std::uint8_t> data(RLC_PDU_HEADER_MAX_SIZE + size,
+                                               0x5a);
+                std::size_t hsize;
+
+                pdu.sn = sn;
+                pdu.seg_offset = so;
+                pdu.size = size;
+                pdu.flags.is_first = so == 0;
+                pdu.flags.is_last = last;
+
+                hsize = ::rlc_pdu_encode_raw(&ctx, &pdu, data.data());
+
+                auto buf = ::gabs_pbuf_new(alloc, hsize + size);
+                REQUIRE(::gabs_pbuf_okay(buf));
+                ::gabs_pbuf_put(&buf, data.data(), hsize + size);
+
+                ::rlc_rx_submit(&ctx, buf);
+        }
+
+        std::size_t held()
+        {
+                ::rlc_mem_stats stats;
+
+                ::rlc_mem_usage(&ctx, &stats, false);
+                return stats.kind[::RLC_MEM_RX_SDU].bytes;
+        }
+
+        ::rlc_rx_stats stats()
+        {
+                ::rlc_rx_stats stats;
+
+                ::rlc_rx_stats_get(&ctx, &stats);
+                return stats;
+        }
+
+        static std::vector<rx_entity *> &entities()
+        {
+                static std::vector<rx_entity *> list;
+                return list;
+        }
+
+        static void on_event(::rlc_context *ctx, const ::rlc_event *event)
+        {
+                for (auto entity : entities()) {
+                        if (&entity->ctx != ctx) {
+                                continue;
+                        }
+
+                        entity->rx_fail +=
+                                event->type == ::rlc_event::RLC_EVENT_RX_FAIL;
+                }
+        }
+};
+
+}; // namespace
+
+TEST_CASE("Memory accounting", "[mem]")
+{
+        ::rlc_vclock vclock;
+        ::rlc_mem_stats tx;
+        ::rlc_mem_stats rx;
+        bench::channel_config link;
+
+        link.loss = 0.05;
+        link.delay = std::chrono::milliseconds(5);
+
+        REQUIRE(::rlc_vclock_init(&vclock, 0) == 0);
+
+        {
+                bench::loopback lb(alloc, am_config(), link, 1234);
+
+                lb.set_virtual_time(&vclock);
+
+                ::rlc_mem_usage(lb.context(0), &tx, false);
+                REQUIRE(tx.bytes == 0);
+                REQUIRE(tx.peak_bytes == 0);
+
+                for (auto i = 0; i < 2000; i++) {
+                        lb.send(1000);
+                        lb.pump(600);
+                        ::rlc_time_advance(&vclock, 500);
+                }
+
+                REQUIRE(lb.run(600, std::chrono::seconds(10)));
+
+                /* Give the last polls and status PDUs time to get through,
+                 * so that everything is released on both ends */
+                for (auto i = 0; i < 100; i++) {
+                        ::rlc_time_advance(&vclock, 10000);
+                        while (lb.pump(600)) {
+                        }
+                }
+
+                ::rlc_mem_usage(lb.context(0), &tx, true);
+                ::rlc_mem_usage(lb.context(1), &rx, true);
+
+                print_usage("TX end", tx);
+                print_usage("RX end", rx);
+
+                /* Segments are sent over several PDUs, and lost ones are
+                 * retransmitted, so both ends have held data */
+                REQUIRE(tx.kind[::RLC_MEM_TX_SDU].peak_count > 0);
+                REQUIRE(tx.kind[::RLC_MEM_TX_SDU].peak_bytes >=
+                        1000 + sizeof(::rlc_sdu));
+                REQUIRE(tx.kind[::RLC_MEM_SEG_NODE].peak_count > 0);
+                REQUIRE(tx.kind[::RLC_MEM_OFFLOAD].peak_count > 0);
+                REQUIRE(tx.kind[::RLC_MEM_HEADER].peak_count > 0);
+                REQUIRE(rx.kind[::RLC_MEM_RX_SDU].peak_count > 0);
+                REQUIRE(rx.kind[::RLC_MEM_EVENT].peak_count > 0);
+                REQUIRE(tx.peak_bytes >= tx.kind[::RLC_MEM_TX_SDU].peak_bytes);
+
+                for (auto i = 0; i < ::RLC_MEM_COUNT; i++) {
+                        CAPTURE(::rlc_mem_kind_str(
+                                static_cast<::rlc_mem_kind>(i)));
+
+                        REQUIRE(tx.kind[i].count == 0);
+                        REQUIRE(tx.kind[i].bytes == 0);
+                        REQUIRE(rx.kind[i].count == 0);
+                        REQUIRE(rx.kind[i].bytes == 0);
+                }
+
+                REQUIRE(tx.bytes == 0);
+                REQUIRE(rx.bytes == 0);
+
+                /* Peaks were reset to the current values */
+                ::rlc_mem_usage(lb.context(0), &tx, false);
+                REQUIRE(tx.peak_bytes == 0);
+                REQUIRE(tx.kind[::RLC_MEM_TX_SDU].peak_count == 0);
+        }
+
+        REQUIRE(::rlc_vclock_deinit(&vclock) == 0);
+}
+
+TEST_CASE("RX budget", "[mem]")
+{
+        constexpr std::size_t budget = 20000;
+        constexpr std::size_t segment = 500;
+        ::rlc_vclock vclock;
+
+        REQUIRE(::rlc_vclock_init(&vclock, 0) == 0);
+
+        SECTION("Reject new SNs")
+        {
+                rx_entity rx(&vclock, budget, ::RLC_RX_BUDGET_REJECT);
+
+                /* SN=0 never arrives, so the window does not move */
+                for (std::uint32_t sn = 1; sn < 200; sn++) {
+                        rx.submit(sn, 0, segment, false);
+                        REQUIRE(rx.held() <= budget);
+                }
+
+                auto stats = rx.stats();
+                REQUIRE(stats.budget_rejected > 0);
+                REQUIRE(stats.budget_dropped == 0);
+                REQUIRE(rx.rx_fail == 0);
+
+                /* New SNs are still rejected, but not the start of the
+                 * window */
+                rx.submit(199, 0, segment, false);
+                REQUIRE(rx.stats().budget_rejected ==
+                        stats.budget_rejected + 1);
+
+                rx.submit(0, 0, segment, false);
+                REQUIRE(rx.stats().budget_rejected ==
+                        stats.budget_rejected + 1);
+
+                /* SDUs in reassembly are still completed, which releases
+                 * them */
+                auto held = rx.held();
+
+                rx.submit(1, segment, segment, true);
+                REQUIRE(rx.stats().budget_rejected ==
+                        stats.budget_rejected + 1);
+                REQUIRE(rx.held() < held);
+        }
+
+        SECTION("Drop oldest")
+        {
+                rx_entity rx(&vclock, budget, ::RLC_RX_BUDGET_DROP_OLDEST);
+
+                for (std::uint32_t sn = 1; sn < 200; sn++) {
+                        rx.submit(sn, 0, segment, false);
+                        ::rlc_time_advance(&vclock, 10);
+                        REQUIRE(rx.held() <= budget);
+                }
+
+                auto stats = rx.stats();
+                REQUIRE(stats.budget_rejected == 0);
+                REQUIRE(stats.budget_dropped > 0);
+                REQUIRE(rx.rx_fail == stats.budget_dropped);
+
+                /* The newest SDUs are kept, and can be completed */
+                auto held = rx.held();
+
+                rx.submit(199, segment, segment, true);
+                REQUIRE(rx.held() < held);
+        }
+
+        SECTION("Shared budget")
+        {
+                ::rlc_rx_budget shared;
+                rx_entity a(&vclock, 0, ::RLC_RX_BUDGET_DROP_OLDEST);
+                rx_entity b(&vclock, 0, ::RLC_RX_BUDGET_REJECT);
+
+                ::rlc_rx_budget_init(&shared, budget);
+                REQUIRE(::rlc_rx_budget_attach(&a.ctx, &shared) == 0);
+                REQUIRE(::rlc_rx_budget_attach(&b.ctx, &shared) == 0);
+
+                for (std::uint32_t sn = 1; sn < 200; sn++) {
+                        a.submit(sn, 0, segment, false);
+                        b.submit(sn, 0, segment, false);
+                        ::rlc_time_advance(&vclock, 10);
+
+                        REQUIRE(shared.used_bytes == a.held() + b.held());
+                        REQUIRE(shared.used_bytes <= budget);
+                }
+
+                REQUIRE(a.stats().budget_dropped > 0);
+                REQUIRE(b.stats().budget_rejected > 0);
+
+                /* SDUs are held, so the budget may not change */
+                REQUIRE(b.held() > 0);
+                REQUIRE(::rlc_rx_budget_attach(&b.ctx, nullptr) == -EBUSY);
+        }
+
+        REQUIRE(::rlc_vclock_deinit(&vclock) == 0);
+}
+
+TEST_CASE("SDU references across threads", "[mem]")
+{
+        constexpr auto workers = 4;
+        constexpr auto rounds = 100000;
+        ::rlc_config conf = {};
+        ::rlc_context ctx;
+        ::rlc_mem_stats stats;
+        ::rlc_sdu *sdu;
+        std::vector<std::thread> threads;
+
+        conf.type = ::RLC_UM;
+        conf.window_size = 2048;
+        conf.time_reassembly_us = 35000;
+        conf.sn_width = ::RLC_SN_12BIT;
+
+        REQUIRE(::rlc_init(&ctx, &null_backend, alloc, alloc) == 0);
+        ::rlc_set_config(&ctx, &conf);
+        (void)::rlc_reset(&ctx);
+
+        std::vector<std::uint8_t> data(100, 0x5a);
+
+        auto buf = ::gabs_pbuf_new(alloc, data.size());
+        REQUIRE(::gabs_pbuf_okay(buf));
+        ::gabs_pbuf_put(&buf, data.data(), data.size());
+        REQUIRE(::rlc_tx(&ctx, buf, &sdu) == 0);
+        ::gabs_pbuf_decref(buf);
+
+        /* Each worker holds a reference of its own, which it drops last,
+         * while the entity sends the SDU and drops its own */
+        for (auto i = 0; i < workers; i++) {
+                ::rlc_sdu_incref(sdu);
+
+                threads.emplace_back([sdu] {
+                        for (auto j = 0; j < rounds; j++) {
+                                ::rlc_sdu_incref(sdu);
+                                ::rlc_sdu_decref(sdu);
+                        }
+
+                        ::rlc_sdu_decref(sdu);
+                });
+        }
+
+        REQUIRE(::rlc_tx_avail(&ctx, 1500) > 0);
+        ::rlc_sdu_decref(sdu);
+
+        for (auto &thread : threads) {
+                thread.join();
+        }
+
+        ::rlc_mem_usage(&ctx, &stats, false);
+        REQUIRE(stats.kind[::RLC_MEM_TX_SDU].count == 0);
+        REQUIRE(stats.kind[::RLC_MEM_TX_SDU].peak_count == 1);
+
+        (void)::rlc_deinit(&ctx);
+}
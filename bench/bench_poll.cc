@@ -0,0 +1,193 @@
+
+#include <cinttypes>
+#include <cstdio>
+
+#include <catch2/catch_all.hpp>
+
+#include <gabs/alloc/std.hh>
+
+#include <rlc/rlc.h>
+
+#include "loopback.hh"
+
+inline gabs::memory::allocator alloc;
+
+namespace
+{
+
+::rlc_config am_config(bool adaptive)
+{
+        ::rlc_config conf = {};
+
+        conf.type = ::RLC_AM;
+        conf.window_size = 4096;
+        conf.pdu_without_poll_max = 16;
+        conf.byte_without_poll_max = 16000;
+        conf.poll_per_rtt = adaptive ? 2 : 0;
+        conf.time_reassembly_us = 10000;
+        conf.time_poll_retransmit_us = 20000;
+        conf.time_status_prohibit_us = 500;
+        conf.max_retx_threshhold = 16;
+        conf.sn_width = ::RLC_SN_18BIT;
+
+        return conf;
+}
+
+}; // namespace
+
+TEST_CASE("AM status overhead across rates", "[arq][poll]")
+{
+        const std::size_t sdu_size = 1000;
+        const auto slot = std::chrono::microseconds(500);
+        const auto duration = std::chrono::milliseconds(300);
+
+        auto mbps = GENERATE(2, 10, 50, 200);
+        auto adaptive = GENERATE(false, true);
+
+        bench::loopback link(alloc, am_config(adaptive), 0, 1234);
+        link.set_delay(std::chrono::milliseconds(2));
+
+        /* The sender always has data queued, and is granted the link rate
+         * once per slot */
+        const std::size_t grant = mbps * 1e6 / 8 *
+                                  std::chrono::duration<double>(slot).count();
+
+        auto start = bench::clock::now();
+        auto next_slot = start;
+
+        for (auto now = start; now < start + duration;
+             now = bench::clock::now()) {
+                if (now < next_slot) {
+                        link.deliver();
+                        continue;
+                }
+
+                struct ::rlc_tx_buffer_status status;
+
+                ::rlc_tx_buffer_status(link.context(0), &status);
+
+                for (auto queued = status.new_bytes; queued < 2 * grant;
+                     queued += sdu_size) {
+                        link.send(sdu_size);
+                }
+
+                link.answer(grant);
+                next_slot += slot;
+        }
+
+        REQUIRE(link.run(grant, std::chrono::seconds(10)));
+
+        auto stats = link.get_stats();
+        ::rlc_tx_rtt rtt;
+
+        ::rlc_tx_rtt_get(link.context(0), &rtt);
+
+        auto rtts = std::chrono::duration<double, std::micro>(duration) /
+                    std::chrono::microseconds(rtt.srtt_us);
+
+        std::printf("%3d Mbit/s, %-8s: SRTT %5" PRIu32 " us, %5zu status PDUs "
+                    "(%5.2f per RTT), %.5f status bytes per goodput byte\n",
+                    mbps, adaptive ? "adaptive" : "static", rtt.srtt_us,
+                    stats.status_pdus, stats.status_pdus / rtts,
+                    static_cast<double>(stats.status_bytes) /
+                            stats.delivered_bytes);
+}
+
+/* A sender that polls with every PDU, and retransmits polls well before the
+ * status PDU can arrive. SDUs are sparse, so most of the status PDUs triggered
+ * by the retransmitted polls are unchanged. */
+TEST_CASE("AM status coalescing under aggressive polling", "[arq][poll]")
+{
+        const std::size_t sdu_size = 1000;
+        const auto slot = std::chrono::microseconds(4000);
+        const auto duration = std::chrono::milliseconds(300);
+        const std::size_t grant = 1500;
+
+        auto adaptive = GENERATE(false, true);
+
+        auto conf = am_config(false);
+        conf.pdu_without_poll_max = 1;
+        conf.time_poll_retransmit_us = 1000;
+        conf.time_status_prohibit_max_us = adaptive ? 8000 : 0;
+
+        bench::loopback link(alloc, conf, 0, 1234);
+        link.set_delay(std::chrono::milliseconds(2));
+
+        auto start = bench::clock::now();
+        auto next_slot = start;
+
+        for (auto now = start; now < start + duration;
+             now = bench::clock::now()) {
+                if (now >= next_slot) {
+                        link.send(sdu_size);
+                        next_slot += slot;
+                }
+
+                link.pump(grant);
+        }
+
+        REQUIRE(link.run(grant, std::chrono::seconds(10)));
+
+        auto stats = link.get_stats();
+        ::rlc_rx_stats rx;
+
+        ::rlc_rx_stats_get(link.context(1), &rx);
+
+        std::printf("%-8s prohibit: %5" PRIu64 " polls, %4" PRIu64
+                    " status PDUs sent, %4" PRIu64 " suppressed, "
+                    "t-StatusProhibit %5" PRIu32 " us, p99 %8.1f us\n",
+                    adaptive ? "adaptive" : "static", rx.polls,
+                    rx.status_sent, rx.status_suppressed,
+                    rx.status_prohibit_us,
+                    bench::percentile(stats.latency_us, 0.99));
+}
+
+/* Bursts of SDUs are spaced further apart than the round trip time. After each
+ * burst the receive state does not change, while the sender keeps
+ * retransmitting its poll as the status PDU takes longer than
+ * t-PollRetransmit to arrive. Repeated status PDUs are suppressed while the
+ * one in flight is recent. */
+TEST_CASE("AM status PDUs for repeated polls", "[arq][poll]")
+{
+        const std::size_t sdu_size = 1000;
+        const std::size_t grant = 1500;
+        const auto slot = std::chrono::milliseconds(20);
+        const auto duration = std::chrono::milliseconds(300);
+
+        auto adaptive = GENERATE(false, true);
+
+        auto conf = am_config(false);
+        conf.time_poll_retransmit_us = 2000;
+        conf.time_status_prohibit_us = 8000;
+        conf.time_status_prohibit_max_us = adaptive ? 16000 : 0;
+
+        bench::loopback link(alloc, conf, 0, 1234);
+        link.set_delay(std::chrono::milliseconds(5));
+
+        auto start = bench::clock::now();
+        auto next_slot = start;
+
+        for (auto now = start; now < start + duration;
+             now = bench::clock::now()) {
+                if (now >= next_slot) {
+                        for (auto i = 0; i < 4; i++) {
+                                link.send(sdu_size);
+                        }
+
+                        next_slot += slot;
+                }
+
+                link.pump(grant);
+        }
+
+        REQUIRE(link.run(grant, std::chrono::seconds(10)));
+
+        ::rlc_rx_stats rx;
+
+        ::rlc_rx_stats_get(link.context(1), &rx);
+
+        std::printf("%-8s prohibit: %5" PRIu64 " polls, %4" PRIu64
+                    " status PDUs sent, %4" PRIu64 " suppressed\n",
+                    adaptive ? "adaptive" : "static", rx.polls,
+                    rx.status_sent, rx.status_suppressed);
+}
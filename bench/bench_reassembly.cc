@@ -0,0 +1,376 @@
+
+/*
+ * Microbenchmarks of segment bookkeeping and SDU reassembly.
+ *
+ * Segments of an SDU are fed to `rlc_seg_list_insert_all`, as on the TX side
+ * when bytes are returned for retransmission, and to `rlc_seg_buf_insert`, as
+ * on the RX side, in different arrival orders. Besides the time per SDU, the
+ * allocations made by the segment bookkeeping and the shape of the result are
+ * reported per SDU, so that changes to the data structures can be compared.
+ *
+ * Usage: bench_reassembly [--filter SUBSTR] [--min-time MS] [--out FILE]
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gabs/alloc/std.hh>
+#include <gabs/pbuf.h>
+
+#include <rlc/list.h>
+#include <rlc/seg_buf.h>
+#include <rlc/seg_list.h>
+
+#include "micro.hh"
+
+namespace
+{
+
+using bench::micro::sink;
+
+gabs::memory::allocator alloc;
+
+/* Segments per batch, so that small SDUs are timed over many of them */
+constexpr std::size_t batch_segments = 4096;
+constexpr std::uint64_t seed = 1234;
+
+const std::size_t sdu_sizes[] = {100, 1500, 9000};
+const std::size_t seg_sizes[] = {20, 100, 500, 1500};
+
+enum class arrival {
+        in_order,
+        reverse,
+        shuffled,
+        overlap,   /* Shuffled, each segment overlapping half of the next */
+        duplicate, /* Shuffled, each segment arriving twice */
+};
+
+const struct {
+        arrival kind;
+        const char *name;
+} arrivals[] = {
+        {arrival::in_order, "in_order"},   {arrival::reverse, "reverse"},
+        {arrival::shuffled, "shuffled"},   {arrival::overlap, "overlap"},
+        {arrival::duplicate, "duplicate"},
+};
+
+std::vector<::rlc_seg> make_pattern(arrival kind, std::size_t sdu_size,
+                                    std::size_t seg_size)
+{
+        std::vector<::rlc_seg> segs;
+        std::mt19937_64 rng(seed);
+        std::size_t stride = seg_size;
+
+        if (kind == arrival::overlap) {
+                stride = seg_size / 2;
+        }
+
+        for (std::size_t start = 0; start < sdu_size; start += stride) {
+                auto end = std::min(start + seg_size, sdu_size);
+
+                segs.push_back(::rlc_seg{static_cast<std::uint32_t>(start),
+                                         static_cast<std::uint32_t>(end)});
+
+                if (end == sdu_size) {
+                        break;
+                }
+        }
+
+        switch (kind) {
+        case arrival::in_order:
+                break;
+        case arrival::reverse:
+                std::reverse(segs.begin(), segs.end());
+                break;
+        case arrival::duplicate:
+                segs.insert(segs.end(), segs.begin(), segs.end());
+                /* fallthrough */
+        case arrival::shuffled:
+        case arrival::overlap:
+                std::shuffle(segs.begin(), segs.end(), rng);
+                break;
+        }
+
+        return segs;
+}
+
+std::size_t list_length(::rlc_seg_list *list)
+{
+        std::size_t length = 0;
+        ::rlc_dlist_it it;
+
+        rlc_dlist_foreach(list, it)
+        {
+                length++;
+        }
+
+        return length;
+}
+
+/* What the segment bookkeeping does for one SDU. This replays @p segs on a
+ * segment list the same way `rlc_seg_buf_insert` does, one call to
+ * `rlc_seg_list_insert` at a time, which allocates or frees at most one item
+ * per call. */
+struct shape {
+        std::size_t item_allocs = 0;
+        std::size_t item_frees = 0;
+        std::size_t buf_clones = 0; /* Made by rlc_seg_buf_insert */
+        std::size_t chunks = 0;     /* Unique parts inserted */
+        std::size_t peak_length = 0;
+};
+
+shape replay(const std::vector<::rlc_seg> &segs)
+{
+        ::rlc_seg_list list;
+        shape result;
+
+        ::rlc_dlist_init(&list);
+
+        for (auto seg : segs) {
+                ::rlc_seg unique;
+
+                do {
+                        auto before = list_length(&list);
+
+                        if (::rlc_seg_list_insert(&list, &seg, &unique,
+                                                  alloc) != 0) {
+                                break;
+                        }
+
+                        auto after = list_length(&list);
+
+                        result.item_allocs += after > before;
+                        result.item_frees += after < before;
+                        result.peak_length =
+                                std::max(result.peak_length, after);
+                        result.chunks++;
+
+                        /* More to insert, so the unique part is cloned */
+                        result.buf_clones += ::rlc_seg_okay(&seg);
+                } while (::rlc_seg_okay(&seg));
+        }
+
+        ::rlc_seg_list_clear(&list, alloc);
+
+        return result;
+}
+
+std::size_t chain_links(::gabs_pbuf *buf)
+{
+        std::size_t links = 0;
+        ::gabs_pbuf_ci it;
+
+        gabs_pbuf_ci_foreach(buf, it)
+        {
+                links++;
+        }
+
+        return links;
+}
+
+/* A batch of SDUs, each reassembled from the same pattern of segments */
+struct batch {
+        std::vector<::rlc_seg> segs;
+        std::vector<std::uint8_t> data;
+        std::size_t sdus;
+
+        std::vector<::rlc_seg_list> lists;
+        std::vector<::rlc_seg_buf> bufs;
+        std::vector<::gabs_pbuf> inputs; /* Segments of all SDUs, in order */
+
+        ~batch()
+        {
+                release();
+        }
+
+        void release()
+        {
+                for (auto &list : lists) {
+                        ::rlc_seg_list_clear(&list, alloc);
+                }
+
+                for (auto &buf : bufs) {
+                        ::rlc_seg_buf_destroy(&buf, alloc);
+                }
+
+                for (auto input : inputs) {
+                        ::gabs_pbuf_decref(input);
+                }
+
+                lists.clear();
+                bufs.clear();
+                inputs.clear();
+        }
+
+        void setup_lists()
+        {
+                release();
+
+                lists.resize(sdus);
+                for (auto &list : lists) {
+                        ::rlc_dlist_init(&list);
+                }
+        }
+
+        void run_lists()
+        {
+                for (auto &list : lists) {
+                        for (auto seg : segs) {
+                                (void)::rlc_seg_list_insert_all(&list, seg,
+                                                                alloc);
+                        }
+                }
+        }
+
+        void setup_bufs()
+        {
+                release();
+
+                bufs.resize(sdus, ::rlc_seg_buf{});
+
+                for (std::size_t i = 0; i < sdus; i++) {
+                        for (auto seg : segs) {
+                                auto size = seg.end - seg.start;
+                                auto buf = ::gabs_pbuf_new(alloc, size);
+
+                                ::gabs_pbuf_put(&buf, &data[seg.start], size);
+                                inputs.push_back(buf);
+                        }
+                }
+        }
+
+        void run_bufs()
+        {
+                auto input = inputs.begin();
+
+                for (auto &buf : bufs) {
+                        for (auto seg : segs) {
+                                (void)::rlc_seg_buf_insert(&buf, &*input, seg,
+                                                           alloc, alloc);
+
+                                /* The segment buffer holds its own
+                                 * reference */
+                                ::gabs_pbuf_decref(*input);
+                                ++input;
+                        }
+                }
+
+                inputs.clear();
+                sink = ::gabs_pbuf_size(bufs.back().buf);
+        }
+};
+
+void run_case(std::vector<bench::micro::result> &results,
+              const bench::micro::options &opts, const char *pattern,
+              arrival kind, std::size_t sdu_size, std::size_t seg_size)
+{
+        auto state = std::make_shared<batch>();
+        std::string suffix;
+
+        state->segs = make_pattern(kind, sdu_size, seg_size);
+        state->sdus = std::max<std::size_t>(
+                1, batch_segments / state->segs.size());
+        state->data.resize(sdu_size);
+
+        for (std::size_t i = 0; i < sdu_size; i++) {
+                state->data[i] = static_cast<std::uint8_t>(i);
+        }
+
+        auto stats = replay(state->segs);
+
+        suffix = "/" + std::string(pattern) + "/sdu" +
+                 std::to_string(sdu_size) + "/seg" + std::to_string(seg_size);
+
+        auto report = [&](const char *function, bench::micro::timing time,
+                          std::vector<std::pair<const char *, double>> extra) {
+                bench::micro::result r;
+
+                r.name = function + suffix;
+                r.labels = {{"function", function}, {"arrival", pattern}};
+                r.metrics = {
+                        {"sdu_size", sdu_size},
+                        {"seg_size", seg_size},
+                        {"segments_per_sdu", state->segs.size()},
+                        {"item_allocs_per_sdu", stats.item_allocs},
+                        {"item_frees_per_sdu", stats.item_frees},
+                        {"peak_list_length", stats.peak_length},
+                        {"ns_per_segment",
+                         time.ns_per_op / state->segs.size()},
+                };
+                r.metrics.insert(r.metrics.end(), extra.begin(), extra.end());
+                r.time = time;
+
+                std::fprintf(stderr,
+                             "%-52s %10.1f ns/SDU %6.1f allocs/SDU %4zu "
+                             "peak\n",
+                             r.name.c_str(), time.ns_per_op,
+                             static_cast<double>(stats.item_allocs),
+                             stats.peak_length);
+
+                results.push_back(std::move(r));
+        };
+
+        if (opts.selected("rlc_seg_list_insert_all" + suffix)) {
+                auto time = bench::micro::measure(
+                        [state] { state->setup_lists(); },
+                        [state] { state->run_lists(); }, state->sdus,
+                        opts.min_time);
+
+                report("rlc_seg_list_insert_all", time, {});
+        }
+
+        if (opts.selected("rlc_seg_buf_insert" + suffix)) {
+                auto time = bench::micro::measure(
+                        [state] { state->setup_bufs(); },
+                        [state] { state->run_bufs(); }, state->sdus,
+                        opts.min_time);
+
+                /* Shape of the reassembled buffer, outside of the timing */
+                state->setup_bufs();
+                state->run_bufs();
+
+                report("rlc_seg_buf_insert", time,
+                       {
+                               {"chunks_per_sdu", stats.chunks},
+                               {"buf_clones_per_sdu", stats.buf_clones},
+                               {"chain_links",
+                                chain_links(&state->bufs[0].buf)},
+                       });
+        }
+
+        state->release();
+}
+
+}; // namespace
+
+int main(int argc, char **argv)
+{
+        bench::micro::options opts;
+        std::vector<bench::micro::result> results;
+
+        if (!bench::micro::parse_options(argc, argv, opts)) {
+                return 2;
+        }
+
+        for (auto sdu_size : sdu_sizes) {
+                for (auto seg_size : seg_sizes) {
+                        if (seg_size >= sdu_size) {
+                                continue;
+                        }
+
+                        for (auto &a : arrivals) {
+                                run_case(results, opts, a.name, a.kind,
+                                         sdu_size, seg_size);
+                        }
+                }
+        }
+
+        return bench::micro::finish(results, opts,
+                                    {{"batch_segments", batch_segments},
+                                     {"seed", seed}});
+}
@@ -0,0 +1,65 @@
+
+#include <cstdio>
+
+#include <catch2/catch_all.hpp>
+
+#include <gabs/alloc/std.hh>
+
+#include <rlc/rlc.h>
+
+#include "loopback.hh"
+
+inline gabs::memory::allocator alloc;
+
+namespace
+{
+
+::rlc_config am_config(bool out_of_order)
+{
+        ::rlc_config conf = {};
+
+        conf.type = ::RLC_AM;
+        conf.window_size = 4096;
+        conf.pdu_without_poll_max = 16;
+        conf.byte_without_poll_max = 16000;
+        conf.time_reassembly_us = 2000;
+        conf.time_poll_retransmit_us = 5000;
+        conf.time_status_prohibit_us = 1000;
+        conf.max_retx_threshhold = 16;
+        conf.sn_width = ::RLC_SN_18BIT;
+        conf.deliver_out_of_order = out_of_order;
+
+        return conf;
+}
+
+}; // namespace
+
+TEST_CASE("AM delivery latency under loss", "[rx][latency]")
+{
+        auto loss = GENERATE(0.0, 0.01, 0.05);
+        auto out_of_order = GENERATE(false, true);
+
+        bench::loopback link(alloc, am_config(out_of_order), loss, 1234);
+
+        for (auto i = 0; i < 2000; i++) {
+                link.send(1000);
+                link.pump(1500);
+        }
+
+        REQUIRE(link.run(1500, std::chrono::seconds(10)));
+
+        auto stats = link.get_stats();
+
+        std::printf("loss %4.1f%%, %-12s: mean %8.1f us, p50 %8.1f us, "
+                    "p99 %8.1f us\n",
+                    loss * 100, out_of_order ? "out of order" : "in order",
+                    [&] {
+                            double sum = 0;
+                            for (auto v : stats.latency_us) {
+                                    sum += v;
+                            }
+                            return sum / stats.latency_us.size();
+                    }(),
+                    bench::percentile(stats.latency_us, 0.5),
+                    bench::percentile(stats.latency_us, 0.99));
+}
@@ -0,0 +1,219 @@
+
+/*
+ * Microbenchmarks of walks over an SDU queue.
+ *
+ * Both sides keep their SDUs in a list sorted by SN, which is walked to find
+ * an SDU by SN and to pick the SDUs to serve on each transmit opportunity.
+ * Each SDU of the queue holds a data buffer allocated along with it, as after
+ * `rlc_tx`, so that neighbouring SDUs do not share cache lines. Besides the
+ * time per SDU visited, cache misses per SDU visited are reported where perf
+ * events are available.
+ *
+ * Usage: bench_sdu_queue [--filter SUBSTR] [--min-time MS] [--out FILE]
+ */
+
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gabs/alloc/std.hh>
+#include <gabs/pbuf.h>
+
+#include <rlc/rlc.h>
+#include <rlc/sdu.h>
+
+#include "micro.hh"
+
+namespace
+{
+
+using bench::micro::sink;
+
+gabs::memory::allocator alloc;
+
+constexpr std::size_t lookups = 1024;
+constexpr std::size_t sdu_size = 1500;
+constexpr std::uint64_t seed = 1234;
+
+const std::size_t queue_lengths[] = {64, 1024, 16384};
+
+::rlc_errno null_submit(::rlc_context *, ::gabs_pbuf buf)
+{
+        ::gabs_pbuf_decref(buf);
+        return 0;
+}
+
+::rlc_errno null_request(::rlc_context *)
+{
+        return 0;
+}
+
+constexpr ::rlc_backend null_backend = {
+        null_submit,
+        null_request,
+        nullptr,
+};
+
+struct queue {
+        ::rlc_config conf = {};
+        ::rlc_context ctx;
+        ::rlc_sdu_queue sdus;
+        std::vector<std::uint32_t> sns; /* SNs to look up */
+
+        explicit queue(std::size_t length)
+        {
+                std::mt19937_64 rng(seed);
+
+                conf.type = ::RLC_AM;
+                conf.window_size = length;
+                conf.sn_width = ::RLC_SN_18BIT;
+
+                (void)::rlc_init(&ctx, &null_backend, alloc, alloc);
+                ::rlc_set_config(&ctx, &conf);
+                (void)::rlc_reset(&ctx);
+
+                ::rlc_dlist_init(&sdus);
+
+                /* In descending SN order, so that each insert is at the
+                 * head */
+                for (auto sn = length; sn-- > 0;) {
+                        auto sdu = ::rlc_sdu_alloc(&ctx, true);
+
+                        sdu->sn = static_cast<std::uint32_t>(sn);
+                        sdu->state = sn % 4 == 0 ? ::RLC_WAIT : ::RLC_READY;
+                        sdu->tx.buffer = ::gabs_pbuf_new(alloc, sdu_size);
+                        sdu->tx.sent = sn % 2 == 0 ? sdu_size : 0;
+
+                        ::rlc_sdu_queue_insert(&sdus, sdu);
+                }
+
+                std::uniform_int_distribution<std::uint32_t> dist(
+                        0, static_cast<std::uint32_t>(length - 1));
+
+                for (std::size_t i = 0; i < lookups; i++) {
+                        sns.push_back(dist(rng));
+                }
+        }
+
+        ~queue()
+        {
+                ::rlc_sdu_queue_clear(&sdus);
+                (void)::rlc_deinit(&ctx);
+        }
+
+        void run_get()
+        {
+                std::size_t found = 0;
+
+                for (auto sn : sns) {
+                        found += ::rlc_sdu_queue_get(&sdus, sn) != nullptr;
+                }
+
+                sink = found;
+        }
+
+        /* The check made for every SDU when serving a transmit opportunity
+         * or looking for SDUs to discard */
+        void run_scan()
+        {
+                std::size_t ready = 0;
+                ::rlc_dlist_it it;
+
+                rlc_dlist_foreach(&sdus, it)
+                {
+                        auto sdu = rlc_sdu_from_it(it);
+
+                        ready += sdu->state == ::RLC_READY &&
+                                 sdu->tx.sent == 0;
+                }
+
+                sink = ready;
+        }
+};
+
+void run_case(std::vector<bench::micro::result> &results,
+              const bench::micro::options &opts,
+              bench::micro::cache_misses &misses, std::size_t length)
+{
+        auto state = std::make_shared<queue>(length);
+        auto setup = [] {};
+
+        auto report = [&](const char *function, std::size_t ops,
+                          std::size_t visited,
+                          const std::function<void()> &run) {
+                bench::micro::result r;
+                std::string name;
+                double per_sdu;
+
+                name = std::string(function) + "/len" +
+                       std::to_string(length);
+                if (!opts.selected(name)) {
+                        return;
+                }
+
+                r.name = name;
+                r.labels = {{"function", function}};
+                r.time = bench::micro::measure(setup, run, ops, opts.min_time);
+
+                per_sdu = misses.measure(setup, run, visited);
+
+                r.metrics = {
+                        {"queue_length", length},
+                        {"sdu_struct_size", sizeof(::rlc_sdu)},
+                        {"ns_per_sdu", r.time.ns_per_op * ops / visited},
+                };
+
+                if (per_sdu >= 0) {
+                        r.metrics.push_back({"cache_misses_per_sdu", per_sdu});
+                }
+
+                std::fprintf(stderr, "%-32s %10.1f ns/op %8.2f ns/SDU",
+                             name.c_str(), r.time.ns_per_op,
+                             r.time.ns_per_op * ops / visited);
+                if (per_sdu >= 0) {
+                        std::fprintf(stderr, " %6.2f misses/SDU", per_sdu);
+                }
+                std::fprintf(stderr, "\n");
+
+                results.push_back(std::move(r));
+        };
+
+        std::size_t visited = 0;
+
+        /* A lookup stops at the SDU it looks for */
+        for (auto sn : state->sns) {
+                visited += sn + 1;
+        }
+
+        report("rlc_sdu_queue_get", lookups, visited,
+               [state] { state->run_get(); });
+        report("scan", length, length, [state] { state->run_scan(); });
+}
+
+}; // namespace
+
+int main(int argc, char **argv)
+{
+        bench::micro::options opts;
+        bench::micro::cache_misses misses;
+        std::vector<bench::micro::result> results;
+
+        if (!bench::micro::parse_options(argc, argv, opts)) {
+                return 2;
+        }
+
+        if (!misses.okay()) {
+                std::fprintf(stderr, "Cache misses can not be counted here\n");
+        }
+
+        for (auto length : queue_lengths) {
+                run_case(results, opts, misses, length);
+        }
+
+        return bench::micro::finish(results, opts,
+                                    {{"lookups", lookups},
+                                     {"sdu_size", sdu_size},
+                                     {"seed", seed}});
+}
@@ -0,0 +1,225 @@
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+
+#include <gabs/alloc/std.hh>
+
+#include <rlc/rlc.h>
+#include <rlc/trace.h>
+#include <rlc/vclock.h>
+
+#include "loopback.hh"
+
+inline gabs::memory::allocator alloc;
+
+namespace
+{
+
+::rlc_config am_config()
+{
+        ::rlc_config conf = {};
+
+        conf.type = ::RLC_AM;
+        conf.window_size = 4096;
+        conf.pdu_without_poll_max = 16;
+        conf.byte_without_poll_max = 16000;
+        conf.time_reassembly_us = 2000;
+        conf.time_poll_retransmit_us = 5000;
+        conf.time_status_prohibit_us = 1000;
+        conf.max_retx_threshhold = 16;
+        conf.sn_width = ::RLC_SN_18BIT;
+
+        return conf;
+}
+
+/* Records read from a context, counted by event */
+struct trace_reader {
+        std::vector<::rlc_trace_record> records;
+        std::array<std::size_t, ::RLC_TRACE_EVENT_COUNT> counts = {};
+        std::uint64_t lost = 0;
+
+        void read(::rlc_context *ctx)
+        {
+                ::rlc_trace_record buf[256];
+                std::uint64_t lost_now;
+                std::size_t count;
+
+                while ((count = ::rlc_trace_read(ctx, buf, std::size(buf),
+                                                 &lost_now)) > 0) {
+                        lost += lost_now;
+
+                        for (std::size_t i = 0; i < count; i++) {
+                                counts[buf[i].event]++;
+                                records.push_back(buf[i]);
+                        }
+                }
+        }
+};
+
+}; // namespace
+
+TEST_CASE("Event trace", "[trace]")
+{
+        const std::size_t sdus = 500;
+        std::vector<::rlc_trace_record> records[2];
+        ::rlc_trace trace[2];
+        trace_reader reader[2];
+
+        for (auto i = 0; i < 2; i++) {
+                records[i].resize(1 << 12);
+                REQUIRE(::rlc_trace_init(&trace[i], records[i].data(),
+                                         records[i].size()) == 0);
+        }
+
+        REQUIRE(::rlc_trace_init(&trace[0], records[0].data(), 1000) ==
+                -EINVAL);
+
+        /* In virtual time, so that no timer fires between the last pump
+         * and counting the records */
+        ::rlc_vclock vclock;
+        REQUIRE(::rlc_vclock_init(&vclock, 0) == 0);
+
+        bench::loopback link(alloc, am_config(), 0.05, 1234);
+
+        link.set_virtual_time(&vclock);
+
+        ::rlc_trace_attach(link.context(0), &trace[0]);
+        ::rlc_trace_attach(link.context(1), &trace[1]);
+
+        for (std::size_t i = 0; i < sdus; i++) {
+                link.send(1000);
+                link.pump(1500);
+
+                reader[0].read(link.context(0));
+                reader[1].read(link.context(1));
+        }
+
+        REQUIRE(link.run(1500, std::chrono::seconds(10)));
+
+        while (link.pump(1500)) {
+        }
+
+        reader[0].read(link.context(0));
+        reader[1].read(link.context(1));
+
+        ::rlc_trace_attach(link.context(0), nullptr);
+        ::rlc_trace_attach(link.context(1), nullptr);
+
+        auto stats = link.get_stats();
+        auto &tx = reader[0].counts;
+        auto &rx = reader[1].counts;
+
+        REQUIRE(reader[0].lost == 0);
+        REQUIRE(reader[1].lost == 0);
+
+        REQUIRE(tx[::RLC_TRACE_TX_SDU] == sdus);
+        /* The last SDUs may not be acknowledged yet */
+        REQUIRE(tx[::RLC_TRACE_TX_DONE] > 0);
+        REQUIRE(tx[::RLC_TRACE_TX_DONE] <= sdus);
+        REQUIRE(rx[::RLC_TRACE_RX_SDU] == sdus);
+        REQUIRE(rx[::RLC_TRACE_RX_DELIVER] == sdus);
+
+        /* Every PDU is traced when submitted, and again when received unless
+         * it was lost */
+        REQUIRE(tx[::RLC_TRACE_TX_PDU] + rx[::RLC_TRACE_TX_STATUS] ==
+                stats.pdus_sent);
+        REQUIRE(tx[::RLC_TRACE_TX_PDU] + rx[::RLC_TRACE_TX_STATUS] -
+                        stats.pdus_lost ==
+                rx[::RLC_TRACE_RX_PDU] + tx[::RLC_TRACE_RX_STATUS]);
+
+        REQUIRE(tx[::RLC_TRACE_TX_RETX] > 0);
+        REQUIRE(rx[::RLC_TRACE_TX_NACK] > 0);
+
+        for (auto &reader : reader) {
+                std::uint64_t time_us = 0;
+                char line[256];
+
+                for (auto &record : reader.records) {
+                        REQUIRE(record.time_us >= time_us);
+                        time_us = record.time_us;
+
+                        REQUIRE(::rlc_trace_format(&record, line,
+                                                   sizeof(line)) > 0);
+                        REQUIRE(std::strstr(line, "UNKNOWN") == nullptr);
+                }
+        }
+
+        char line[256];
+        ::rlc_trace_format(&reader[1].records.back(), line, sizeof(line));
+
+        std::printf("%zu + %zu records, last: %s\n", reader[0].records.size(),
+                    reader[1].records.size(), line);
+}
+
+TEST_CASE("Event trace overflow", "[trace]")
+{
+        std::vector<::rlc_trace_record> records(64);
+        ::rlc_trace trace;
+
+        REQUIRE(::rlc_trace_init(&trace, records.data(), records.size()) == 0);
+
+        bench::loopback link(alloc, am_config(), 0, 1234);
+
+        ::rlc_trace_attach(link.context(0), &trace);
+
+        /* SNs are only taken on transmission, so the SDUs are told apart by
+         * their size */
+        for (auto i = 0; i < 100; i++) {
+                link.send(100 + i);
+        }
+
+        ::rlc_trace_record out[128];
+        std::uint64_t lost;
+
+        /* Only the most recent records are kept */
+        REQUIRE(::rlc_trace_read(link.context(0), out, std::size(out),
+                                 &lost) == records.size());
+        REQUIRE(lost == 100 - records.size());
+        REQUIRE(out[0].event == ::RLC_TRACE_TX_SDU);
+        REQUIRE(out[0].so_end == 100 + lost);
+        REQUIRE(out[records.size() - 1].so_end == 199);
+
+        REQUIRE(::rlc_trace_read(link.context(0), out, std::size(out),
+                                 &lost) == 0);
+        REQUIRE(lost == 0);
+
+        ::rlc_trace_attach(link.context(0), nullptr);
+
+        REQUIRE(link.run(1500, std::chrono::seconds(10)));
+}
+
+TEST_CASE("Event trace overhead", "[trace][!benchmark]")
+{
+        auto tracing = GENERATE(false, true);
+        std::vector<::rlc_trace_record> records[2];
+        ::rlc_trace trace[2];
+
+        bench::loopback link(alloc, am_config(), 0, 1234);
+
+        for (auto i = 0; i < 2; i++) {
+                records[i].resize(1 << 12);
+                REQUIRE(::rlc_trace_init(&trace[i], records[i].data(),
+                                         records[i].size()) == 0);
+
+                if (tracing) {
+                        ::rlc_trace_attach(link.context(i), &trace[i]);
+                }
+        }
+
+        BENCHMARK(tracing ? "200 SDUs, tracing" : "200 SDUs")
+        {
+                for (auto i = 0; i < 200; i++) {
+                        link.send(1000);
+                        link.pump(1500);
+                }
+
+                return link.run(1500, std::chrono::seconds(10));
+        };
+
+        ::rlc_trace_attach(link.context(0), nullptr);
+        ::rlc_trace_attach(link.context(1), nullptr);
+}
@@ -0,0 +1,304 @@
+
+#include <algorithm>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+
+#include <gabs/alloc/std.hh>
+
+#include <rlc/rlc.h>
+#include <rlc/latency.h>
+#include <rlc/vclock.h>
+
+inline gabs::memory::allocator alloc;
+
+namespace
+{
+
+::rlc_errno null_submit(::rlc_context *, ::gabs_pbuf buf)
+{
+        ::gabs_pbuf_decref(buf);
+        return 0;
+}
+
+::rlc_errno null_request(::rlc_context *)
+{
+        return 0;
+}
+
+constexpr ::rlc_backend null_backend = {
+        null_submit,
+        null_request,
+        nullptr,
+};
+
+/* Sending end whose PDUs are built into memory and thrown away. In UM, an
+ * SDU leaves the TX queue as soon as it has been built. */
+struct tx_entity {
+        ::rlc_config conf = {};
+        ::rlc_context ctx;
+        std::vector<::rlc_event::rlc_event_type> events;
+        std::size_t aqm_dropped = 0;
+
+        explicit tx_entity(const ::rlc_config &conf) : conf(conf)
+        {
+                REQUIRE(::rlc_init(&ctx, &null_backend, alloc, alloc) == 0);
+                ::rlc_set_config(&ctx, &this->conf);
+                (void)::rlc_reset(&ctx);
+
+                REQUIRE(::rlc_attach_listener(&ctx, on_event) == 0);
+                active = this;
+        }
+
+        ~tx_entity()
+        {
+                ::rlc_detach_listener(&ctx);
+                (void)::rlc_deinit(&ctx);
+        }
+
+        ::rlc_errno send(std::size_t size)
+        {
+                std::vector<std::uint8_t> data(size, 0x5a);
+                ::rlc_errno status;
+
+                auto buf = ::gabs_pbuf_new(alloc, size);
+                REQUIRE(::gabs_pbuf_okay(buf));
+                ::gabs_pbuf_put(&buf, data.data(), size);
+
+                status = ::rlc_tx(&ctx, buf, nullptr);
+                ::gabs_pbuf_decref(buf);
+
+                return status;
+        }
+
+        std::size_t build(std::size_t grant)
+        {
+                std::vector<std::uint8_t> dst(grant);
+                ::rlc_tx_pdu_info pdus[64];
+                std::size_t count = 64;
+
+                return ::rlc_tx_build(&ctx, dst.data(), grant, pdus, &count,
+                                      nullptr);
+        }
+
+        struct ::rlc_tx_buffer_status status()
+        {
+                struct ::rlc_tx_buffer_status status;
+
+                ::rlc_tx_buffer_status(&ctx, &status);
+                return status;
+        }
+
+        static inline tx_entity *active;
+
+        static void on_event(::rlc_context *, const ::rlc_event *event)
+        {
+                auto self = active;
+
+                if (event->type == ::rlc_event::RLC_EVENT_TX_PAUSE ||
+                    event->type == ::rlc_event::RLC_EVENT_TX_RESUME ||
+                    event->type == ::rlc_event::RLC_EVENT_TX_MARK) {
+                        self->events.push_back(event->type);
+                }
+
+                using reason = decltype(event->tx_release.reason);
+
+                if (event->type == ::rlc_event::RLC_EVENT_TX_RELEASE &&
+                    event->tx_release.reason == reason::RLC_TX_RELEASE_AQM) {
+                        self->aqm_dropped++;
+                }
+        }
+};
+
+::rlc_config um_config()
+{
+        ::rlc_config conf = {};
+
+        conf.type = ::RLC_UM;
+        conf.window_size = 2048;
+        conf.time_reassembly_us = 35000;
+        conf.sn_width = ::RLC_SN_12BIT;
+
+        return conf;
+}
+
+}; // namespace
+
+TEST_CASE("TX queue limits", "[txq]")
+{
+        auto conf = um_config();
+
+        SECTION("Bytes")
+        {
+                conf.tx_queue_max_bytes = 10000;
+                tx_entity tx(conf);
+
+                for (auto i = 0; i < 10; i++) {
+                        REQUIRE(tx.send(1000) == 0);
+                }
+
+                REQUIRE(tx.send(1) == -ENOBUFS);
+                REQUIRE(tx.status().queued_bytes == 10000);
+                REQUIRE(tx.status().queued_sdus == 10);
+
+                /* Sending makes room again */
+                REQUIRE(tx.build(1500) > 0);
+                REQUIRE(tx.status().queued_sdus == 9);
+                REQUIRE(tx.send(1000) == 0);
+                REQUIRE(tx.send(1000) == -ENOBUFS);
+        }
+
+        SECTION("SDUs")
+        {
+                conf.tx_queue_max_sdus = 4;
+                tx_entity tx(conf);
+
+                for (auto i = 0; i < 4; i++) {
+                        REQUIRE(tx.send(10) == 0);
+                }
+
+                REQUIRE(tx.send(10) == -ENOBUFS);
+
+                REQUIRE(tx.build(1500) > 0);
+                REQUIRE(tx.status().queued_sdus == 0);
+                REQUIRE(tx.status().queued_bytes == 0);
+                REQUIRE(tx.send(10) == 0);
+        }
+}
+
+TEST_CASE("TX queue watermarks", "[txq]")
+{
+        using type = ::rlc_event::rlc_event_type;
+
+        auto conf = um_config();
+
+        conf.tx_queue_high_bytes = 5000;
+        conf.tx_queue_low_bytes = 2000;
+
+        tx_entity tx(conf);
+
+        for (auto i = 0; i < 4; i++) {
+                REQUIRE(tx.send(1000) == 0);
+        }
+
+        REQUIRE(tx.events.empty());
+
+        /* The upper layer is told once, and may keep sending */
+        REQUIRE(tx.send(1000) == 0);
+        REQUIRE(tx.send(1000) == 0);
+        REQUIRE(tx.events == std::vector<type>{type::RLC_EVENT_TX_PAUSE});
+
+        /* Down to 3000 bytes, still above the low watermark */
+        REQUIRE(tx.build(3100) > 0);
+        REQUIRE(tx.status().queued_bytes == 3000);
+        REQUIRE(tx.events.size() == 1);
+
+        REQUIRE(tx.build(1050) > 0);
+        REQUIRE(tx.status().queued_bytes == 2000);
+        REQUIRE(tx.events == std::vector<type>{type::RLC_EVENT_TX_PAUSE,
+                                               type::RLC_EVENT_TX_RESUME});
+
+        /* Resetting the entity empties the queue */
+        for (auto i = 0; i < 4; i++) {
+                REQUIRE(tx.send(1000) == 0);
+        }
+
+        REQUIRE(tx.events.size() == 3);
+        REQUIRE(::rlc_reset(&tx.ctx) == 0);
+        REQUIRE(tx.events.back() == type::RLC_EVENT_TX_RESUME);
+        REQUIRE(tx.status().queued_bytes == 0);
+}
+
+TEST_CASE("TX queue management", "[txq]")
+{
+        using type = ::rlc_event::rlc_event_type;
+
+        constexpr std::size_t backlog = 100;
+        constexpr std::size_t sdu_size = 100;
+        ::rlc_latency latency;
+        ::rlc_tx_aqm_stats stats;
+        ::rlc_vclock vclock;
+
+        auto conf = um_config();
+
+        conf.aqm_target_us = 5000;
+        conf.aqm_interval_us = 100000;
+
+        REQUIRE(::rlc_vclock_init(&vclock, 0) == 0);
+
+        /* A standing queue of `backlog` SDUs, with one SDU arriving and one
+         * leaving every millisecond, so that it would never drain by
+         * itself */
+        auto run = [&](tx_entity &tx) {
+                REQUIRE(::rlc_vclock_attach(&tx.ctx, &vclock) == 0);
+                ::rlc_latency_attach(&tx.ctx, &latency);
+
+                for (std::size_t i = 0; i < backlog; i++) {
+                        REQUIRE(tx.send(sdu_size) == 0);
+                }
+
+                for (auto i = 0; i < 5000; i++) {
+                        ::rlc_time_advance(&vclock, 1000);
+                        REQUIRE(tx.send(sdu_size) == 0);
+                        (void)tx.build(sdu_size + 1);
+                }
+
+                ::rlc_tx_aqm_stats_get(&tx.ctx, &stats);
+                ::rlc_latency_snapshot(&tx.ctx, &latency, false);
+                ::rlc_latency_attach(&tx.ctx, nullptr);
+        };
+
+        SECTION("Drop")
+        {
+                tx_entity tx(conf);
+
+                run(tx);
+
+                REQUIRE(stats.dropped > 0);
+                REQUIRE(stats.marked == 0);
+                REQUIRE(tx.aqm_dropped == stats.dropped);
+                REQUIRE(latency.hist[::RLC_LATENCY_TX_DROP].count ==
+                        stats.dropped);
+
+                /* The standing queue is gone */
+                REQUIRE(stats.sojourn_us <= conf.aqm_target_us);
+                REQUIRE_FALSE(stats.dropping);
+                REQUIRE(tx.status().queued_sdus < 10);
+        }
+
+        SECTION("Mark")
+        {
+                conf.aqm_action = ::RLC_AQM_MARK;
+                tx_entity tx(conf);
+
+                run(tx);
+
+                REQUIRE(stats.marked > 0);
+                REQUIRE(stats.dropped == 0);
+                REQUIRE(tx.aqm_dropped == 0);
+                REQUIRE(static_cast<std::size_t>(std::count(
+                                tx.events.begin(), tx.events.end(),
+                                type::RLC_EVENT_TX_MARK)) == stats.marked);
+
+                /* Nothing is taken out of the queue, so marking goes on */
+                REQUIRE(stats.dropping);
+                REQUIRE(tx.status().queued_sdus >= backlog);
+                REQUIRE(::rlc_hist_value_at(
+                                &latency.hist[::RLC_LATENCY_TX_QUEUE], 0.5) >
+                        conf.aqm_target_us);
+        }
+
+        SECTION("Disabled")
+        {
+                conf.aqm_target_us = 0;
+                tx_entity tx(conf);
+
+                run(tx);
+
+                REQUIRE(stats.dropped == 0);
+                REQUIRE(stats.marked == 0);
+                REQUIRE(tx.events.empty());
+        }
+
+        REQUIRE(::rlc_vclock_deinit(&vclock) == 0);
+}
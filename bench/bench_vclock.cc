@@ -0,0 +1,192 @@
+
+#include <cstdio>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+
+#include <gabs/alloc/std.hh>
+
+#include <rlc/rlc.h>
+#include <rlc/vclock.h>
+
+#include "channel.hh"
+#include "loopback.hh"
+
+inline gabs::memory::allocator alloc;
+
+namespace
+{
+
+::rlc_config am_config()
+{
+        ::rlc_config conf = {};
+
+        conf.type = ::RLC_AM;
+        conf.window_size = 4096;
+        conf.pdu_without_poll_max = 16;
+        conf.byte_without_poll_max = 16000;
+        conf.time_reassembly_us = 35000;
+        conf.time_poll_retransmit_us = 45000;
+        conf.time_status_prohibit_us = 10000;
+        conf.max_retx_threshhold = 16;
+        conf.sn_width = ::RLC_SN_18BIT;
+
+        return conf;
+}
+
+/* Timer that records when it fires */
+struct probe {
+        ::rlc_timer timer;
+        std::vector<std::uint64_t> *fired;
+        ::rlc_vclock *vclock;
+        std::uint32_t period_us;
+        bool active;
+
+        static void alarm(::rlc_timer *timer, ::rlc_context *)
+        {
+                auto self = reinterpret_cast<probe *>(timer);
+
+                self->fired->push_back(::rlc_vclock_now_us(self->vclock));
+                self->active = ::rlc_timer_active(timer);
+
+                if (self->period_us != 0) {
+                        (void)::rlc_timer_start(timer, self->period_us);
+                }
+        }
+};
+
+/* A minute of traffic at an SDU per millisecond over a lossy link */
+bench::loopback::stats minute_of_traffic(std::uint32_t seed)
+{
+        ::rlc_vclock vclock;
+        bench::channel_config link;
+
+        link.loss = 0.02;
+        link.burst_loss = 0.5;
+        link.enter_burst = 0.002;
+        link.leave_burst = 0.2;
+        link.delay = std::chrono::milliseconds(5);
+        link.jitter = std::chrono::milliseconds(1);
+
+        REQUIRE(::rlc_vclock_init(&vclock, 0) == 0);
+
+        {
+                bench::loopback lb(alloc, am_config(), link, seed);
+
+                lb.set_virtual_time(&vclock);
+
+                for (auto i = 0; i < 60000; i++) {
+                        lb.send(500);
+                        lb.pump(1500);
+                        ::rlc_time_advance(&vclock, 1000);
+                }
+
+                REQUIRE(lb.run(1500, std::chrono::seconds(10)));
+
+                auto stats = lb.get_stats();
+
+                REQUIRE(::rlc_vclock_now_us(&vclock) >= 60000000);
+
+                return stats;
+        }
+}
+
+}; // namespace
+
+TEST_CASE("Virtual clock timers", "[vclock]")
+{
+        ::rlc_vclock vclock;
+        std::vector<std::uint64_t> fired[3];
+        probe probes[3];
+
+        REQUIRE(::rlc_vclock_init(&vclock, 1000) == 0);
+
+        {
+                bench::loopback lb(alloc, am_config(), 0, 1234);
+                auto ctx = lb.context(0);
+
+                lb.set_virtual_time(&vclock);
+
+                for (auto i = 0; i < 3; i++) {
+                        probes[i] = {};
+                        probes[i].fired = &fired[i];
+                        probes[i].vclock = &vclock;
+
+                        REQUIRE(::rlc_timer_install(&probes[i].timer,
+                                                    probe::alarm, ctx) == 0);
+                }
+
+                std::uint64_t due;
+                REQUIRE(!::rlc_vclock_next_due(&vclock, &due));
+
+                REQUIRE(::rlc_timer_start(&probes[0].timer, 300) == 0);
+                REQUIRE(::rlc_timer_start(&probes[1].timer, 100) == 0);
+                REQUIRE(::rlc_timer_start(&probes[2].timer, 200) == 0);
+
+                REQUIRE(::rlc_vclock_next_due(&vclock, &due));
+                REQUIRE(due == 1100);
+
+                ::rlc_time_advance(&vclock, 150);
+
+                REQUIRE(::rlc_vclock_now_us(&vclock) == 1150);
+                REQUIRE(fired[1] == std::vector<std::uint64_t>{1100});
+                REQUIRE(probes[1].active);
+                REQUIRE(!::rlc_timer_active(&probes[1].timer));
+                REQUIRE(::rlc_timer_active(&probes[2].timer));
+
+                /* Stopped and restarted timers */
+                REQUIRE(::rlc_timer_stop(&probes[2].timer) == 0);
+                REQUIRE(::rlc_timer_restart(&probes[0].timer, 50) == 0);
+
+                ::rlc_time_advance(&vclock, 1000);
+
+                REQUIRE(fired[0] == std::vector<std::uint64_t>{1200});
+                REQUIRE(fired[2].empty());
+                REQUIRE(::rlc_vclock_now_us(&vclock) == 2150);
+
+                /* Rearmed from the callback, and fired within the same
+                 * advance */
+                probes[1].period_us = 100;
+                REQUIRE(::rlc_timer_start(&probes[1].timer, 100) == 0);
+
+                ::rlc_time_advance(&vclock, 1000);
+
+                REQUIRE(fired[1].size() == 11);
+                REQUIRE(fired[1].back() == 3150);
+                REQUIRE(::rlc_timer_active(&probes[1].timer));
+
+                /* Detaching stops the timers of the context */
+                REQUIRE(::rlc_vclock_attach(ctx, nullptr) == 0);
+                REQUIRE(!::rlc_vclock_next_due(&vclock, &due));
+
+                for (auto &p : probes) {
+                        (void)::rlc_timer_uninstall(&p.timer);
+                }
+        }
+
+        REQUIRE(::rlc_vclock_deinit(&vclock) == 0);
+}
+
+TEST_CASE("AM recovery in virtual time", "[vclock]")
+{
+        auto start = bench::clock::now();
+        auto first = minute_of_traffic(1234);
+        auto wall = std::chrono::duration<double>(bench::clock::now() - start);
+
+        auto second = minute_of_traffic(1234);
+
+        /* The same seed gives the same run, down to every latency */
+        REQUIRE(first.sdus_delivered == first.sdus_sent);
+        REQUIRE(first.pdus_sent == second.pdus_sent);
+        REQUIRE(first.pdus_lost == second.pdus_lost);
+        REQUIRE(first.status_pdus == second.status_pdus);
+        REQUIRE(first.latency_us == second.latency_us);
+
+        auto summary = bench::summarize(first);
+
+        std::printf("60 s of traffic in %.2f s: %zu PDUs, %zu lost, retx "
+                    "%6.4f, status %6.4f, p50 %8.1f us, p99 %8.1f us\n",
+                    wall.count(), first.pdus_sent, first.pdus_lost,
+                    summary.retx_ratio, summary.status_ratio,
+                    summary.latency_p50_us, summary.latency_p99_us);
+}
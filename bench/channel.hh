@@ -0,0 +1,137 @@
+
+#ifndef RLC_BENCH_CHANNEL_HH__
+#define RLC_BENCH_CHANNEL_HH__
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+namespace bench
+{
+
+using clock = std::chrono::steady_clock;
+
+/**
+ * Impairments of one direction of a simulated link. Loss follows a
+ * Gilbert-Elliott model: the channel is either in the good or the bad state,
+ * moves between them with a fixed probability per PDU, and drops PDUs with
+ * the loss probability of its state. The default is a lossless channel
+ * without delay.
+ */
+struct channel_config {
+        double loss = 0;       /* Loss probability in the good state */
+        double burst_loss = 0; /* Loss probability in the bad state */
+        double enter_burst = 0; /* Good to bad transition probability */
+        double leave_burst = 1; /* Bad to good transition probability */
+
+        double duplicate = 0; /* Probability of delivering a PDU twice */
+
+        /* Probability of holding a PDU back by `reorder_delay` on top of the
+         * regular delay, so that later PDUs overtake it */
+        double reorder = 0;
+        clock::duration reorder_delay = clock::duration::zero();
+
+        clock::duration delay = clock::duration::zero();  /* One-way delay */
+        clock::duration jitter = clock::duration::zero(); /* Uniform, added */
+
+        /* Long run loss probability of the Gilbert-Elliott model */
+        double mean_loss() const
+        {
+                double bad = enter_burst + leave_burst > 0
+                                     ? enter_burst / (enter_burst + leave_burst)
+                                     : 0;
+
+                return (1 - bad) * loss + bad * burst_loss;
+        }
+};
+
+/**
+ * Draws the fate of each PDU sent over a channel. All randomness comes from
+ * a generator seeded at construction, so the same sequence of PDUs meets the
+ * same fate on every run.
+ */
+class channel
+{
+      public:
+        struct fate {
+                bool lost;
+                int copies; /* Number of copies delivered, 0 if lost */
+                clock::duration delay[2];
+        };
+
+        channel(const channel_config &conf, std::uint64_t seed)
+                : conf(conf), rng(seed)
+        {
+        }
+
+        const channel_config &config() const
+        {
+                return conf;
+        }
+
+        void configure(const channel_config &conf)
+        {
+                this->conf = conf;
+        }
+
+        fate next()
+        {
+                fate result = {};
+
+                /* The state is moved before the PDU is sent, so that the
+                 * first PDU of a burst is lost with the bad state
+                 * probability */
+                burst = burst ? !draw(conf.leave_burst)
+                              : draw(conf.enter_burst);
+
+                result.lost = draw(burst ? conf.burst_loss : conf.loss);
+                if (result.lost) {
+                        return result;
+                }
+
+                result.copies = draw(conf.duplicate) ? 2 : 1;
+
+                for (int i = 0; i < result.copies; i++) {
+                        result.delay[i] = delay();
+                }
+
+                return result;
+        }
+
+        bool in_burst() const
+        {
+                return burst;
+        }
+
+      private:
+        /* Every draw takes a value from the generator, even when the
+         * probability is 0 or 1, so that the sequence of fates only depends
+         * on the seed and the number of PDUs. */
+        bool draw(double probability)
+        {
+                return uniform(rng) < probability;
+        }
+
+        clock::duration delay()
+        {
+                auto result = conf.delay;
+
+                result += std::chrono::duration_cast<clock::duration>(
+                        conf.jitter * uniform(rng));
+
+                if (draw(conf.reorder)) {
+                        result += conf.reorder_delay;
+                }
+
+                return result;
+        }
+
+        channel_config conf;
+        std::mt19937_64 rng;
+        std::uniform_real_distribution<double> uniform{0.0, 1.0};
+        bool burst = false;
+};
+
+}; // namespace bench
+
+#endif /* RLC_BENCH_CHANNEL_HH__ */
@@ -0,0 +1,561 @@
+
+#ifndef RLC_BENCH_LOOPBACK_HH__
+#define RLC_BENCH_LOOPBACK_HH__
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <gabs/pbuf.h>
+#include <gabs/alloc/std.hh>
+
+#include <rlc/rlc.h>
+
+#include "channel.hh"
+#include "encode.h"
+
+namespace bench
+{
+
+class loopback;
+
+/* Standard layout, so that the context pointer given to the backend and the
+ * listener can be converted back to the endpoint. */
+struct endpoint {
+        ::rlc_context ctx;
+        loopback *owner;
+        int index;
+};
+
+/**
+ * Two RLC entities connected back to back. Endpoint 0 transmits SDUs, and
+ * endpoint 1 receives them. PDUs in either direction go through a simulated
+ * `channel`, seeded separately per direction, that may drop, duplicate, delay
+ * or reorder them. With loss feedback enabled, the sender is told about
+ * dropped PDUs through `rlc_tx_lost` once the one-way delay has passed, the
+ * way a MAC reports a transport block that HARQ gave up on.
+ */
+class loopback
+{
+      public:
+        struct stats {
+                std::size_t sdus_sent = 0;
+                std::size_t sdus_delivered = 0;
+                std::size_t sdu_bytes = 0; /* Bytes of the SDUs sent */
+                std::size_t pdus_sent = 0;
+                std::size_t pdus_lost = 0;
+                std::size_t pdus_duplicated = 0;
+                std::size_t data_bytes = 0;
+                std::size_t payload_bytes = 0; /* SDU bytes of data PDUs */
+                std::size_t status_pdus = 0;
+                std::size_t status_bytes = 0;
+                std::size_t delivered_bytes = 0;
+                std::vector<double> latency_us;
+
+                clock::time_point first_sent;
+                clock::time_point last_delivered;
+        };
+
+        loopback(const gabs::memory::allocator &alloc,
+                 const ::rlc_config &conf, double loss, std::uint32_t seed)
+                : loopback(alloc, conf, channel_config{loss}, seed)
+        {
+        }
+
+        loopback(const gabs::memory::allocator &alloc,
+                 const ::rlc_config &conf, const channel_config &link,
+                 std::uint32_t seed)
+                : alloc(alloc), conf(conf),
+                  channels{channel(link, seed), channel(link, seed + 1)}
+        {
+                for (int i = 0; i < 2; i++) {
+                        auto &ep = endpoints[i];
+
+                        ep.owner = this;
+                        ep.index = i;
+
+                        REQUIRE(::rlc_init(&ep.ctx, &backend, alloc, alloc) ==
+                                0);
+
+                        ::rlc_set_config(&ep.ctx, &this->conf);
+                        (void)::rlc_reset(&ep.ctx);
+
+                        REQUIRE(::rlc_attach_listener(&ep.ctx, on_event) == 0);
+                }
+        }
+
+        ~loopback()
+        {
+                for (auto &ep : endpoints) {
+                        ::rlc_detach_listener(&ep.ctx);
+                        (void)::rlc_deinit(&ep.ctx);
+                }
+
+                for (auto &inbox : inboxes) {
+                        for (auto &pdu : inbox) {
+                                ::gabs_pbuf_decref(pdu.buf);
+                        }
+                }
+        }
+
+        /* One-way delay of PDUs in both directions */
+        void set_delay(clock::duration delay)
+        {
+                std::lock_guard<std::mutex> guard(lock);
+
+                for (auto &chan : channels) {
+                        auto link = chan.config();
+
+                        link.delay = delay;
+                        chan.configure(link);
+                }
+        }
+
+        /* Impairments of PDUs in both directions */
+        void set_channel(const channel_config &link)
+        {
+                std::lock_guard<std::mutex> guard(lock);
+
+                for (auto &chan : channels) {
+                        chan.configure(link);
+                }
+        }
+
+        /* Report dropped PDUs to the endpoint that sent them */
+        void set_loss_feedback(bool enable)
+        {
+                std::lock_guard<std::mutex> guard(lock);
+                feedback = enable;
+        }
+
+        /* Queue an SDU of @p size bytes at endpoint 0 */
+        void send(std::size_t size)
+        {
+                std::uint32_t index;
+                ::gabs_pbuf buf;
+
+                size = std::max(size, sizeof(index));
+
+                {
+                        std::lock_guard<std::mutex> guard(lock);
+
+                        index = sent_at.size();
+                        sent_at.push_back(now());
+
+                        if (result.sdus_sent++ == 0) {
+                                result.first_sent = sent_at.back();
+                        }
+
+                        result.sdu_bytes += size;
+                }
+
+                std::vector<std::uint8_t> data(size, 0x5a);
+                std::memcpy(data.data(), &index, sizeof(index));
+
+                buf = ::gabs_pbuf_new(alloc, size);
+                REQUIRE(::gabs_pbuf_okay(buf));
+
+                ::gabs_pbuf_put(&buf, data.data(), data.size());
+
+                REQUIRE(::rlc_tx(&endpoints[0].ctx, buf, nullptr) == 0);
+                ::gabs_pbuf_decref(buf);
+        }
+
+        /* Answer pending TX requests with @p grant bytes each, and deliver
+         * PDUs in flight. Returns false if there was nothing to do. */
+        bool pump(std::size_t grant)
+        {
+                bool progress = answer(grant);
+
+                return deliver() || progress;
+        }
+
+        /* Answer pending TX requests with @p grant bytes each */
+        bool answer(std::size_t grant)
+        {
+                bool progress = false;
+
+                for (int i = 0; i < 2; i++) {
+                        bool req;
+
+                        {
+                                std::lock_guard<std::mutex> guard(lock);
+                                req = requested[i];
+                                requested[i] = false;
+                        }
+
+                        if (req) {
+                                (void)::rlc_tx_avail(&endpoints[i].ctx, grant);
+                                progress = true;
+                        }
+                }
+
+                return progress;
+        }
+
+        /* Deliver PDUs that have been in flight for the one-way delay, and
+         * report losses that are due */
+        bool deliver()
+        {
+                bool progress = false;
+
+                for (int i = 0; i < 2; i++) {
+                        std::vector<::gabs_pbuf> pdus;
+                        std::vector<::rlc_pdu_handle> handles;
+                        auto now = this->now();
+
+                        {
+                                std::lock_guard<std::mutex> guard(lock);
+                                auto &inbox = inboxes[i];
+                                auto &lost = losses[i];
+
+                                while (!inbox.empty() &&
+                                       inbox.front().due <= now) {
+                                        pdus.push_back(inbox.front().buf);
+                                        inbox.pop_front();
+                                }
+
+                                while (!lost.empty() &&
+                                       lost.front().due <= now) {
+                                        handles.push_back(lost.front().handle);
+                                        lost.pop_front();
+                                }
+                        }
+
+                        for (auto buf : pdus) {
+                                ::rlc_rx_submit(&endpoints[i].ctx, buf);
+                                progress = true;
+                        }
+
+                        for (auto handle : handles) {
+                                (void)::rlc_tx_lost(&endpoints[i].ctx, handle);
+                                progress = true;
+                        }
+                }
+
+                return progress;
+        }
+
+        /* Pump until every SDU sent is delivered, or @p timeout passes */
+        bool run(std::size_t grant, clock::duration timeout)
+        {
+                auto deadline = now() + timeout;
+
+                while (now() < deadline) {
+                        {
+                                std::lock_guard<std::mutex> guard(lock);
+                                if (result.sdus_delivered == result.sdus_sent) {
+                                        return true;
+                                }
+                        }
+
+                        if (!pump(grant)) {
+                                idle();
+                        }
+                }
+
+                return false;
+        }
+
+        /* Run both endpoints on @p vclock, which must outlive the loopback.
+         * Delays and timeouts are then in virtual time, and `run` skips
+         * ahead to the next event instead of waiting for it. */
+        void set_virtual_time(::rlc_vclock *vclock)
+        {
+                for (auto &ep : endpoints) {
+                        REQUIRE(::rlc_vclock_attach(&ep.ctx, vclock) == 0);
+                }
+
+                this->vclock = vclock;
+        }
+
+        clock::time_point now() const
+        {
+                if (vclock == nullptr) {
+                        return clock::now();
+                }
+
+                return clock::time_point(std::chrono::microseconds(
+                        ::rlc_vclock_now_us(vclock)));
+        }
+
+        stats get_stats()
+        {
+                std::lock_guard<std::mutex> guard(lock);
+                return result;
+        }
+
+        ::rlc_context *context(int index)
+        {
+                return &endpoints[index].ctx;
+        }
+
+      private:
+        /* Rounded up, so that advancing to it makes @p time due */
+        static std::uint64_t to_us(clock::time_point time)
+        {
+                return std::chrono::ceil<std::chrono::microseconds>(
+                               time.time_since_epoch())
+                        .count();
+        }
+
+        /* Nothing to do: wait for timers, or in virtual time, move on to
+         * the next timer or PDU that is due */
+        void idle()
+        {
+                if (vclock == nullptr) {
+                        std::this_thread::sleep_for(
+                                std::chrono::microseconds(100));
+                        return;
+                }
+
+                auto now_us = ::rlc_vclock_now_us(vclock);
+                auto next_us = UINT64_MAX;
+                std::uint64_t due_us;
+
+                if (::rlc_vclock_next_due(vclock, &due_us)) {
+                        next_us = std::min(next_us, due_us);
+                }
+
+                {
+                        std::lock_guard<std::mutex> guard(lock);
+
+                        for (int i = 0; i < 2; i++) {
+                                if (!inboxes[i].empty()) {
+                                        next_us = std::min(
+                                                next_us,
+                                                to_us(inboxes[i].front().due));
+                                }
+
+                                if (!losses[i].empty()) {
+                                        next_us = std::min(
+                                                next_us,
+                                                to_us(losses[i].front().due));
+                                }
+                        }
+                }
+
+                /* Nothing scheduled at all, let time pass towards the
+                 * deadline of `run` */
+                if (next_us == UINT64_MAX) {
+                        next_us = now_us + 100;
+                }
+
+                ::rlc_time_advance(vclock, std::max(next_us, now_us) - now_us);
+        }
+
+        static endpoint *from_ctx(::rlc_context *ctx)
+        {
+                return reinterpret_cast<endpoint *>(ctx);
+        }
+
+        static ::rlc_errno on_submit(::rlc_context *ctx, ::gabs_pbuf buf,
+                                     ::rlc_pdu_handle handle)
+        {
+                auto ep = from_ctx(ctx);
+                auto self = ep->owner;
+                std::uint8_t first = 0;
+                auto size = ::gabs_pbuf_size(buf);
+                auto now = self->now();
+                std::uint32_t sn;
+                ::rlc_seg seg;
+
+                (void)::gabs_pbuf_copy(buf, &first, 0, 1);
+
+                std::lock_guard<std::mutex> guard(self->lock);
+
+                self->result.pdus_sent++;
+
+                /* D/C bit is zero for control (status) PDUs */
+                if (self->conf.type == ::RLC_AM && (first & 0x80) == 0) {
+                        self->result.status_pdus++;
+                        self->result.status_bytes += size;
+                } else {
+                        self->result.data_bytes += size;
+
+                        if (::rlc_pdu_handle_parse(handle, &sn, &seg)) {
+                                self->result.payload_bytes +=
+                                        seg.end - seg.start;
+                        }
+                }
+
+                auto fate = self->channels[ep->index].next();
+
+                if (fate.lost) {
+                        self->result.pdus_lost++;
+                        ::gabs_pbuf_decref(buf);
+
+                        if (self->feedback) {
+                                auto due = now +
+                                           self->channels[ep->index]
+                                                   .config()
+                                                   .delay;
+
+                                self->losses[ep->index].push_back(
+                                        {due, handle});
+                        }
+
+                        return 0;
+                }
+
+                if (fate.copies > 1) {
+                        auto copy = ::gabs_pbuf_clone(buf, 0, size,
+                                                      self->alloc);
+
+                        if (::gabs_pbuf_okay(copy)) {
+                                self->result.pdus_duplicated++;
+                                self->enqueue(1 - ep->index,
+                                              {now + fate.delay[1], copy});
+                        }
+                }
+
+                self->enqueue(1 - ep->index, {now + fate.delay[0], buf});
+
+                return 0;
+        }
+
+        static ::rlc_errno on_request(::rlc_context *ctx)
+        {
+                auto ep = from_ctx(ctx);
+                std::lock_guard<std::mutex> guard(ep->owner->lock);
+
+                ep->owner->requested[ep->index] = true;
+                return 0;
+        }
+
+        static void on_event(::rlc_context *ctx, const ::rlc_event *event)
+        {
+                auto self = from_ctx(ctx)->owner;
+                std::uint32_t index = 0;
+
+                if (event->type != ::rlc_event::RLC_EVENT_RX_DONE) {
+                        return;
+                }
+
+                auto buf = event->rx_done.sdu->rx.buffer.buf;
+                auto size = ::gabs_pbuf_size(buf);
+
+                (void)::gabs_pbuf_copy(buf, &index, 0, sizeof(index));
+
+                auto now = self->now();
+                std::lock_guard<std::mutex> guard(self->lock);
+
+                if (index >= self->sent_at.size()) {
+                        return;
+                }
+
+                auto latency = std::chrono::duration<double, std::micro>(
+                        now - self->sent_at[index]);
+
+                self->result.sdus_delivered++;
+                self->result.delivered_bytes += size;
+                self->result.last_delivered = now;
+                self->result.latency_us.push_back(latency.count());
+        }
+
+        struct in_flight {
+                clock::time_point due;
+                ::gabs_pbuf buf;
+        };
+
+        struct lost_pdu {
+                clock::time_point due;
+                ::rlc_pdu_handle handle;
+        };
+
+        /* Keep the inbox ordered by due time, PDUs due at the same time
+         * staying in the order they were sent */
+        void enqueue(int index, in_flight pdu)
+        {
+                auto &inbox = inboxes[index];
+                auto at = std::upper_bound(
+                        inbox.begin(), inbox.end(), pdu.due,
+                        [](clock::time_point due, const in_flight &other) {
+                                return due < other.due;
+                        });
+
+                inbox.insert(at, pdu);
+        }
+
+        static constexpr ::rlc_backend backend = {
+                nullptr,
+                on_request,
+                on_submit,
+        };
+
+        const gabs::memory::allocator &alloc;
+        ::rlc_config conf;
+
+        std::mutex lock;
+        std::array<channel, 2> channels; /* Indexed by the sending endpoint */
+
+        std::array<endpoint, 2> endpoints;
+        std::array<std::deque<in_flight>, 2> inboxes;
+        std::array<std::deque<lost_pdu>, 2> losses;
+        bool feedback = false;
+        ::rlc_vclock *vclock = nullptr;
+        std::array<bool, 2> requested = {false, false};
+
+        std::vector<clock::time_point> sent_at;
+        stats result;
+};
+
+/* Value at fraction @p q of the sorted @p values */
+inline double percentile(std::vector<double> values, double q)
+{
+        if (values.empty()) {
+                return 0;
+        }
+
+        std::sort(values.begin(), values.end());
+        return values[static_cast<std::size_t>(q * (values.size() - 1))];
+}
+
+/* Figures of merit of a run, for comparing ARQ behavior across changes */
+struct summary {
+        double goodput_mbps;   /* SDU bytes delivered per second of the run */
+        double retx_ratio;     /* SDU bytes retransmitted per SDU byte sent */
+        double status_ratio;   /* Status bytes per SDU byte delivered */
+        double latency_p50_us; /* SDU delivery latency */
+        double latency_p99_us;
+};
+
+inline summary summarize(const loopback::stats &stats)
+{
+        summary result = {};
+        auto elapsed = std::chrono::duration<double>(stats.last_delivered -
+                                                     stats.first_sent)
+                               .count();
+
+        if (elapsed > 0) {
+                result.goodput_mbps = stats.delivered_bytes * 8 / elapsed / 1e6;
+        }
+
+        if (stats.sdu_bytes > 0) {
+                result.retx_ratio =
+                        (static_cast<double>(stats.payload_bytes) -
+                         static_cast<double>(stats.sdu_bytes)) /
+                        stats.sdu_bytes;
+        }
+
+        if (stats.delivered_bytes > 0) {
+                result.status_ratio = static_cast<double>(stats.status_bytes) /
+                                      stats.delivered_bytes;
+        }
+
+        result.latency_p50_us = percentile(stats.latency_us, 0.5);
+        result.latency_p99_us = percentile(stats.latency_us, 0.99);
+
+        return result;
+}
+
+}; // namespace bench
+
+#endif /* RLC_BENCH_LOOPBACK_HH__ */
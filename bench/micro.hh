@@ -0,0 +1,306 @@
+
+#ifndef RLC_BENCH_MICRO_HH__
+#define RLC_BENCH_MICRO_HH__
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Shared harness of the standalone microbenchmarks. A case is timed in
+ * batches: `setup` prepares a batch outside of the timed region, and `run`
+ * does a fixed number of operations on it. The median and minimum time per
+ * operation over a few samples are reported, as JSON on standard output or
+ * in a file, with a summary on standard error.
+ */
+
+namespace bench::micro
+{
+
+using clock = std::chrono::steady_clock;
+
+constexpr std::size_t sample_count = 5;
+
+/* Keeps the compiler from dropping results that are never read */
+inline volatile std::size_t sink;
+
+struct options {
+        clock::duration min_time = std::chrono::milliseconds(200);
+        const char *filter = nullptr;
+        const char *path = nullptr;
+
+        bool selected(const std::string &name) const
+        {
+                return filter == nullptr ||
+                       name.find(filter) != std::string::npos;
+        }
+};
+
+struct timing {
+        std::size_t iterations;
+        double ns_per_op;     /* Median of the samples */
+        double ns_per_op_min; /* Fastest sample */
+};
+
+struct result {
+        std::string name;
+
+        /* Written as strings and numbers respectively, in order */
+        std::vector<std::pair<const char *, std::string>> labels;
+        std::vector<std::pair<const char *, double>> metrics;
+
+        timing time;
+};
+
+inline bool usage(const char *prog)
+{
+        std::fprintf(stderr,
+                     "Usage: %s [--filter SUBSTR] [--min-time MS] "
+                     "[--out FILE]\n",
+                     prog);
+        return false;
+}
+
+/* Parse the common options, `--filter SUBSTR`, `--min-time MS` and
+ * `--out FILE`. Returns false and prints the usage on error. */
+inline bool parse_options(int argc, char **argv, options &opts)
+{
+        for (int i = 1; i < argc; i += 2) {
+                if (i + 1 >= argc) {
+                        return usage(argv[0]);
+                }
+
+                if (std::strcmp(argv[i], "--filter") == 0) {
+                        opts.filter = argv[i + 1];
+                } else if (std::strcmp(argv[i], "--min-time") == 0) {
+                        opts.min_time = std::chrono::milliseconds(
+                                std::atol(argv[i + 1]));
+                } else if (std::strcmp(argv[i], "--out") == 0) {
+                        opts.path = argv[i + 1];
+                } else {
+                        return usage(argv[0]);
+                }
+        }
+
+        return true;
+}
+
+/* Time @p run, which does @p ops operations on a batch prepared by
+ * @p setup */
+inline timing measure(const std::function<void()> &setup,
+                      const std::function<void()> &run, std::size_t ops,
+                      clock::duration min_time)
+{
+        std::vector<double> samples;
+        std::size_t iterations = 0;
+
+        /* Warm up caches and branch predictors */
+        setup();
+        run();
+
+        for (std::size_t s = 0; s < sample_count; s++) {
+                clock::duration elapsed = clock::duration::zero();
+                std::size_t done = 0;
+
+                while (elapsed < min_time / sample_count) {
+                        setup();
+
+                        auto start = clock::now();
+                        run();
+                        elapsed += clock::now() - start;
+
+                        done += ops;
+                }
+
+                iterations += done;
+                samples.push_back(
+                        std::chrono::duration<double, std::nano>(elapsed)
+                                .count() /
+                        done);
+        }
+
+        std::sort(samples.begin(), samples.end());
+
+        return timing{iterations, samples[sample_count / 2], samples[0]};
+}
+
+/*
+ * Hardware cache misses of the calling thread, counted with perf events.
+ * Counting needs a PMU and a perf_event_paranoid of at most 2, so this is not
+ * available everywhere, e.g. in most virtual machines. `okay` tells.
+ */
+class cache_misses
+{
+      public:
+        cache_misses()
+        {
+#ifdef __linux__
+                ::perf_event_attr attr = {};
+
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.size = sizeof(attr);
+                attr.config = PERF_COUNT_HW_CACHE_MISSES;
+                attr.disabled = 1;
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+
+                fd = static_cast<int>(
+                        ::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+        }
+
+        ~cache_misses()
+        {
+#ifdef __linux__
+                if (fd >= 0) {
+                        (void)::close(fd);
+                }
+#endif
+        }
+
+        cache_misses(const cache_misses &) = delete;
+        cache_misses &operator=(const cache_misses &) = delete;
+
+        bool okay() const
+        {
+                return fd >= 0;
+        }
+
+        /* Misses per operation of @p run, the median of a few batches
+         * prepared by @p setup. Negative if counting is not available. */
+        double measure(const std::function<void()> &setup,
+                       const std::function<void()> &run, std::size_t ops)
+        {
+                std::vector<double> samples;
+
+                if (!okay()) {
+                        return -1;
+                }
+
+                for (std::size_t s = 0; s < sample_count; s++) {
+                        setup();
+
+                        start();
+                        run();
+                        samples.push_back(static_cast<double>(stop()) / ops);
+                }
+
+                std::sort(samples.begin(), samples.end());
+
+                return samples[sample_count / 2];
+        }
+
+      private:
+        int fd = -1;
+
+        void start()
+        {
+#ifdef __linux__
+                (void)::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                (void)::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+        }
+
+        std::uint64_t stop()
+        {
+                std::uint64_t count = 0;
+
+#ifdef __linux__
+                (void)::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+                if (::read(fd, &count, sizeof(count)) != sizeof(count)) {
+                        count = 0;
+                }
+#endif
+
+                return count;
+        }
+};
+
+inline void write_json(std::FILE *out, const std::vector<result> &results,
+                       const options &opts,
+                       const std::vector<std::pair<const char *, double>>
+                               &context)
+{
+        std::fprintf(out, "{\n  \"context\": {\n");
+        std::fprintf(out, "    \"samples\": %zu,\n", sample_count);
+        std::fprintf(out, "    \"min_time_ms\": %lld,\n",
+                     static_cast<long long>(
+                             std::chrono::duration_cast<
+                                     std::chrono::milliseconds>(opts.min_time)
+                                     .count()));
+
+        for (auto &[key, value] : context) {
+                std::fprintf(out, "    \"%s\": %.10g,\n", key, value);
+        }
+
+#ifdef NDEBUG
+        std::fprintf(out, "    \"build\": \"release\"\n");
+#else
+        std::fprintf(out, "    \"build\": \"debug\"\n");
+#endif
+        std::fprintf(out, "  },\n  \"benchmarks\": [");
+
+        for (std::size_t i = 0; i < results.size(); i++) {
+                auto &r = results[i];
+
+                std::fprintf(out, "%s\n    {", i == 0 ? "" : ",");
+                std::fprintf(out, "\"name\": \"%s\", ", r.name.c_str());
+
+                for (auto &[key, value] : r.labels) {
+                        std::fprintf(out, "\"%s\": \"%s\", ", key,
+                                     value.c_str());
+                }
+
+                for (auto &[key, value] : r.metrics) {
+                        std::fprintf(out, "\"%s\": %.10g, ", key, value);
+                }
+
+                std::fprintf(out, "\"iterations\": %zu, ", r.time.iterations);
+                std::fprintf(out, "\"ns_per_op\": %.3f, ", r.time.ns_per_op);
+                std::fprintf(out, "\"ns_per_op_min\": %.3f}",
+                             r.time.ns_per_op_min);
+        }
+
+        std::fprintf(out, "\n  ]\n}\n");
+}
+
+/* Write @p results to the file given in @p opts, or standard output */
+inline int finish(const std::vector<result> &results, const options &opts,
+                  const std::vector<std::pair<const char *, double>> &context)
+{
+        std::FILE *out = stdout;
+
+        if (opts.path != nullptr) {
+                out = std::fopen(opts.path, "w");
+                if (out == nullptr) {
+                        std::perror(opts.path);
+                        return 1;
+                }
+        }
+
+        write_json(out, results, opts, context);
+
+        if (out != stdout) {
+                (void)std::fclose(out);
+        }
+
+        return 0;
+}
+
+}; // namespace bench::micro
+
+#endif /* RLC_BENCH_MICRO_HH__ */
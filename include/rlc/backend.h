@@ -6,14 +6,34 @@
 
 #include <rlc/utils.h>
 #include <rlc/pdu.h>
+#include <rlc/tx.h>
 
 RLC_BEGIN_DECL
 
 struct rlc_context;
 
+/** @brief Caller supplied memory that PDUs are written to, see `rlc_tx_build`
+ */
+struct rlc_backend_build {
+        uint8_t *dst;
+        size_t size;
+        size_t used;
+
+        struct rlc_tx_pdu_info *pdus;
+        size_t pdu_max;
+        size_t pdu_count;
+
+        bool pending; /* Data is left for another opportunity */
+};
+
 struct rlc_backend {
         rlc_errno (*tx_submit)(struct rlc_context *, gabs_pbuf);
         rlc_errno (*tx_request)(struct rlc_context *);
+
+        /* Used instead of `tx_submit` if set. The handle can be given to
+         * `rlc_tx_lost` if the lower layer fails to deliver the PDU. */
+        rlc_errno (*tx_submit_handle)(struct rlc_context *, gabs_pbuf,
+                                      rlc_pdu_handle);
 };
 
 /**
@@ -30,8 +50,59 @@ struct rlc_backend {
 ptrdiff_t rlc_backend_tx_submit(struct rlc_context *ctx, struct rlc_pdu *pdu,
                                 gabs_pbuf buf);
 
+/**
+ * @brief Submit the range of the SDU buffer @p buf described by @p pdu.
+ *
+ * Unlike `rlc_backend_tx_submit`, this does not steal a reference to @p buf.
+ *
+ * @return ptrdiff_t
+ * @retval >= 0 Written bytes
+ * @retval <0 Negative `rlc_errno` code.
+ */
+ptrdiff_t rlc_backend_tx_submit_sdu(struct rlc_context *ctx,
+                                    struct rlc_pdu *pdu, gabs_pbuf buf);
+
+/**
+ * @brief Get the memory that the payload of @p pdu goes to when building into
+ * caller memory, so that it can be written in place and submitted with
+ * `rlc_backend_tx_submit_payload`.
+ *
+ * @param avail Receives the number of payload bytes that fit
+ * @return uint8_t* NULL if not building into caller memory
+ */
+uint8_t *rlc_backend_tx_payload(struct rlc_context *ctx,
+                                const struct rlc_pdu *pdu, size_t *avail);
+
+/**
+ * @brief Submit @p pdu, with @p size bytes of payload already written to the
+ * memory given by `rlc_backend_tx_payload`.
+ *
+ * @return ptrdiff_t
+ * @retval >= 0 Written bytes
+ * @retval <0 Negative `rlc_errno` code.
+ */
+ptrdiff_t rlc_backend_tx_submit_payload(struct rlc_context *ctx,
+                                        struct rlc_pdu *pdu, size_t size);
+
+/**
+ * @brief Check if another PDU can be submitted. This is only false when
+ * building into caller memory that has no room for more PDUs.
+ */
+bool rlc_backend_tx_room(struct rlc_context *ctx);
+
+/**
+ * @brief Check if @p pdu, carrying `pdu->size` payload bytes, can be
+ * submitted. This is only false when building into caller memory that has no
+ * room for it, and is checked before any state is changed for the PDU.
+ */
+bool rlc_backend_tx_fits(struct rlc_context *ctx, const struct rlc_pdu *pdu);
+
 /**
  * @brief Request a transmission opportunity from the lower layer.
+ *
+ * Only one request is outstanding at a time; further requests are dropped
+ * until the lower layer answers with `rlc_tx_avail`. Must be called with the
+ * context lock held.
  */
 void rlc_backend_tx_request(struct rlc_context *ctx);
 
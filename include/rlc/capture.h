@@ -0,0 +1,103 @@
+
+#ifndef RLC_CAPTURE_H__
+#define RLC_CAPTURE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <gabs/alloc.h>
+
+#include <rlc/utils.h>
+#include <rlc/errno.h>
+
+RLC_BEGIN_DECL
+
+struct rlc_context;
+
+/** @brief Direction of a captured PDU, relative to the capturing entity */
+enum rlc_capture_dir {
+        RLC_CAPTURE_TX,
+        RLC_CAPTURE_RX,
+};
+
+/**
+ * @brief Ring of captured PDUs.
+ *
+ * Any number of entities may capture into the same ring without taking a
+ * lock. A PDU is dropped if the ring is full, so that capturing never waits
+ * on the reader. Only one thread may drain the ring at a time.
+ */
+struct rlc_capture {
+        uint8_t *slots;
+        size_t slot_size;
+        uint32_t slot_mask; /* Number of slots minus one */
+        uint32_t snaplen;   /* Bytes kept of each PDU, header included */
+
+        /* Transmitted PDUs are downlink, i.e. the capturing entities are on
+         * the network side */
+        bool tx_downlink;
+
+        uint64_t head; /* Next slot to be claimed by a producer */
+        uint64_t tail; /* Next slot to be drained */
+
+        uint64_t dropped; /* PDUs not captured because the ring was full */
+
+        const gabs_allocator_h *allocator;
+};
+
+/**
+ * @brief Sink for `rlc_capture_drain_pcap`
+ *
+ * @return int 0 on success, negative `rlc_errno` code to stop draining.
+ */
+typedef int (*rlc_capture_write)(void *arg, const void *data, size_t size);
+
+/**
+ * @brief Initialize @p cap with @p slot_count slots, keeping the first
+ * @p snaplen bytes of each PDU.
+ *
+ * @param slot_count Number of slots, must be a power of two
+ * @param tx_downlink Whether transmitted PDUs are labeled downlink in the
+ * capture
+ */
+rlc_errno rlc_capture_init(struct rlc_capture *cap,
+                           const gabs_allocator_h *allocator,
+                           size_t slot_count, size_t snaplen,
+                           bool tx_downlink);
+
+void rlc_capture_deinit(struct rlc_capture *cap);
+
+/**
+ * @brief Capture every PDU submitted to or received from the lower layer by
+ * @p ctx into @p cap, or stop capturing if @p cap is NULL.
+ *
+ * @param id Written as the UE ID of the PDUs, to tell apart entities capturing
+ * into the same ring
+ */
+void rlc_capture_attach(struct rlc_context *ctx, struct rlc_capture *cap,
+                        uint16_t id);
+
+/**
+ * @brief Write the pcap file header.
+ *
+ * PDUs are written as UDP datagrams over IPv4 using the `rlc-nr` framing of
+ * Wireshark, which is decoded when the `rlc_nr_udp` heuristic dissector is
+ * enabled.
+ */
+int rlc_capture_pcap_header(const struct rlc_capture *cap,
+                            rlc_capture_write write, void *arg);
+
+/**
+ * @brief Write the PDUs captured so far as pcap records, and release their
+ * slots.
+ *
+ * @return ptrdiff_t Number of PDUs written, or negative `rlc_errno` code
+ * returned by @p write.
+ */
+ptrdiff_t rlc_capture_drain_pcap(struct rlc_capture *cap,
+                                 rlc_capture_write write, void *arg);
+
+RLC_END_DECL
+
+#endif /* RLC_CAPTURE_H__ */
@@ -4,6 +4,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 #include <rlc/utils.h>
 
@@ -21,6 +22,30 @@ enum rlc_service_type {
         RLC_TM
 };
 
+/** @brief What to do with a data PDU that would exceed the RX budget */
+enum rlc_rx_budget_policy {
+        /* Discard PDUs of SNs that are not yet being reassembled. SDUs in
+         * reassembly may still be completed, as may the SDU at the start of
+         * the RX window. */
+        RLC_RX_BUDGET_REJECT,
+        /* Drop incomplete SDUs with `RLC_EVENT_RX_FAIL`, the one with the
+         * oldest first segment first, until the PDU fits. Their data is
+         * released before the event. The SDU at the start of the RX window
+         * is kept, and its PDUs are let through as above. In AM, the peer
+         * retransmits dropped SDUs when they are reported missing. */
+        RLC_RX_BUDGET_DROP_OLDEST,
+};
+
+/** @brief What queue management does to an SDU, see `aqm_target_us` */
+enum rlc_aqm_action {
+        /* Remove the SDU from the TX queue. `RLC_EVENT_TX_RELEASE` is fired
+         * with `RLC_TX_RELEASE_AQM`. */
+        RLC_AQM_DROP,
+        /* Send the SDU anyway, and fire `RLC_EVENT_TX_MARK` so that the
+         * upper layer can signal congestion itself, e.g. with ECN */
+        RLC_AQM_MARK,
+};
+
 struct rlc_config {
         enum rlc_service_type type;
 
@@ -29,12 +54,67 @@ struct rlc_config {
         size_t pdu_without_poll_max;
         size_t byte_without_poll_max;
 
+        /* If non-zero, poll this many times per round trip instead of using
+         * the limits above. The poll interval in bytes is derived from the
+         * measured bandwidth-delay product and shrinks as the TX window fills
+         * up. The limits above apply until a round trip has been measured. */
+        uint32_t poll_per_rtt;
+
         uint32_t time_reassembly_us;
         uint32_t time_poll_retransmit_us;
         uint32_t time_status_prohibit_us;
 
+        /* If non-zero, t-StatusProhibit follows twice the smoothed interval
+         * between received polls, so that polls arriving faster than that
+         * are answered together. time_status_prohibit_us is then the lower
+         * bound, and this the upper. */
+        uint32_t time_status_prohibit_max_us;
+
+        /* Bounds of t-PollRetransmit when it is derived from the measured
+         * round trip time. If time_poll_retransmit_max_us is 0, the fixed
+         * time_poll_retransmit_us is always used. */
+        uint32_t time_poll_retransmit_min_us;
+        uint32_t time_poll_retransmit_max_us;
+
         uint32_t max_retx_threshhold;
 
+        /* Time an SDU may wait in the TX queue before being discarded, if no
+         * part of it has been submitted yet. 0 disables discarding. */
+        uint32_t discard_timer_us;
+
+        /* Limits of the TX queue, in SDU bytes and SDUs, including SDUs
+         * waiting for acknowledgement. `rlc_tx` fails with -ENOBUFS when an
+         * SDU does not fit. 0 means unlimited. */
+        size_t tx_queue_max_bytes;
+        size_t tx_queue_max_sdus;
+
+        /* Flow control of the upper layer. `RLC_EVENT_TX_PAUSE` is fired when
+         * the bytes in the TX queue reach the high watermark, and
+         * `RLC_EVENT_TX_RESUME` when they fall back to the low watermark. 0
+         * as high watermark disables the events. */
+        size_t tx_queue_high_bytes;
+        size_t tx_queue_low_bytes;
+
+        /* CoDel queue management. Each SDU is timed from `rlc_tx` until it is
+         * first submitted. Once this time has stayed above the target for a
+         * whole interval, SDUs are dropped or marked as they are about to be
+         * submitted, at a rate that rises until the queue has drained. Only
+         * SDUs of which nothing has been submitted are affected. 0 as target
+         * disables it, 0 as interval means 100 ms. */
+        uint32_t aqm_target_us;
+        uint32_t aqm_interval_us;
+        enum rlc_aqm_action aqm_action;
+
+        /* AM only: deliver each SDU as soon as it is complete, instead of in
+         * SN order. Reordering is then left to the upper layer. */
+        bool deliver_out_of_order;
+
+        /* Bytes the RX side may hold for reassembly, counted as in
+         * RLC_MEM_RX_SDU. 0 means unbounded. The policy also applies to a
+         * shared budget, see `rlc_rx_budget_attach`. */
+        size_t rx_budget_bytes;
+        enum rlc_rx_budget_policy rx_budget_policy;
+
         enum rlc_sn_width sn_width;
 };
 
@@ -18,7 +18,13 @@ struct rlc_context;
  * - `RLC_EVENT_RX_DONE` - RX complete, deliver SDU
  * - `RLC_EVENT_RX_DONE_DIRECt` - RX complete, deliver buffer directly (no SDU)
  * - `RLC_EVENT_RX_FAIL` - Reception failed. SDU is being dropped
- * - `RLC_EVENT_TX_RELEASE` - TX SDU is either completed or dropped.
+ * - `RLC_EVENT_TX_RELEASE` - TX SDU is either completed or dropped. The reason
+ *   is given in `tx_release.reason`.
+ * - `RLC_EVENT_TX_PAUSE` - TX queue reached its high watermark, the upper
+ *   layer should hold back SDUs
+ * - `RLC_EVENT_TX_RESUME` - TX queue fell back to its low watermark
+ * - `RLC_EVENT_TX_MARK` - TX SDU in `sdu` was picked by queue management, and
+ *   is sent anyway, see `RLC_AQM_MARK`
  */
 struct rlc_event {
         enum rlc_event_type {
@@ -27,6 +33,9 @@ struct rlc_event {
                 RLC_EVENT_RX_FAIL,
 
                 RLC_EVENT_TX_RELEASE,
+                RLC_EVENT_TX_PAUSE,
+                RLC_EVENT_TX_RESUME,
+                RLC_EVENT_TX_MARK,
         } type;
 
         union {
@@ -44,6 +53,13 @@ struct rlc_event {
 
                 struct {
                         struct rlc_sdu *sdu;
+
+                        enum rlc_tx_release_reason {
+                                RLC_TX_RELEASE_DONE,
+                                RLC_TX_RELEASE_FAIL,
+                                RLC_TX_RELEASE_DISCARD,
+                                RLC_TX_RELEASE_AQM,
+                        } reason;
                 } tx_release;
 
                 struct rlc_sdu *sdu;
@@ -61,7 +77,12 @@ void rlc_event_rx_done(struct rlc_context *ctx, struct rlc_sdu *sdu);
 void rlc_event_rx_done_direct(struct rlc_context *ctx, gabs_pbuf *buf);
 void rlc_event_tx_done(struct rlc_context *ctx, struct rlc_sdu *sdu);
 void rlc_event_tx_fail(struct rlc_context *ctx, struct rlc_sdu *sdu);
+void rlc_event_tx_discard(struct rlc_context *ctx, struct rlc_sdu *sdu);
+void rlc_event_tx_aqm_drop(struct rlc_context *ctx, struct rlc_sdu *sdu);
+void rlc_event_tx_mark(struct rlc_context *ctx, struct rlc_sdu *sdu);
 void rlc_event_rx_drop(struct rlc_context *ctx, struct rlc_sdu *sdu);
+void rlc_event_tx_pause(struct rlc_context *ctx);
+void rlc_event_tx_resume(struct rlc_context *ctx);
 
 RLC_END_DECL
 
@@ -0,0 +1,96 @@
+
+#ifndef RLC_LATENCY_H__
+#define RLC_LATENCY_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <rlc/utils.h>
+
+RLC_BEGIN_DECL
+
+struct rlc_context;
+
+/* Each power of two is split into 2^RLC_HIST_SUB_BITS linear buckets, which
+ * bounds the error of a recorded value to 1/16th of it. Values below
+ * RLC_HIST_SUB_COUNT are recorded exactly. */
+#define RLC_HIST_SUB_BITS  (4)
+#define RLC_HIST_SUB_COUNT (1u << RLC_HIST_SUB_BITS)
+#define RLC_HIST_BUCKETS   ((32 - RLC_HIST_SUB_BITS + 1) * RLC_HIST_SUB_COUNT)
+
+/** @brief Log-linear histogram of durations in microseconds */
+struct rlc_hist {
+        uint64_t count;
+        uint64_t sum_us;
+        uint32_t min_us;
+        uint32_t max_us;
+
+        uint32_t buckets[RLC_HIST_BUCKETS];
+};
+
+/** @brief Part of the life of an SDU measured by a histogram */
+enum rlc_latency_kind {
+        /* From `rlc_tx` until the first byte is submitted */
+        RLC_LATENCY_TX_QUEUE,
+        /* From the first byte submitted until acknowledged, AM only */
+        RLC_LATENCY_TX_ACK,
+        /* From `rlc_tx` until dropped by queue management, see
+         * `aqm_target_us` */
+        RLC_LATENCY_TX_DROP,
+        /* From the first segment received until delivered */
+        RLC_LATENCY_RX_DELIVER,
+        /* From fully received until delivered, i.e. time spent held back
+         * behind missing SDUs */
+        RLC_LATENCY_RX_HOLD,
+
+        RLC_LATENCY_COUNT,
+};
+
+/** @brief Latency histograms of a context, see `rlc_latency_attach` */
+struct rlc_latency {
+        struct rlc_hist hist[RLC_LATENCY_COUNT];
+};
+
+/**
+ * @brief Accumulate the latencies of @p ctx into @p latency, or stop if
+ * @p latency is NULL.
+ *
+ * @p latency is cleared before use.
+ */
+void rlc_latency_attach(struct rlc_context *ctx, struct rlc_latency *latency);
+
+/**
+ * @brief Copy the histograms of @p ctx into @p out, optionally clearing them
+ * so that the next snapshot covers only what happens after this one.
+ *
+ * Traffic is only held up for the duration of the copy. If no histograms are
+ * attached, @p out is cleared.
+ */
+void rlc_latency_snapshot(struct rlc_context *ctx, struct rlc_latency *out,
+                          bool reset);
+
+/** @brief Add a sample of @p value_us to @p hist */
+void rlc_hist_add(struct rlc_hist *hist, uint64_t value_us);
+
+/** @brief Clear all samples of @p hist */
+void rlc_hist_reset(struct rlc_hist *hist);
+
+/** @brief Index of the bucket holding @p value_us */
+size_t rlc_hist_bucket(uint64_t value_us);
+
+/** @brief Lowest value held by the bucket at @p index */
+uint32_t rlc_hist_bucket_start(size_t index);
+
+/**
+ * @brief Value below which @p quantile of the samples lie, e.g. 0.99 for the
+ * 99th percentile.
+ *
+ * @return uint32_t Highest value held by the bucket of the quantile, clamped
+ * to the largest sample, or 0 if there are no samples.
+ */
+uint32_t rlc_hist_value_at(const struct rlc_hist *hist, double quantile);
+
+RLC_END_DECL
+
+#endif /* RLC_LATENCY_H__ */
@@ -0,0 +1,104 @@
+
+#ifndef RLC_LCP_H__
+#define RLC_LCP_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <gabs/mutex.h>
+
+#include <rlc/utils.h>
+#include <rlc/errno.h>
+#include <rlc/list.h>
+
+RLC_BEGIN_DECL
+
+struct rlc_context;
+
+/** @brief Prioritized bit rate of a channel that is always served in full */
+#define RLC_LCP_PBR_INFINITY (UINT32_MAX)
+
+/**
+ * @brief Logical channel taking part in logical channel prioritization.
+ *
+ * The channel is owned by the caller, and linked into a `struct rlc_lcp` with
+ * `rlc_lcp_add`.
+ */
+struct rlc_lcp_channel {
+        struct rlc_context *ctx;
+
+        unsigned int priority; /* Lower value means higher priority */
+        uint32_t pbr;          /* Prioritized bit rate, bytes per second */
+        uint32_t bsd_us;       /* Bucket size duration */
+
+        int64_t bucket; /* Bj in the spec. Negative when overserved */
+
+        /* Bytes added to the bucket not yet whole, in millionths of a byte */
+        uint32_t bucket_frac;
+
+        rlc_dlist_node list_node;
+
+        /* State of the grant being served, owned by `rlc_lcp_grant` */
+        struct {
+                struct rlc_lcp_channel *next;
+                int64_t bucket;
+                size_t used;
+        } grant;
+};
+
+/** @brief Multiplexer of logical channels sharing transmit opportunities */
+struct rlc_lcp {
+        rlc_dlist channels; /* Sorted by priority */
+        gabs_mutex lock;    /* Channel list and buckets */
+
+        /* Held through a grant, so that no channel served by it is removed */
+        gabs_mutex grant_lock;
+};
+
+void rlc_lcp_channel_init(struct rlc_lcp_channel *chan,
+                          struct rlc_context *ctx, unsigned int priority,
+                          uint32_t pbr, uint32_t bsd_us);
+
+rlc_errno rlc_lcp_init(struct rlc_lcp *lcp);
+
+rlc_errno rlc_lcp_deinit(struct rlc_lcp *lcp);
+
+/** @brief Add @p chan to @p lcp, keeping the channels sorted by priority */
+void rlc_lcp_add(struct rlc_lcp *lcp, struct rlc_lcp_channel *chan);
+
+/**
+ * @brief Remove @p chan, which must have been added to @p lcp, waiting for a
+ * grant in progress to end.
+ *
+ * Must not be called from within the backend of a channel.
+ */
+void rlc_lcp_remove(struct rlc_lcp *lcp, struct rlc_lcp_channel *chan);
+
+/**
+ * @brief Let @p elapsed_us pass, filling the token bucket of every channel
+ * with its prioritized bit rate, up to PBR * BSD.
+ */
+void rlc_lcp_tick(struct rlc_lcp *lcp, uint32_t elapsed_us);
+
+/**
+ * @brief Split a transmit opportunity of @p grant bytes between the channels.
+ *
+ * This follows the logical channel prioritization procedure of TS 38.321
+ * section 5.4.3.1. First, every channel with a positive bucket is given up to
+ * its bucket of bytes in order of priority. Any remaining bytes are then given
+ * out in strict priority order. The buffer status of each channel decides how
+ * much it needs, so each channel is served with exactly one call to
+ * `rlc_tx_avail`.
+ *
+ * The channels and their buckets are read once under the lock, which is not
+ * held while the channels are served. Channels may be added and buckets
+ * filled meanwhile, but grants are served one at a time and must not be
+ * started from within the backend of a channel.
+ *
+ * @return size_t Number of bytes of @p grant left unused
+ */
+size_t rlc_lcp_grant(struct rlc_lcp *lcp, size_t grant);
+
+RLC_END_DECL
+
+#endif /* RLC_LCP_H__ */
@@ -145,6 +145,209 @@ static inline rlc_list_it rlc_list_it_pop(rlc_list_it it, rlc_list_node **out)
         return rlc_list_it_repeat(it);
 }
 
+/*
+ * Doubly linked list keeping both ends, for lists that are appended to, or
+ * that have items removed by reference. Iterators work like those of
+ * `rlc_list`, so walks are written the same way. Nodes can also be inserted
+ * and removed directly, and the list be counted, in constant time.
+ */
+
+typedef struct rlc_dlist_node {
+        struct rlc_dlist_node *next;
+        struct rlc_dlist_node *prev;
+} rlc_dlist_node;
+
+typedef struct rlc_dlist {
+        struct rlc_dlist_node *head;
+        struct rlc_dlist_node *tail;
+        size_t count;
+} rlc_dlist;
+
+typedef struct rlc_dlist_it {
+        struct rlc_dlist *list;
+        struct rlc_dlist_node *node;
+
+        bool skip_iter;
+} rlc_dlist_it;
+
+static inline void rlc_dlist_init(rlc_dlist *list)
+{
+        list->head = NULL;
+        list->tail = NULL;
+        list->count = 0;
+}
+
+static inline void rlc_dlist_node_init(rlc_dlist_node *node)
+{
+        node->next = NULL;
+        node->prev = NULL;
+}
+
+static inline bool rlc_dlist_empty(const rlc_dlist *list)
+{
+        return list->head == NULL;
+}
+
+/** @brief Number of nodes in @p list */
+static inline size_t rlc_dlist_count(const rlc_dlist *list)
+{
+        return list->count;
+}
+
+/**
+ * @brief Insert @p node after @p pos, or first in @p list if @p pos is NULL
+ */
+static inline void rlc_dlist_insert_after(rlc_dlist *list, rlc_dlist_node *pos,
+                                          rlc_dlist_node *node)
+{
+        node->prev = pos;
+
+        if (pos == NULL) {
+                node->next = list->head;
+                list->head = node;
+        } else {
+                node->next = pos->next;
+                pos->next = node;
+        }
+
+        if (node->next == NULL) {
+                list->tail = node;
+        } else {
+                node->next->prev = node;
+        }
+
+        list->count++;
+}
+
+/**
+ * @brief Insert @p node before @p pos, or last in @p list if @p pos is NULL
+ */
+static inline void rlc_dlist_insert_before(rlc_dlist *list,
+                                           rlc_dlist_node *pos,
+                                           rlc_dlist_node *node)
+{
+        rlc_dlist_insert_after(list, pos == NULL ? list->tail : pos->prev,
+                               node);
+}
+
+static inline void rlc_dlist_push_back(rlc_dlist *list, rlc_dlist_node *node)
+{
+        rlc_dlist_insert_after(list, list->tail, node);
+}
+
+/** @brief Remove @p node, which must be in @p list */
+static inline void rlc_dlist_remove(rlc_dlist *list, rlc_dlist_node *node)
+{
+        if (node->prev == NULL) {
+                list->head = node->next;
+        } else {
+                node->prev->next = node->next;
+        }
+
+        if (node->next == NULL) {
+                list->tail = node->prev;
+        } else {
+                node->next->prev = node->prev;
+        }
+
+        list->count--;
+        rlc_dlist_node_init(node);
+}
+
+/**
+ * @brief Iterate over @p list_, keeping the iterator in @p it_
+ *
+ * Note that @p it_ must already be declared.
+ */
+#define rlc_dlist_foreach(list_, it_)                                          \
+        for (it_ = rlc_dlist_it_init(list_); !rlc_dlist_it_eoi(it_);           \
+             it_ = rlc_dlist_it_next(it_))
+
+static inline rlc_dlist_it rlc_dlist_it_init(rlc_dlist *list)
+{
+        return (struct rlc_dlist_it){
+                .list = list,
+                .node = list->head,
+                .skip_iter = false,
+        };
+}
+
+static inline rlc_dlist_it rlc_dlist_it_next(rlc_dlist_it it)
+{
+        if (it.node == NULL) {
+                return it;
+        }
+
+        if (it.skip_iter) {
+                it.skip_iter = false;
+                return it;
+        }
+
+        it.node = it.node->next;
+
+        return it;
+}
+
+static inline rlc_dlist_it rlc_dlist_it_repeat(rlc_dlist_it it)
+{
+        it.skip_iter = true;
+        return it;
+}
+
+static inline rlc_dlist_node *rlc_dlist_it_node(rlc_dlist_it it)
+{
+        return it.node;
+}
+
+#define rlc_dlist_it_item(it_, struct_, member_)                               \
+        ((rlc_dlist_it_node(it_) == NULL)                                      \
+                 ? NULL                                                        \
+                 : gabs_container_of(rlc_dlist_it_node(it_), struct_,          \
+                                     member_))
+
+static inline bool rlc_dlist_it_eoi(rlc_dlist_it it)
+{
+        return rlc_dlist_it_node(it) == NULL;
+}
+
+/**
+ * @brief Put @p node before the item in @p it, or last if @p it is at the
+ * end. The returned iterator is still at the same item.
+ */
+static inline rlc_dlist_it rlc_dlist_it_put_front(rlc_dlist_it it,
+                                                  rlc_dlist_node *node)
+{
+        rlc_dlist_insert_before(it.list, it.node, node);
+
+        it.skip_iter = false;
+        return it;
+}
+
+static inline rlc_dlist_it rlc_dlist_it_put_back(rlc_dlist_it it,
+                                                 rlc_dlist_node *node)
+{
+        return rlc_dlist_it_put_front(rlc_dlist_it_next(it), node);
+}
+
+static inline rlc_dlist_it rlc_dlist_it_pop(rlc_dlist_it it,
+                                            rlc_dlist_node **out)
+{
+        struct rlc_dlist_node *next;
+
+        if (out != NULL) {
+                *out = it.node;
+        }
+
+        next = it.node->next;
+        rlc_dlist_remove(it.list, it.node);
+
+        it.node = next;
+
+        /* As with `rlc_list_it_pop`, the next call to it_next() returns the
+         * same iterator */
+        return rlc_dlist_it_repeat(it);
+}
+
 RLC_END_DECL
 
 #endif /* RLC_LIST_H__ */
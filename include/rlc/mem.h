@@ -0,0 +1,76 @@
+
+#ifndef RLC_MEM_H__
+#define RLC_MEM_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <rlc/utils.h>
+
+RLC_BEGIN_DECL
+
+struct rlc_context;
+
+/** @brief What memory held by a context is used for */
+enum rlc_mem_kind {
+        /* TX SDUs and the SDU data they hold on to */
+        RLC_MEM_TX_SDU,
+        /* RX SDUs and the data held for reassembly */
+        RLC_MEM_RX_SDU,
+        /* Segment list items of TX and RX SDUs */
+        RLC_MEM_SEG_NODE,
+        /* Events waiting to be passed to the listener */
+        RLC_MEM_EVENT,
+        /* Calls to the backend waiting on the scheduler */
+        RLC_MEM_OFFLOAD,
+        /* PDU headers and status PDUs, until handed to the lower layer */
+        RLC_MEM_HEADER,
+
+        RLC_MEM_COUNT,
+};
+
+/** @brief Memory held for one kind of use */
+struct rlc_mem_stat {
+        size_t bytes;
+        size_t count; /* Number of objects */
+
+        /* Highest values since the context was initialized, or since the
+         * peaks were last reset, as seen at the end of each call into the
+         * context */
+        size_t peak_bytes;
+        size_t peak_count;
+};
+
+/**
+ * @brief Memory held by a context, see `rlc_mem_usage`.
+ *
+ * Bytes are counted as requested from the allocators, so the overhead of the
+ * allocators themselves is not included. SDU data passed to `rlc_tx` is
+ * counted for as long as the context holds a reference to it.
+ */
+struct rlc_mem_stats {
+        struct rlc_mem_stat kind[RLC_MEM_COUNT];
+
+        /* Sum over all kinds. The peak is that of the sum, which may be lower
+         * than the sum of the peaks. */
+        size_t bytes;
+        size_t peak_bytes;
+};
+
+/**
+ * @brief Copy the memory accounting of @p ctx into @p out, optionally
+ * resetting the peaks to the current values.
+ *
+ * The counters are read without the context lock, so while traffic is
+ * running the kinds may be slightly out of step with each other.
+ */
+void rlc_mem_usage(struct rlc_context *ctx, struct rlc_mem_stats *out,
+                   bool reset_peaks);
+
+/** @brief Name of @p kind, e.g. "tx_sdu" */
+const char *rlc_mem_kind_str(enum rlc_mem_kind kind);
+
+RLC_END_DECL
+
+#endif /* RLC_MEM_H__ */
@@ -13,6 +13,7 @@ RLC_BEGIN_DECL
 
 #define RLC_STATUS_SO_MAX (UINT16_MAX)
 #define RLC_STATUS_SO_MIN (0x0)
+#define RLC_STATUS_RANGE_MAX (UINT8_MAX)
 
 struct rlc_pdu {
         size_t size;
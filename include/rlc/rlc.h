@@ -22,6 +22,11 @@
 #include <rlc/event.h>
 #include <rlc/sched.h>
 #include <rlc/backend.h>
+#include <rlc/capture.h>
+#include <rlc/trace.h>
+#include <rlc/latency.h>
+#include <rlc/vclock.h>
+#include <rlc/mem.h>
 #include <rlc/config.h>
 
 RLC_BEGIN_DECL
@@ -42,19 +47,77 @@ typedef struct rlc_context {
                  * reassembly. */
                 uint32_t next_status_trigger;
 
+                /* RX_HIGHEST_STATUS holds the highest possible value of the
+                 * SN which can be indicated by ACK_SN when a status PDU
+                 * needs to be constructed. AM only. */
+                uint32_t highest_status;
+
                 struct rlc_window win;
                 rlc_sdu_queue sdus;
+
+                /* Shared budget, see `rlc_rx_budget_attach` */
+                struct rlc_rx_budget *budget;
+
+                uint64_t budget_rejected;
+                uint64_t budget_dropped;
         } rx;
         struct {
                 uint32_t next_sn; /* TX_Next in the spec */
 
                 struct rlc_window win;
                 rlc_sdu_queue sdus;
+
+                /* Buffer status, see `rlc_tx_buffer_status`. Written with
+                 * the lock held, read without it. */
+                struct {
+                        size_t new_bytes;
+                        size_t retx_bytes;
+                        size_t status_bytes;
+
+                        size_t new_sdus;  /* SDUs with unsent new data */
+                        size_t retx_segs; /* Segments pending retransmission */
+
+                        /* All of `sdus`, see `tx_queue_max_bytes` */
+                        size_t queued_bytes;
+                        size_t queued_sdus;
+                } bs;
+
+                /* RLC_EVENT_TX_PAUSE has been fired, and not yet been
+                 * followed by RLC_EVENT_TX_RESUME */
+                bool paused;
+
+                /* Earliest time an SDU that has not been submitted may
+                 * expire, UINT64_MAX if there are none. */
+                uint64_t discard_due_us;
+
+                /* CoDel state, see `aqm_target_us` */
+                struct {
+                        /* When the sojourn time will have been above target
+                         * for an interval, 0 if it is below */
+                        uint64_t first_above_us;
+                        uint64_t drop_next_us;
+                        uint32_t count;
+                        uint32_t last_count;
+                        bool dropping;
+
+                        uint32_t sojourn_us;
+                        uint64_t dropped;
+                        uint64_t marked;
+                } aqm;
+
+                /* Set while building PDUs into caller memory */
+                struct rlc_backend_build *build;
+
+                /* A TX request has been issued to the lower layer, and
+                 * has not yet been answered with a transmit opportunity. */
+                bool request_pending;
         } tx;
         struct {
                 size_t pdu_without_poll;
                 size_t byte_without_poll;
 
+                uint64_t tx_bytes; /* Bytes submitted in data PDUs */
+
                 struct rlc_timer t_poll_retransmit;
                 struct rlc_timer t_status_prohibit;
                 bool status_prohibit; /* t-statusProhibit running */
@@ -64,16 +127,92 @@ typedef struct rlc_context {
 
                 /* Generate status PDU on next available opportunity. AM only*/
                 bool gen_status;
+
+                /* The receive state changed since the size of the pending
+                 * status PDU was last reported. AM only. */
+                bool status_size_stale;
+
+                /* A poll has been received for SN `status_delayed_sn`, and
+                 * the status PDU is delayed until that SN is below
+                 * RX_Highest_Status. AM only. */
+                bool status_delayed;
+                uint32_t status_delayed_sn;
+
+                /* Status PDU coalescing, see `rlc_rx_stats`. AM only. */
+                struct {
+                        /* Fingerprint, ACK_SN and time of the last status
+                         * PDU sent. Valid if `sent` is set. */
+                        uint32_t hash;
+                        uint32_t ack_sn;
+                        uint64_t sent_us;
+                        bool sent;
+
+                        /* A poll was received for data the last status PDU
+                         * acknowledged, too long after it to have crossed it,
+                         * so the peer did not get it */
+                        bool repoll;
+
+                        /* The pending status PDU has only been triggered by
+                         * polls, and may be suppressed if it is unchanged */
+                        bool polled_only;
+
+                        uint64_t poll_us;     /* Time of the last poll */
+                        uint32_t poll_gap_us; /* Smoothed time between polls */
+
+                        uint64_t polls;
+                        uint64_t status_sent;
+                        uint64_t status_suppressed;
+                } report;
+
+                /* Round trip time from a poll to the status PDU answering
+                 * it, smoothed as in RFC 6298. */
+                struct {
+                        uint32_t srtt_us;
+                        uint32_t rttvar_us;
+                        uint32_t samples;
+
+                        uint32_t sn;      /* SN of the poll being timed */
+                        uint64_t poll_us; /* Time of the poll being timed */
+                        bool timing;      /* A poll is being timed */
+
+                        /* Bytes submitted in data PDUs, at the time of the
+                         * timed poll */
+                        uint64_t poll_bytes;
+
+                        /* Smoothed number of bytes submitted over a round
+                         * trip, i.e. the bandwidth-delay product */
+                        uint32_t bdp_bytes;
+
+                        /* Number of times t-PollRetransmit has expired
+                         * since the last sample */
+                        unsigned int backoff;
+                } rtt;
         } arq;
 
         gabs_mutex lock;
         gabs_timer_ctx timer_ctx;
+        struct rlc_vclock *vclock; /* See `rlc_vclock_attach` */
 
         struct rlc_sched sched;
 
         const struct rlc_backend *backend;
         rlc_event_listener listener;
 
+        /* PDU capture, see `rlc_capture_attach` */
+        struct {
+                struct rlc_capture *ring;
+                uint16_t id;
+        } capture;
+
+        /* Event trace, see `rlc_trace_attach` */
+        struct rlc_trace *trace;
+
+        /* SDU latency histograms, see `rlc_latency_attach` */
+        struct rlc_latency *latency;
+
+        /* Allocation accounting, see `rlc_mem_usage` */
+        struct rlc_mem_stats mem;
+
         const gabs_logger_h *logger;
         const gabs_allocator_h *alloc_buf;
         const gabs_allocator_h *alloc_misc;
@@ -2,6 +2,9 @@
 #ifndef RLC_RX_H__
 #define RLC_RX_H__
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include <gabs/pbuf.h>
 
 #include <rlc/errno.h>
@@ -10,12 +13,56 @@ RLC_BEGIN_DECL
 
 struct rlc_context;
 
+/**
+ * @brief Reassembly budget shared by several contexts, e.g. all bearers of a
+ * UE, see `rlc_rx_budget_attach`.
+ */
+struct rlc_rx_budget {
+        size_t limit_bytes;
+        size_t used_bytes; /* Updated atomically by the attached contexts */
+};
+
+/** @brief Status reporting of an AM entity, see `rlc_rx_stats_get` */
+struct rlc_rx_stats {
+        uint64_t polls;       /* Data PDUs received with the poll bit set */
+        uint64_t status_sent; /* Status PDUs submitted */
+
+        /* Status PDUs triggered by polls only, and not sent because they
+         * were identical to the previous one */
+        uint64_t status_suppressed;
+
+        uint32_t status_prohibit_us; /* Current t-StatusProhibit */
+
+        /* Enforcement of the RX budgets, in any mode */
+        uint64_t budget_rejected; /* Data PDUs discarded */
+        uint64_t budget_dropped;  /* Incomplete SDUs dropped */
+};
+
 rlc_errno rlc_rx_init(struct rlc_context *ctx);
 void rlc_rx_reset(struct rlc_context* ctx);
 rlc_errno rlc_rx_deinit(struct rlc_context *ctx);
 
 void rlc_rx_submit(struct rlc_context *ctx, gabs_pbuf buf);
 
+void rlc_rx_budget_init(struct rlc_rx_budget *budget, size_t limit_bytes);
+
+/**
+ * @brief Count the RX SDUs of @p ctx against @p budget as well as against
+ * its own `rx_budget_bytes`, or stop if @p budget is NULL.
+ *
+ * The `rx_budget_policy` of each context applies when the shared budget is
+ * exceeded, but only SDUs of the context receiving the PDU are dropped.
+ *
+ * @retval -EBUSY @p ctx holds RX SDUs
+ */
+rlc_errno rlc_rx_budget_attach(struct rlc_context *ctx,
+                               struct rlc_rx_budget *budget);
+
+/**
+ * @brief Get the status reporting statistics of an AM entity.
+ */
+void rlc_rx_stats_get(struct rlc_context *ctx, struct rlc_rx_stats *stats);
+
 RLC_END_DECL
 
 #endif /* RLC_RX_H__ */
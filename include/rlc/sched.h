@@ -19,11 +19,11 @@ struct rlc_sched_item {
         rlc_sched_item_fn fn;
         rlc_sched_item_dealloc dealloc;
 
-        rlc_list_node list_node;
+        rlc_dlist_node list_node;
 };
 
 struct rlc_sched {
-        rlc_list queue;
+        rlc_dlist queue;
         gabs_mutex lock;
 };
 
@@ -34,7 +34,7 @@ static inline void rlc_sched_item_init(struct rlc_sched_item *item,
         item->fn = fn;
         item->dealloc = dealloc;
 
-        rlc_list_node_init(&item->list_node);
+        rlc_dlist_node_init(&item->list_node);
 }
 
 rlc_errno rlc_sched_init(struct rlc_sched *sched);
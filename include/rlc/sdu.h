@@ -18,6 +18,10 @@ struct rlc_context;
 
 RLC_BEGIN_DECL
 
+/* SN of a TX SDU that has not been submitted to the lower layer yet, which
+ * takes TX_Next on its first submission */
+#define RLC_SN_NONE (UINT32_MAX)
+
 enum rlc_sdu_state {
         RLC_READY,
         RLC_WAIT,
@@ -25,49 +29,89 @@ enum rlc_sdu_state {
 };
 
 typedef struct rlc_sdu {
-        enum rlc_sdu_state state;
-
-        unsigned int refcount;
+        /* Fields checked for every SDU on walks over an SDU queue come first,
+         * so that a walk touches a single cache line per SDU. Buffers,
+         * segment lists and bookkeeping further down are only accessed once
+         * an SDU has been picked. */
+        rlc_dlist_node list_node;
 
         /* RLC specification state variables */
         uint32_t sn;
 
+        enum rlc_sdu_state state;
+        bool is_tx;
+
+        unsigned int refcount; /* See `rlc_sdu_incref` */
+
         union {
                 struct {
-                        gabs_pbuf buffer;
-                        rlc_seg_list unsent;
+                        /* Bytes below this offset have been submitted to the
+                         * lower layer at least once. */
+                        uint32_t sent;
 
                         unsigned int retx_count; /* Number of retransmissions */
+
+                        uint64_t queued_us; /* Time of `rlc_tx` */
+                        uint64_t sent_us;   /* Time of first submission */
+
+                        gabs_pbuf buffer;
+                        rlc_seg_list unsent;
                 } tx;
                 struct {
-                        struct rlc_seg_buf buffer;
                         bool last_received;
+                        bool delivered; /* Delivered ahead of the window */
+
+                        uint64_t first_us; /* Time of the first segment */
+                        uint64_t done_us;  /* Time fully received */
+
+                        struct rlc_seg_buf buffer;
                 } rx;
         };
-        bool is_tx;
 
         struct rlc_context *ctx;
-        rlc_list_node list_node;
+
+        /* Accounted to the context, see `rlc_mem_sdu_sync` */
+        struct {
+                size_t bytes;
+                size_t nodes;
+        } mem;
 } rlc_sdu;
 
-typedef rlc_list rlc_sdu_queue;
+typedef rlc_dlist rlc_sdu_queue;
+
+#define rlc_sdu_from_it(it_) rlc_dlist_it_item(it_, struct rlc_sdu, list_node)
 
-#define rlc_sdu_from_it(it_) rlc_list_it_item(it_, struct rlc_sdu, list_node)
+static inline struct rlc_sdu *rlc_sdu_from_node(rlc_dlist_node *node)
+{
+        return gabs_container_of(node, struct rlc_sdu, list_node);
+}
 
 /** @brief Allocate SDU with direction @p dir */
 struct rlc_sdu *rlc_sdu_alloc(struct rlc_context *ctx, bool is_tx);
 
-/** @brief Increase reference count of @p sdu */
+/**
+ * @brief Increase reference count of @p sdu
+ *
+ * References are counted atomically, so this and `rlc_sdu_decref` may be
+ * called from any thread without the context lock. A listener can thereby
+ * take a reference to a delivered SDU and hand it to another thread, which
+ * reads the SDU buffer and drops the reference when done.
+ */
 void rlc_sdu_incref(struct rlc_sdu *sdu);
 
-/** @brief Decrease reference count of @p sdu, deallocting if reaching 0 */
+/**
+ * @brief Decrease reference count of @p sdu, deallocting if reaching 0
+ *
+ * Dropping the only reference needs no atomic read-modify-write, which keeps
+ * SDUs that are never shared cheap.
+ */
 void rlc_sdu_decref(struct rlc_sdu *sdu);
 
 void rlc_sdu_queue_clear(rlc_sdu_queue *q);
 
 static inline struct rlc_sdu *rlc_sdu_queue_head(rlc_sdu_queue *q)
 {
-        return rlc_sdu_from_it(rlc_list_it_init(q));
+        return rlc_sdu_from_it(rlc_dlist_it_init(q));
 }
 
 /** @brief Get SDU with SN=@p sn */
@@ -95,15 +139,15 @@ static inline bool rlc_sdu_submitted(struct rlc_sdu *sdu)
 {
         rlc_assert(sdu->is_tx);
 
-        rlc_list_it it;
+        rlc_dlist_it it;
         struct rlc_seg_item *item;
 
-        it = rlc_list_it_init(&sdu->tx.unsent);
+        it = rlc_dlist_it_init(&sdu->tx.unsent);
         item = rlc_seg_item_from_it(it);
 
         assert(item != NULL);
 
-        return !rlc_list_it_eoi(rlc_list_it_next(it)) || item->seg.start != 0;
+        return !rlc_dlist_it_eoi(rlc_dlist_it_next(it)) || item->seg.start != 0;
 }
 
 /**
@@ -123,15 +167,15 @@ static inline bool rlc_sdu_is_rx_done(struct rlc_sdu *sdu)
 {
         rlc_assert(!sdu->is_tx);
 
-        rlc_list_it it;
+        rlc_dlist_it it;
         struct rlc_seg_item *item;
 
-        it = rlc_list_it_init(&sdu->rx.buffer.segments);
+        it = rlc_dlist_it_init(&sdu->rx.buffer.segments);
         item = rlc_seg_item_from_it(it);
 
         /* Last received and exactly one segment */
-        return sdu->rx.last_received && !rlc_list_it_eoi(it) &&
-               item->seg.start == 0 && rlc_list_it_eoi(rlc_list_it_next(it));
+        return sdu->rx.last_received && !rlc_dlist_it_eoi(it) &&
+               item->seg.start == 0 && rlc_dlist_it_eoi(rlc_dlist_it_next(it));
 }
 
 /**
@@ -153,13 +197,13 @@ static inline bool rlc_sdu_loss_detected(struct rlc_sdu *sdu)
 {
         rlc_assert(!sdu->is_tx);
 
-        rlc_list_it it;
+        rlc_dlist_it it;
         struct rlc_seg_item *item;
 
-        it = rlc_list_it_init(&sdu->rx.buffer.segments);
+        it = rlc_dlist_it_init(&sdu->rx.buffer.segments);
         item = rlc_seg_item_from_it(it);
 
-        return !rlc_list_it_eoi(rlc_list_it_next(it)) || item->seg.start != 0;
+        return !rlc_dlist_it_eoi(rlc_dlist_it_next(it)) || item->seg.start != 0;
 }
 
 static inline gabs_pbuf rlc_sdu_buffer(struct rlc_sdu *sdu)
@@ -17,19 +17,19 @@ struct rlc_seg {
 
 struct rlc_seg_item {
         struct rlc_seg seg;
-        rlc_list_node list_node;
+        rlc_dlist_node list_node;
 };
 
-typedef rlc_list rlc_seg_list;
+typedef rlc_dlist rlc_seg_list;
 
 static inline bool rlc_seg_okay(struct rlc_seg *segment)
 {
         return segment->start != 0 || segment->end != 0;
 }
 
-static inline struct rlc_seg_item *rlc_seg_item_from_it(rlc_list_it it)
+static inline struct rlc_seg_item *rlc_seg_item_from_it(rlc_dlist_it it)
 {
-        return rlc_list_it_item(it, struct rlc_seg_item, list_node);
+        return rlc_dlist_it_item(it, struct rlc_seg_item, list_node);
 }
 
 /**
@@ -2,6 +2,7 @@
 #ifndef RLC_TIMEOUT_H__
 #define RLC_TIMEOUT_H__
 
+#include <stdint.h>
 #include <stdbool.h>
 
 #include <gabs/timer.h>
@@ -17,11 +18,24 @@ struct rlc_timer;
 
 typedef void (*rlc_timer_cb)(struct rlc_timer *, struct rlc_context *);
 
+/** @brief State of a timer running on a virtual clock */
+enum rlc_timer_vstate {
+        RLC_TIMER_IDLE,
+        RLC_TIMER_ARMED,
+        RLC_TIMER_FIRING, /* Due, callback not run yet or running */
+};
+
 struct rlc_timer {
         gabs_timer gtimer;
 
         rlc_timer_cb cb;
         struct rlc_context *ctx;
+
+        /* Used instead of `gtimer` while the context is attached to a
+         * virtual clock, see `rlc_vclock_attach` */
+        enum rlc_timer_vstate vstate;
+        uint64_t due_us;
+        rlc_dlist_node vnode;
 };
 
 rlc_errno rlc_timer_install(struct rlc_timer *timer, rlc_timer_cb cb,
@@ -32,32 +46,15 @@ static inline bool rlc_timer_okay(struct rlc_timer *timer)
         return gabs_timer_okay(timer->gtimer);
 }
 
-static inline rlc_errno rlc_timer_uninstall(struct rlc_timer *timer)
-{
-        return gabs_timer_uninstall(timer->gtimer);
-}
+rlc_errno rlc_timer_uninstall(struct rlc_timer *timer);
 
-static inline rlc_errno rlc_timer_start(struct rlc_timer *timer,
-                                        uint32_t delay_us)
-{
-        return gabs_timer_start(timer->gtimer, delay_us);
-}
+rlc_errno rlc_timer_start(struct rlc_timer *timer, uint32_t delay_us);
 
-static inline rlc_errno rlc_timer_restart(struct rlc_timer *timer,
-                                          uint32_t delay_us)
-{
-        return gabs_timer_restart(timer->gtimer, delay_us);
-}
+rlc_errno rlc_timer_restart(struct rlc_timer *timer, uint32_t delay_us);
 
-static inline rlc_errno rlc_timer_stop(struct rlc_timer *timer)
-{
-        return gabs_timer_stop(timer->gtimer);
-}
+rlc_errno rlc_timer_stop(struct rlc_timer *timer);
 
-static inline bool rlc_timer_active(struct rlc_timer *timer)
-{
-        return gabs_timer_active(timer->gtimer);
-}
+bool rlc_timer_active(struct rlc_timer *timer);
 
 RLC_END_DECL
 
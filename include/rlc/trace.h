@@ -0,0 +1,127 @@
+
+#ifndef RLC_TRACE_H__
+#define RLC_TRACE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <rlc/utils.h>
+#include <rlc/errno.h>
+
+RLC_BEGIN_DECL
+
+struct rlc_context;
+
+/** @brief What a trace record describes, and the meaning of its fields */
+enum rlc_trace_event {
+        /* SDU queued. so: whole SDU, sn: RLC_SN_NONE as the SN is taken on
+         * the first transmission */
+        RLC_TRACE_TX_SDU,
+        /* Transmit opportunity. arg[0]: size, arg[1]: bytes left unused */
+        RLC_TRACE_TX_AVAIL,
+        /* Data PDU submitted. sn, so: payload, arg[0]: RLC_TRACE_FLAG_* */
+        RLC_TRACE_TX_PDU,
+        /* Poll set. sn: POLL_SN */
+        RLC_TRACE_TX_POLL,
+        /* Bytes marked for retransmission. sn, so, arg[0]: RETX_COUNT */
+        RLC_TRACE_TX_RETX,
+        /* Status PDU submitted. sn: ACK_SN, arg[0]: size */
+        RLC_TRACE_TX_STATUS,
+        /* Unchanged status PDU suppressed. sn: ACK_SN */
+        RLC_TRACE_TX_STATUS_SUPPRESSED,
+        /* NACK entry of a status PDU submitted. sn: NACK_SN, so, arg[0]:
+         * NACK_range */
+        RLC_TRACE_TX_NACK,
+        /* SDU acknowledged. sn */
+        RLC_TRACE_TX_DONE,
+        /* SDU given up on after max retransmissions. sn */
+        RLC_TRACE_TX_FAIL,
+        /* SDU discarded before transmission, without an SN */
+        RLC_TRACE_TX_DISCARD,
+        /* Data PDU received. sn, so: payload, arg[0]: RLC_TRACE_FLAG_* */
+        RLC_TRACE_RX_PDU,
+        /* Status PDU received. sn: ACK_SN, arg[0]: size of the NACKs */
+        RLC_TRACE_RX_STATUS,
+        /* NACK entry of a received status PDU. sn: NACK_SN, so, arg[0]:
+         * NACK_range */
+        RLC_TRACE_RX_NACK,
+        /* SDU reassembled. sn, so: whole SDU */
+        RLC_TRACE_RX_SDU,
+        /* SDU delivered to the upper layer. sn, arg[0]: out of order */
+        RLC_TRACE_RX_DELIVER,
+        /* SDU dropped. sn */
+        RLC_TRACE_RX_DROP,
+
+        RLC_TRACE_EVENT_COUNT,
+};
+
+#define RLC_TRACE_FLAG_FIRST  (1u << 0)
+#define RLC_TRACE_FLAG_LAST   (1u << 1)
+#define RLC_TRACE_FLAG_POLLED (1u << 2)
+
+/** @brief Fixed size trace record, see `enum rlc_trace_event` for the fields
+ * used by each event */
+struct rlc_trace_record {
+        uint64_t time_us;
+
+        uint32_t sn;
+        uint32_t so_start;
+        uint32_t so_end;
+        uint32_t arg[2];
+
+        uint16_t event;
+        uint16_t reserved;
+};
+
+/**
+ * @brief Ring of trace records of a single context.
+ *
+ * Records are written with the context lock held, overwriting the oldest
+ * ones when the ring is full.
+ */
+struct rlc_trace {
+        struct rlc_trace_record *records;
+        uint32_t mask; /* Number of records minus one */
+
+        uint64_t head; /* Records written */
+        uint64_t tail; /* Records read */
+};
+
+/**
+ * @brief Initialize @p trace to write into @p records.
+ *
+ * @param count Number of records, must be a power of two
+ */
+rlc_errno rlc_trace_init(struct rlc_trace *trace,
+                         struct rlc_trace_record *records, size_t count);
+
+/** @brief Trace @p ctx into @p trace, or stop tracing if @p trace is NULL */
+void rlc_trace_attach(struct rlc_context *ctx, struct rlc_trace *trace);
+
+/**
+ * @brief Copy up to @p max records that have not been read yet into @p out,
+ * oldest first.
+ *
+ * @param lost Set to the number of records overwritten before they were read
+ * @return size_t Number of records copied
+ */
+size_t rlc_trace_read(struct rlc_context *ctx, struct rlc_trace_record *out,
+                      size_t max, uint64_t *lost);
+
+/** @brief Name of @p event, or NULL if it is not known */
+const char *rlc_trace_event_name(uint16_t event);
+
+/**
+ * @brief Format @p record as a line of text, without a trailing newline.
+ *
+ * This does not depend on a context, so that records can be decoded
+ * offline.
+ *
+ * @return int Length of the text, as for snprintf
+ */
+int rlc_trace_format(const struct rlc_trace_record *record, char *buf,
+                     size_t size);
+
+RLC_END_DECL
+
+#endif /* RLC_TRACE_H__ */
@@ -2,6 +2,10 @@
 #ifndef RLC_TX_H__
 #define RLC_TX_H__
 
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
 #include <gabs/pbuf.h>
 
 #include <rlc/errno.h>
@@ -11,16 +15,167 @@ RLC_BEGIN_DECL
 struct rlc_context;
 struct rlc_sdu;
 
+/** @brief Data pending for transmission, see `rlc_tx_buffer_status` */
+struct rlc_tx_buffer_status {
+        size_t new_bytes;    /* SDU bytes never submitted */
+        size_t retx_bytes;   /* SDU bytes pending retransmission */
+        size_t status_bytes; /* Estimated size of pending status PDU */
+
+        /* Estimated header overhead of the PDUs carrying the data above */
+        size_t header_bytes;
+
+        /* Occupancy of the TX queue, including SDUs waiting for
+         * acknowledgement */
+        size_t queued_bytes;
+        size_t queued_sdus;
+};
+
+/** @brief Round trip time estimate, see `rlc_tx_rtt_get` */
+struct rlc_tx_rtt {
+        uint32_t srtt_us;   /* Smoothed round trip time */
+        uint32_t rttvar_us; /* Round trip time variation */
+        uint32_t samples;   /* Samples taken, 0 if there is no estimate yet */
+
+        uint32_t poll_retransmit_us; /* Current value of t-PollRetransmit */
+};
+
+/** @brief State of queue management, see `rlc_tx_aqm_stats_get` */
+struct rlc_tx_aqm_stats {
+        uint64_t dropped; /* SDUs dropped */
+        uint64_t marked;  /* SDUs marked */
+
+        /* Time the last SDU submitted or dropped spent in the TX queue */
+        uint32_t sojourn_us;
+
+        /* Whether SDUs are currently being dropped or marked, and how many
+         * have been since this started */
+        bool dropping;
+        uint32_t count;
+};
+
+/**
+ * @brief Opaque reference to a PDU submitted to the lower layer, see
+ * `rlc_tx_lost`
+ */
+typedef uint64_t rlc_pdu_handle;
+
+/** @brief Location of a PDU written by `rlc_tx_build` */
+struct rlc_tx_pdu_info {
+        size_t offset; /* Offset of the PDU header from the start of dst */
+        size_t size;   /* Size of header and payload */
+
+        rlc_pdu_handle handle;
+};
+
 void rlc_tx_init(struct rlc_context *ctx);
 void rlc_tx_reset(struct rlc_context *ctx);
 void rlc_tx_deinit(struct rlc_context *ctx);
 
+/**
+ * @brief Queue @p buf as an SDU for transmission.
+ *
+ * The SDU takes TX_Next when it is first submitted to the lower layer, its SN
+ * is `RLC_SN_NONE` until then. In AM, SDUs wait in the queue while TX_Next is
+ * outside the TX window.
+ *
+ * @param sdu If not NULL, receives a reference to the queued SDU
+ * @return rlc_errno
+ * @retval -ENODATA @p buf is empty
+ * @retval -ENOBUFS The TX queue limits of the configuration are reached
+ */
 rlc_errno rlc_tx(struct rlc_context *ctx, gabs_pbuf buf, struct rlc_sdu **sdu);
 
+/**
+ * @brief Discard @p sdu from the TX queue.
+ *
+ * This is only possible if the SDU has not been served, i.e no part of it has
+ * been submitted to the lower layer. `RLC_EVENT_TX_RELEASE` is fired with
+ * `RLC_TX_RELEASE_DISCARD`. As @p sdu has not taken an SN, the SNs of other
+ * SDUs are left as they are.
+ *
+ * @return rlc_errno
+ * @retval -EBUSY Parts of @p sdu have already been submitted
+ * @retval -ENOENT @p sdu is not in the TX queue
+ */
+rlc_errno rlc_tx_discard(struct rlc_context *ctx, struct rlc_sdu *sdu);
+
 size_t rlc_tx_avail(struct rlc_context *ctx, size_t size);
 
 size_t rlc_tx_yield(struct rlc_context *ctx, size_t max_size);
 
+/**
+ * @brief Get the amount of data pending for transmission.
+ *
+ * This is cheap enough to be called for every logical channel on every
+ * scheduling opportunity. The fields are read individually without the
+ * context lock, so the result may mix state from before and after a
+ * concurrent update.
+ *
+ * The one exception is the size of a pending status PDU in AM: the first call
+ * after the receive state changed takes the context lock and walks the holes
+ * of the RX window to size it, which costs time linear in the number of SDUs
+ * in the RX window.
+ */
+void rlc_tx_buffer_status(struct rlc_context *ctx,
+                          struct rlc_tx_buffer_status *status);
+
+/**
+ * @brief Get the round trip time estimate of an AM entity.
+ *
+ * The round trip time is measured from a PDU carrying a poll to the status PDU
+ * answering it. Polls that are retransmitted are not measured, as the status
+ * PDU can not be attributed to a single transmission.
+ */
+void rlc_tx_rtt_get(struct rlc_context *ctx, struct rlc_tx_rtt *rtt);
+
+/**
+ * @brief Get the queue management counters and state of @p ctx.
+ *
+ * The distribution of the time SDUs spend in the TX queue is recorded by the
+ * `RLC_LATENCY_TX_QUEUE` and `RLC_LATENCY_TX_DROP` histograms, if attached.
+ */
+void rlc_tx_aqm_stats_get(struct rlc_context *ctx,
+                          struct rlc_tx_aqm_stats *stats);
+
+/**
+ * @brief Report that the PDU referred to by @p handle was lost by the lower
+ * layer, e.g. when HARQ gave up on the transport block carrying it.
+ *
+ * The bytes of the SDU carried by the PDU are queued for retransmission right
+ * away, the same as if the peer had reported them missing in a status PDU. A
+ * lost status PDU triggers a new one. Only available in AM.
+ *
+ * @return rlc_errno
+ * @retval -ENOTSUP The entity is not in AM
+ * @retval -ENOENT The SDU is no longer in the TX queue, e.g. because it has
+ * been acknowledged since
+ * @retval -EINVAL The PDU carried SDU bytes past the offsets a handle can
+ * refer to, leaving them to the status PDUs of the peer
+ */
+rlc_errno rlc_tx_lost(struct rlc_context *ctx, rlc_pdu_handle handle);
+
+/**
+ * @brief Fill a transmit opportunity of @p grant bytes, writing the PDUs
+ * directly into @p dst instead of submitting them through the backend.
+ *
+ * PDUs are written back to back, and the location of each is stored in
+ * @p pdus so that the caller can add its own subheaders. Data and status PDUs
+ * are written straight into @p dst without any intermediate allocation, and
+ * no TX request is issued to the backend for data left over.
+ *
+ * @param ctx
+ * @param dst Memory of at least @p grant bytes
+ * @param grant Size of the transmit opportunity
+ * @param pdus Array receiving the location of each PDU
+ * @param pdu_count On input the number of entries in @p pdus, on output the
+ * number of PDUs written.
+ * @param pending Set if data is left for another opportunity, may be NULL
+ * @return size_t Number of bytes written to @p dst
+ */
+size_t rlc_tx_build(struct rlc_context *ctx, uint8_t *dst, size_t grant,
+                    struct rlc_tx_pdu_info *pdus, size_t *pdu_count,
+                    bool *pending);
+
 RLC_END_DECL
 
 #endif /* RLC_TX_H__ */
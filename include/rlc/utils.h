@@ -28,6 +28,22 @@ RLC_BEGIN_DECL
 
 #define rlc_array_size(x) (sizeof(x) / sizeof((x)[0]))
 
+/* Relaxed atomic access, for fields that are written with the context lock
+ * held but read without it. */
+#define rlc_atomic_load(ptr)       __atomic_load_n(ptr, __ATOMIC_RELAXED)
+#define rlc_atomic_store(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_RELAXED)
+#define rlc_atomic_add(ptr, val)   __atomic_fetch_add(ptr, val, __ATOMIC_RELAXED)
+
+/* Ordered access, for data handed between threads without a lock */
+#define rlc_atomic_load_acquire(ptr) __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define rlc_atomic_store_release(ptr, val)                                     \
+        __atomic_store_n(ptr, val, __ATOMIC_RELEASE)
+#define rlc_atomic_cas(ptr, expected, desired)                                 \
+        __atomic_compare_exchange_n(ptr, expected, desired, false,             \
+                                    __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)
+#define rlc_atomic_sub_acq_rel(ptr, val)                                       \
+        __atomic_fetch_sub(ptr, val, __ATOMIC_ACQ_REL)
+
 RLC_END_DECL
 
 #endif /* RLC_UTILS_H__ */
@@ -0,0 +1,70 @@
+
+#ifndef RLC_VCLOCK_H__
+#define RLC_VCLOCK_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <gabs/mutex.h>
+
+#include <rlc/utils.h>
+#include <rlc/errno.h>
+#include <rlc/list.h>
+
+RLC_BEGIN_DECL
+
+struct rlc_context;
+
+/**
+ * @brief Virtual clock, that only moves when advanced explicitly.
+ *
+ * Contexts attached to a virtual clock read the time from it, and their
+ * timers fire from `rlc_time_advance` instead of from the timer context of
+ * the platform. Any number of contexts may share a clock, so that both ends
+ * of a simulated link agree on the time.
+ */
+struct rlc_vclock {
+        uint64_t now_us;
+
+        rlc_dlist timers; /* Armed timers, ordered by due time */
+        gabs_mutex lock;
+};
+
+rlc_errno rlc_vclock_init(struct rlc_vclock *clock, uint64_t start_us);
+rlc_errno rlc_vclock_deinit(struct rlc_vclock *clock);
+
+/**
+ * @brief Run the timers and clock of @p ctx on @p clock, or on the platform
+ * again if @p clock is NULL.
+ *
+ * Timers that are armed when switching are stopped, which may stall an
+ * entity in the middle of a transfer, so this is meant to be called before
+ * traffic starts.
+ *
+ * @retval -EBUSY Timers of @p ctx are running on the platform
+ */
+rlc_errno rlc_vclock_attach(struct rlc_context *ctx, struct rlc_vclock *clock);
+
+/** @brief Current time of @p clock */
+uint64_t rlc_vclock_now_us(struct rlc_vclock *clock);
+
+/**
+ * @brief Get the time at which the next timer is due.
+ *
+ * @return bool False if no timer is armed
+ */
+bool rlc_vclock_next_due(struct rlc_vclock *clock, uint64_t *due_us);
+
+/**
+ * @brief Move @p clock forward by @p delta_us, firing the timers that become
+ * due on the way in order.
+ *
+ * Callbacks run synchronously on the calling thread, with the clock set to
+ * the time the timer was due. Timers armed by a callback fire in the same
+ * call if they are due before the end of the interval.
+ */
+void rlc_time_advance(struct rlc_vclock *clock, uint64_t delta_us);
+
+RLC_END_DECL
+
+#endif /* RLC_VCLOCK_H__ */
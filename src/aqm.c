@@ -0,0 +1,165 @@
+
+#include <rlc/rlc.h>
+
+#include "aqm.h"
+#include "clock.h"
+#include "common.h"
+
+/* CoDel as in RFC 8289, with the TX queue as its queue. An SDU is dequeued
+ * when it is first submitted, as that is when its time in the queue ends. */
+
+#define AQM_INTERVAL_DEFAULT_US (100000)
+
+/* The sojourn time has to stay above target for this many intervals after
+ * leaving the dropping state for the drop rate to resume where it was */
+#define AQM_RESUME_INTERVALS (16)
+
+static uint32_t aqm_interval_us(const struct rlc_context *ctx)
+{
+        return ctx->conf->aqm_interval_us != 0 ? ctx->conf->aqm_interval_us
+                                               : AQM_INTERVAL_DEFAULT_US;
+}
+
+static uint32_t isqrt(uint32_t value)
+{
+        uint32_t root;
+        uint32_t bit;
+
+        root = 0;
+        bit = UINT32_C(1) << 30;
+
+        while (bit > value) {
+                bit >>= 2;
+        }
+
+        while (bit != 0) {
+                if (value >= root + bit) {
+                        value -= root + bit;
+                        root = (root >> 1) + bit;
+                } else {
+                        root >>= 1;
+                }
+
+                bit >>= 2;
+        }
+
+        return root;
+}
+
+/* Drops become more frequent with the square root of the drop count */
+static uint64_t control_law(const struct rlc_context *ctx, uint64_t t,
+                            uint32_t count)
+{
+        return t + aqm_interval_us(ctx) / isqrt(rlc_max(count, 1));
+}
+
+static bool ok_to_drop(struct rlc_context *ctx, struct rlc_sdu *sdu,
+                       uint64_t now)
+{
+        uint64_t sojourn;
+
+        sojourn = now - sdu->tx.queued_us;
+        ctx->tx.aqm.sojourn_us = (uint32_t)rlc_min(sojourn, UINT32_MAX);
+
+        /* Nothing is gained by dropping the only SDU waiting, as the queue
+         * is about to be empty anyway */
+        if (sojourn < ctx->conf->aqm_target_us || ctx->tx.bs.new_sdus <= 1) {
+                ctx->tx.aqm.first_above_us = 0;
+                return false;
+        }
+
+        if (ctx->tx.aqm.first_above_us == 0) {
+                ctx->tx.aqm.first_above_us = now + aqm_interval_us(ctx);
+                return false;
+        }
+
+        return now >= ctx->tx.aqm.first_above_us;
+}
+
+/* Whether the dropping state was left recently enough to pick up the drop
+ * rate from before */
+static bool recently_dropping(const struct rlc_context *ctx, uint64_t now)
+{
+        uint64_t window;
+
+        window = (uint64_t)AQM_RESUME_INTERVALS * aqm_interval_us(ctx);
+
+        return now < ctx->tx.aqm.drop_next_us ||
+               now - ctx->tx.aqm.drop_next_us < window;
+}
+
+void rlc_aqm_reset(struct rlc_context *ctx)
+{
+        ctx->tx.aqm.first_above_us = 0;
+        ctx->tx.aqm.drop_next_us = 0;
+        ctx->tx.aqm.count = 0;
+        ctx->tx.aqm.last_count = 0;
+        ctx->tx.aqm.dropping = false;
+        ctx->tx.aqm.sojourn_us = 0;
+}
+
+bool rlc_aqm_dequeue(struct rlc_context *ctx, struct rlc_sdu *sdu)
+{
+        uint64_t now;
+        uint32_t delta;
+        bool drop;
+
+        if (ctx->conf->aqm_target_us == 0) {
+                return false;
+        }
+
+        now = rlc_clock_now_us(ctx);
+        drop = false;
+
+        if (!ok_to_drop(ctx, sdu, now)) {
+                ctx->tx.aqm.dropping = false;
+        } else if (ctx->tx.aqm.dropping) {
+                if (now >= ctx->tx.aqm.drop_next_us) {
+                        ctx->tx.aqm.count++;
+                        ctx->tx.aqm.drop_next_us =
+                                control_law(ctx, ctx->tx.aqm.drop_next_us,
+                                            ctx->tx.aqm.count);
+                        drop = true;
+                }
+        } else {
+                delta = ctx->tx.aqm.count - ctx->tx.aqm.last_count;
+
+                ctx->tx.aqm.count = 1;
+                if (delta > 1 && recently_dropping(ctx, now)) {
+                        ctx->tx.aqm.count = delta;
+                }
+
+                ctx->tx.aqm.drop_next_us =
+                        control_law(ctx, now, ctx->tx.aqm.count);
+                ctx->tx.aqm.last_count = ctx->tx.aqm.count;
+                ctx->tx.aqm.dropping = true;
+                drop = true;
+        }
+
+        if (!drop) {
+                return false;
+        }
+
+        if (ctx->conf->aqm_action == RLC_AQM_MARK) {
+                ctx->tx.aqm.marked++;
+                rlc_event_tx_mark(ctx, sdu);
+                return false;
+        }
+
+        ctx->tx.aqm.dropped++;
+        return true;
+}
+
+void rlc_tx_aqm_stats_get(struct rlc_context *ctx,
+                          struct rlc_tx_aqm_stats *stats)
+{
+        rlc_lock_acquire(&ctx->lock);
+
+        stats->dropped = ctx->tx.aqm.dropped;
+        stats->marked = ctx->tx.aqm.marked;
+        stats->sojourn_us = ctx->tx.aqm.sojourn_us;
+        stats->dropping = ctx->tx.aqm.dropping;
+        stats->count = ctx->tx.aqm.count;
+
+        rlc_lock_release(&ctx->lock);
+}
@@ -0,0 +1,26 @@
+
+#ifndef RLC_AQM_INTERNAL_H__
+#define RLC_AQM_INTERNAL_H__
+
+#include <stdbool.h>
+
+#include <rlc/rlc.h>
+
+RLC_BEGIN_DECL
+
+/** @brief Return to the initial state, keeping the counters */
+void rlc_aqm_reset(struct rlc_context *ctx);
+
+/**
+ * @brief Run CoDel on @p sdu, which is about to be submitted for the first
+ * time. Must be called with the context lock held.
+ *
+ * SDUs that are to be marked are marked here.
+ *
+ * @return bool Whether @p sdu is to be dropped by the caller
+ */
+bool rlc_aqm_dequeue(struct rlc_context *ctx, struct rlc_sdu *sdu);
+
+RLC_END_DECL
+
+#endif /* RLC_AQM_INTERNAL_H__ */
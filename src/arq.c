@@ -9,33 +9,104 @@
 #include <rlc/backend.h>
 
 #include "encode.h"
+#include "buffer_status.h"
+#include "clock.h"
+#include "common.h"
+#include "latency.h"
 #include "log.h"
+#include "mem.h"
+#include "trace.h"
 
-struct status_pool {
-        struct rlc_pdu_status mem[2];
-        size_t index;
-        size_t alloc_count;
-};
+/* Lower bound of the variation term of the retransmission timeout, so that a
+ * steady round trip time does not give a timeout equal to it. */
+#define RTT_GRANULARITY_US 1000
 
-static struct rlc_pdu_status *status_get(struct status_pool *pool)
-{
-        return &pool->mem[pool->index];
-}
+/* Maximum exponent of the t-PollRetransmit backoff */
+#define RTT_BACKOFF_MAX 6
 
-static struct rlc_pdu_status *status_last(struct status_pool *pool)
-{
-        return &pool->mem[1 - pool->index];
-}
+/* An unchanged status PDU is sent again after this many t-StatusProhibit
+ * intervals, in case the previous one was lost */
+#define STATUS_REPEAT_PROHIBITS 4
+
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME  16777619u
 
-static void status_advance(struct status_pool *pool)
+/* Section 5.3.3.2, with the duration of t-PollRetransmit derived from the
+ * round trip time if configured. */
+static uint32_t poll_retransmit_us(struct rlc_context *ctx)
 {
-        pool->alloc_count++;
-        pool->index = 1 - pool->index;
+        const struct rlc_config *conf;
+        uint64_t timeout;
+
+        conf = ctx->conf;
+
+        if (conf->time_poll_retransmit_max_us == 0 ||
+            ctx->arq.rtt.samples == 0) {
+                return conf->time_poll_retransmit_us;
+        }
+
+        timeout = (uint64_t)ctx->arq.rtt.srtt_us +
+                  rlc_max(RTT_GRANULARITY_US,
+                          (uint64_t)ctx->arq.rtt.rttvar_us * 4);
+        timeout <<= ctx->arq.rtt.backoff;
+
+        timeout = rlc_min(timeout, conf->time_poll_retransmit_max_us);
+        timeout = rlc_max(timeout, conf->time_poll_retransmit_min_us);
+
+        return (uint32_t)timeout;
 }
 
-static size_t status_count(struct status_pool *pool)
+/* Take a sample if the status PDU with @p ack_sn answers the timed poll */
+static void rtt_sample(struct rlc_context *ctx, uint32_t ack_sn)
 {
-        return pool->alloc_count;
+        uint64_t sample;
+        uint64_t delta;
+        uint64_t bdp;
+
+        if (!ctx->arq.rtt.timing || ack_sn <= ctx->arq.rtt.sn) {
+                return;
+        }
+
+        ctx->arq.rtt.timing = false;
+        ctx->arq.rtt.backoff = 0;
+
+        sample = rlc_clock_now_us(ctx) - ctx->arq.rtt.poll_us;
+        sample = rlc_min(sample, UINT32_MAX);
+
+        bdp = ctx->arq.tx_bytes - ctx->arq.rtt.poll_bytes;
+        bdp = rlc_min(bdp, UINT32_MAX);
+
+        if (ctx->arq.rtt.samples == 0) {
+                ctx->arq.rtt.srtt_us = (uint32_t)sample;
+                ctx->arq.rtt.rttvar_us = (uint32_t)sample / 2;
+                ctx->arq.rtt.bdp_bytes = (uint32_t)bdp;
+        } else {
+                ctx->arq.rtt.bdp_bytes = (uint32_t)((
+                        7 * (uint64_t)ctx->arq.rtt.bdp_bytes + bdp) / 8);
+
+                delta = sample > ctx->arq.rtt.srtt_us
+                                ? sample - ctx->arq.rtt.srtt_us
+                                : ctx->arq.rtt.srtt_us - sample;
+
+                ctx->arq.rtt.rttvar_us =
+                        (uint32_t)((3 * (uint64_t)ctx->arq.rtt.rttvar_us +
+                                    delta) /
+                                   4);
+                ctx->arq.rtt.srtt_us =
+                        (uint32_t)((7 * (uint64_t)ctx->arq.rtt.srtt_us +
+                                    sample) /
+                                   8);
+        }
+
+        if (ctx->arq.rtt.samples < UINT32_MAX) {
+                ctx->arq.rtt.samples++;
+        }
+
+        gabs_log_dbgf(ctx->logger,
+                      "RTT sample %" PRIu64 " us, SRTT %" PRIu32
+                      " us, RTTVAR %" PRIu32 " us, BDP %" PRIu32 " bytes",
+                      sample, ctx->arq.rtt.srtt_us, ctx->arq.rtt.rttvar_us,
+                      ctx->arq.rtt.bdp_bytes);
 }
 
 static void alarm_poll_retransmit(struct rlc_timer *timer,
@@ -45,6 +116,14 @@ static void alarm_poll_retransmit(struct rlc_timer *timer,
 
         ctx->arq.force_poll = true;
 
+        /* The status PDU may still answer the original poll, so the sample
+         * would be ambiguous (Karn's algorithm). */
+        ctx->arq.rtt.timing = false;
+
+        if (ctx->arq.rtt.backoff < RTT_BACKOFF_MAX) {
+                ctx->arq.rtt.backoff++;
+        }
+
         rlc_backend_tx_request(ctx);
 }
 
@@ -55,7 +134,65 @@ static void alarm_status_prohibit(struct rlc_timer *timer,
 
         ctx->arq.status_prohibit = false;
 
-        rlc_backend_tx_request(ctx);
+        if (ctx->arq.gen_status) {
+                rlc_backend_tx_request(ctx);
+        }
+}
+
+/* Section 5.3.4, with the duration of t-StatusProhibit derived from the poll
+ * interval if configured. */
+static uint32_t status_prohibit_us(struct rlc_context *ctx)
+{
+        const struct rlc_config *conf;
+        uint64_t timeout;
+
+        conf = ctx->conf;
+
+        if (conf->time_status_prohibit_max_us == 0 ||
+            ctx->arq.report.poll_gap_us == 0) {
+                return conf->time_status_prohibit_us;
+        }
+
+        timeout = (uint64_t)ctx->arq.report.poll_gap_us * 2;
+        timeout = rlc_min(timeout, conf->time_status_prohibit_max_us);
+        timeout = rlc_max(timeout, conf->time_status_prohibit_us);
+
+        return (uint32_t)timeout;
+}
+
+static void poll_sample(struct rlc_context *ctx)
+{
+        uint64_t now;
+        uint64_t gap;
+        uint32_t smoothed;
+
+        now = rlc_clock_now_us(ctx);
+        ctx->arq.report.polls++;
+
+        if (ctx->arq.report.polls > 1) {
+                gap = rlc_min(now - ctx->arq.report.poll_us, UINT32_MAX);
+                smoothed = ctx->arq.report.poll_gap_us;
+
+                ctx->arq.report.poll_gap_us =
+                        smoothed == 0 ? (uint32_t)gap
+                                      : (uint32_t)((7 * (uint64_t)smoothed +
+                                                    gap) /
+                                                   8);
+        }
+
+        ctx->arq.report.poll_us = now;
+}
+
+static uint32_t fnv_add(uint32_t hash, uint32_t value)
+{
+        size_t i;
+
+        for (i = 0; i < sizeof(value); i++) {
+                hash ^= (value >> (8 * i)) & 0xff;
+                hash *= FNV_PRIME;
+        }
+
+        return hash;
 }
 
 static rlc_errno restart_status_prohibit(struct rlc_context *ctx)
@@ -63,7 +200,7 @@ static rlc_errno restart_status_prohibit(struct rlc_context *ctx)
         rlc_errno status;
 
         status = rlc_timer_restart(&ctx->arq.t_status_prohibit,
-                                   ctx->conf->time_status_prohibit_us);
+                                   status_prohibit_us(ctx));
         if (status == 0) {
                 ctx->arq.status_prohibit = true;
         }
@@ -71,185 +208,275 @@ static rlc_errno restart_status_prohibit(struct rlc_context *ctx)
         return status;
 }
 
-static void log_rx_status(const gabs_logger_h *logger,
-                          struct rlc_pdu_status *status)
+/* Status PDU under construction. Entries are encoded one behind, so that the
+ * E1 bit of each can be set once it is known whether another one follows. */
+struct status_builder {
+        struct rlc_context *ctx;
+
+        /* Entries are written in place when building into caller memory,
+         * and to a buffer otherwise */
+        uint8_t *mem;
+        gabs_pbuf buf;
+        size_t used; /* Bytes of entries written */
+        size_t budget; /* Bytes left for entries */
+
+        /* Only the size of the entries is wanted, nothing is encoded */
+        bool measure;
+
+        struct rlc_pdu_status pending;
+        bool has_pending;
+
+        /* Missing bytes from SOstart of `first_sn` up to SOend of `last_sn`,
+         * not yet turned into entries */
+        struct {
+                uint32_t first_sn;
+                uint32_t last_sn;
+                struct rlc_seg offset;
+        } hole;
+        bool has_hole;
+
+        /* Set when an entry did not fit, ACK_SN is then the first SN that
+         * could not be reported */
+        bool full;
+        uint32_t ack_sn;
+
+        /* SNs up to this one are reported whole by an entry that lost its
+         * SO to fit */
+        bool has_whole;
+        uint32_t whole_sn;
+
+        uint32_t hash; /* Fingerprint of the entries added */
+};
+
+/* Write @p entry after the entries already in @p builder */
+static void status_entry_put(struct status_builder *builder,
+                             const struct rlc_pdu_status *entry)
+{
+        uint8_t data[RLC_STATUS_MAX_SIZE];
+        size_t size;
+
+        size = rlc_status_encode_raw(builder->ctx, entry, data);
+
+        if (builder->mem != NULL) {
+                (void)memcpy(builder->mem + builder->used, data, size);
+        } else {
+                gabs_pbuf_put(&builder->buf, data, size);
+        }
+
+        builder->used += size;
+}
+
+/* Last SN reported missing by @p entry */
+static uint32_t status_entry_last(const struct rlc_pdu_status *entry)
+{
+        return entry->nack_sn + (entry->ext.has_range ? entry->range : 1) - 1;
+}
+
+/* Report the SNs of @p entry from @p first_sn on, and all of @p first_sn */
+static void status_entry_trim(struct rlc_pdu_status *entry, uint32_t first_sn)
 {
-        gabs_log_dbgf(logger,
-                      "RX AM STATUS; Detected missing; SN: "
-                      "%" PRIu32 ", RANGE:  %" PRIu32 "->%" PRIu32,
-                      status->nack_sn, status->offset.start,
-                      status->offset.end);
+        uint32_t count;
+
+        count = status_entry_last(entry) - first_sn + 1;
+
+        entry->nack_sn = first_sn;
+        entry->offset.start = 0;
+
+        entry->ext.has_range = count > 1;
+        entry->range = entry->ext.has_range ? count : 0;
+        entry->ext.has_offset = entry->offset.end != RLC_STATUS_SO_MAX;
 }
 
-static ptrdiff_t encode_last(struct rlc_context *ctx, struct status_pool *pool,
-                             gabs_pbuf *buf)
+/*
+ * @brief Add @p entry to the status PDU, or as much of it as fits
+ *
+ * Asking for more than what is missing beats leaving a hole out, as ACK_SN
+ * then stops at it and nothing after it is acknowledged. If the entry does not
+ * fit, the SO is dropped so that whole SDUs are reported, and then the range,
+ * so that only the first SN is. The status PDU is truncated only if not even
+ * that fits.
+ */
+static void status_entry_add(struct status_builder *builder,
+                             struct rlc_pdu_status *entry)
 {
-        struct rlc_pdu_status *last;
         size_t size;
+        bool range_dropped;
+
+        /* SDUs already reported whole are left out */
+        if (builder->has_whole && entry->nack_sn <= builder->whole_sn) {
+                if (status_entry_last(entry) <= builder->whole_sn) {
+                        return;
+                }
+
+                status_entry_trim(entry, builder->whole_sn + 1);
+        }
 
-        last = status_last(pool);
-        last->ext.has_more = 1;
+        range_dropped = false;
 
-        log_rx_status(ctx->logger, last);
+        size = rlc_status_size(builder->ctx, entry);
+        if (size > builder->budget && entry->ext.has_offset) {
+                entry->ext.has_offset = 0;
+                entry->offset.start = 0;
+                entry->offset.end = RLC_STATUS_SO_MAX;
 
-        size = rlc_status_size(ctx, last);
-        if (size > gabs_pbuf_tailroom(*buf)) {
-                return -ENOSPC;
+                builder->has_whole = true;
+                builder->whole_sn = status_entry_last(entry);
+
+                size = rlc_status_size(builder->ctx, entry);
         }
 
-        rlc_status_encode(ctx, last, buf);
+        if (size > builder->budget && entry->ext.has_range) {
+                entry->ext.has_range = 0;
+                entry->range = 0;
+                range_dropped = true;
 
-        return size;
-}
+                size = rlc_status_size(builder->ctx, entry);
+        }
 
-static ptrdiff_t create_nack_range(struct rlc_context *ctx,
-                                   struct status_pool *pool, gabs_pbuf *buf,
-                                   struct rlc_sdu *sdu_next, uint32_t sn)
-{
-        struct rlc_pdu_status *cur_status;
-        ptrdiff_t ret;
-        uint32_t range_diff;
+        if (size > builder->budget) {
+                builder->full = true;
+                builder->ack_sn = entry->nack_sn;
 
-        gabs_log_dbgf(ctx->logger,
-                      "Generating NACK range: %" PRIu32 "->%" PRIu32, sn,
-                      sdu_next->sn);
-        rlc_assert(sdu_next->sn >= sn);
+                gabs_log_wrnf(builder->ctx->logger,
+                              "Status truncated at SN %" PRIu32
+                              "; grant too small",
+                              entry->nack_sn);
+                return;
+        }
 
-        ret = 0;
-        cur_status = status_get(pool);
-        range_diff = sdu_next->sn - sn;
+        builder->budget -= size;
 
-        *cur_status = (struct rlc_pdu_status){
-                .ext.has_range = range_diff > 1,
-                .nack_sn = sn,
-                .range = range_diff,
-        };
+        /* The rest of the range is left to the next status PDU */
+        if (range_dropped) {
+                builder->full = true;
+                builder->ack_sn = entry->nack_sn + 1;
+        }
 
-        if (status_count(pool) > 1) {
-                ret = encode_last(ctx, pool, buf);
+        if (builder->measure) {
+                return;
         }
 
-        status_advance(pool);
+        if (builder->has_pending) {
+                builder->pending.ext.has_more = 1;
+                status_entry_put(builder, &builder->pending);
+        }
 
-        return ret;
+        rlc_trace(builder->ctx, RLC_TRACE_TX_NACK, entry->nack_sn,
+                  entry->offset.start, entry->offset.end, entry->range, 0);
+
+        builder->pending = *entry;
+        builder->has_pending = true;
+
+        builder->hash = fnv_add(builder->hash, entry->nack_sn);
+        builder->hash = fnv_add(builder->hash, entry->range);
+        builder->hash = fnv_add(builder->hash, entry->offset.start);
+        builder->hash = fnv_add(builder->hash, entry->offset.end);
 }
 
-static size_t create_nack_segment(struct rlc_context *ctx,
-                                  struct status_pool *pool, gabs_pbuf *buf,
-                                  uint32_t sn, struct rlc_seg segment)
+/* Turn the pending hole into entries, splitting it where the range does not
+ * fit in NACK_range. */
+static void status_hole_flush(struct status_builder *builder)
 {
-        struct rlc_pdu_status *cur_status;
-        ptrdiff_t bytes;
+        struct rlc_pdu_status entry;
+        uint32_t first;
+        uint32_t last;
+        uint32_t count;
 
-        cur_status = status_get(pool);
-        bytes = 0;
+        if (!builder->has_hole) {
+                return;
+        }
 
-        *cur_status = (struct rlc_pdu_status){
-                .ext.has_offset = 1,
-                .nack_sn = sn,
-                .offset = segment,
-        };
+        builder->has_hole = false;
 
-        gabs_log_dbgf(ctx->logger, "%" PRIu32 "->%" PRIu32,
-                      cur_status->offset.start, cur_status->offset.end);
+        for (first = builder->hole.first_sn;
+             first <= builder->hole.last_sn && !builder->full;
+             first += count) {
+                count = rlc_min(builder->hole.last_sn - first + 1,
+                                RLC_STATUS_RANGE_MAX);
+                last = first + count - 1;
 
-        /* Encode the last status instead of the current
-         * one, so that the E1 bit can be set
-         * appropriately. On the first iteration, skip
-         * encoding as there is no last */
-        if (status_count(pool) > 0) {
-                bytes = encode_last(ctx, pool, buf);
-                if (bytes == -ENOSPC) {
-                        return 0;
-                }
+                (void)memset(&entry, 0, sizeof(entry));
+
+                entry.nack_sn = first;
+                entry.offset.start = first == builder->hole.first_sn
+                                             ? builder->hole.offset.start
+                                             : 0;
+                entry.offset.end = last == builder->hole.last_sn
+                                           ? builder->hole.offset.end
+                                           : RLC_STATUS_SO_MAX;
+
+                entry.ext.has_range = count > 1;
+                entry.range = entry.ext.has_range ? count : 0;
+                entry.ext.has_offset = entry.offset.start != 0 ||
+                                       entry.offset.end != RLC_STATUS_SO_MAX;
+
+                status_entry_add(builder, &entry);
         }
+}
 
-        status_advance(pool);
-        return (size_t)bytes;
+/*
+ * @brief Report bytes @p offset missing from SN @p first_sn to @p last_sn
+ *
+ * The start of @p offset applies to @p first_sn and the end to @p last_sn, so
+ * a hole from the tail of one SDU to the head of a later one is reported as a
+ * single NACK_range entry.
+ */
+static void status_hole_add(struct status_builder *builder, uint32_t first_sn,
+                            uint32_t last_sn, struct rlc_seg offset)
+{
+        if (builder->full) {
+                return;
+        }
+
+        /* Continues the pending hole if that reaches the end of its last SDU,
+         * and this starts at the beginning of the next. */
+        if (builder->has_hole &&
+            builder->hole.offset.end == RLC_STATUS_SO_MAX &&
+            builder->hole.last_sn + 1 == first_sn && offset.start == 0) {
+                builder->hole.last_sn = last_sn;
+                builder->hole.offset.end = offset.end;
+                return;
+        }
+
+        status_hole_flush(builder);
+
+        builder->hole.first_sn = first_sn;
+        builder->hole.last_sn = last_sn;
+        builder->hole.offset = offset;
+        builder->has_hole = true;
 }
 
-static ptrdiff_t create_nack_offset(struct rlc_context *ctx,
-                                    struct status_pool *pool, gabs_pbuf *buf,
-                                    struct rlc_sdu *sdu)
+/* Report the byte ranges missing from @p sdu, oldest first */
+static void status_sdu_add(struct status_builder *builder, struct rlc_sdu *sdu)
 {
         struct rlc_seg_item *seg;
-        struct rlc_seg_item *last;
-        struct rlc_seg_item *next;
-        bool has_more;
-        ptrdiff_t bytes;
-        size_t max_size;
-        size_t remaining;
-        rlc_list_it it;
-
-        max_size = gabs_pbuf_tailroom(*buf);
-        remaining = max_size;
-        last = NULL;
-
-        rlc_list_foreach(&sdu->rx.buffer.segments, it)
-        {
-                seg = rlc_seg_item_from_it(it);
-                next = rlc_seg_item_from_it(rlc_list_it_next(it));
-                has_more = !rlc_list_it_eoi(rlc_list_it_next(it));
+        uint32_t next;
+        rlc_dlist_it it;
 
-                /* No more missing segments */
-                if (!has_more && seg->seg.start == 0 && sdu->rx.last_received) {
-                        /* TODO: This should be safe to remove, assuming this
-                         * function is not called for done SDUs? */
-                        rlc_assert(0);
-                        break;
-                }
+        next = 0;
 
-                /* Check if first segment(s) are missing */
-                if (last == NULL && seg->seg.start != 0) {
-                        bytes = create_nack_segment(
-                                ctx, pool, buf, sdu->sn,
-                                (struct rlc_seg){
-                                        .start = 0,
-                                        .end = seg->seg.start,
-                                });
-                        if (bytes == 0) {
-                                break;
-                        }
+        rlc_dlist_foreach(&sdu->rx.buffer.segments, it)
+        {
+                seg = rlc_seg_item_from_it(it);
 
-                        remaining -= bytes;
+                if (seg->seg.start > next) {
+                        status_hole_add(builder, sdu->sn, sdu->sn,
+                                        (struct rlc_seg){
+                                                .start = next,
+                                                .end = seg->seg.start,
+                                        });
                 }
 
-                /* Check if last segment(s) are missing */
-                if (has_more) {
-                        /* Between two segments */
-                        bytes = create_nack_segment(
-                                ctx, pool, buf, sdu->sn,
-                                (struct rlc_seg){
-                                        .start = seg->seg.end,
-                                        .end = next->seg.start,
-                                });
-                        if (bytes == 0) {
-                                break;
-                        }
+                next = seg->seg.end;
+        }
 
-                        remaining -= bytes;
-                } else if (!sdu->rx.last_received) {
-                        /* Last segment registered, but last
-                         * segment of the transmission has not
-                         * been received */
-                        /* Between two segments */
-                        bytes = create_nack_segment(
-                                ctx, pool, buf, sdu->sn,
+        if (!sdu->rx.last_received) {
+                status_hole_add(builder, sdu->sn, sdu->sn,
                                 (struct rlc_seg){
-                                        .start = seg->seg.end,
+                                        .start = next,
                                         .end = RLC_STATUS_SO_MAX,
                                 });
-                        if (bytes == 0) {
-                                break;
-                        }
-
-                        remaining -= bytes;
-                }
-
-                last = seg;
         }
-
-        return max_size - remaining;
 }
 
 static void tx_win_shift(struct rlc_context *ctx)
@@ -257,21 +484,23 @@ static void tx_win_shift(struct rlc_context *ctx)
         struct rlc_sdu *sdu;
         uint32_t lowest;
 
+        /* Only SDUs that have not taken an SN may be left */
         sdu = rlc_sdu_queue_head(&ctx->tx.sdus);
-        lowest = sdu == NULL ? ctx->tx.next_sn : sdu->sn;
+        lowest = sdu == NULL || sdu->sn == RLC_SN_NONE ? ctx->tx.next_sn
+                                                       : sdu->sn;
 
         rlc_window_move_to(&ctx->tx.win, lowest);
-        gabs_log_dbgf(ctx->logger, "TX AM: TX_NEXT_ACK=%" PRIu32, lowest);
 }
 
 static void tx_ack(struct rlc_context *ctx, uint16_t sn)
 {
         struct rlc_sdu *sdu;
-        rlc_list_it it;
+        uint64_t now_us;
+        rlc_dlist_it it;
 
-        gabs_log_dbgf(ctx->logger, "TX AM STATUS ACK; ACK_SN: %" PRIu32, sn);
+        now_us = rlc_clock_now_us(ctx);
 
-        rlc_list_foreach(&ctx->tx.sdus, it)
+        rlc_dlist_foreach(&ctx->tx.sdus, it)
         {
                 sdu = rlc_sdu_from_it(it);
 
@@ -283,12 +512,15 @@ static void tx_ack(struct rlc_context *ctx, uint16_t sn)
                         break;
                 }
 
-                it = rlc_list_it_pop(it, NULL);
+                it = rlc_dlist_it_pop(it, NULL);
 
                 if (sdu->sn == rlc_window_base(&ctx->tx.win)) {
                         tx_win_shift(ctx);
                 }
 
+                rlc_bs_sdu_remove(ctx, sdu);
+                rlc_latency_add(ctx, RLC_LATENCY_TX_ACK, sdu->tx.sent_us,
+                                now_us);
                 rlc_event_tx_done(ctx, sdu);
                 rlc_sdu_decref(sdu);
         }
@@ -297,9 +529,11 @@ static void tx_ack(struct rlc_context *ctx, uint16_t sn)
 static void tx_nack_clear(struct rlc_context *ctx, uint16_t sn)
 {
         struct rlc_sdu *sdu;
-        rlc_list_it it;
+        struct rlc_bs_sdu bs_before;
+        struct rlc_bs_sdu bs_after;
+        rlc_dlist_it it;
 
-        rlc_list_foreach(&ctx->tx.sdus, it)
+        rlc_dlist_foreach(&ctx->tx.sdus, it)
         {
                 sdu = rlc_sdu_from_it(it);
 
@@ -307,7 +541,12 @@ static void tx_nack_clear(struct rlc_context *ctx, uint16_t sn)
                         break;
                 }
 
+                rlc_bs_sdu_get(sdu, &bs_before);
                 rlc_seg_list_clear_until_last(&sdu->tx.unsent, ctx->alloc_misc);
+                rlc_bs_sdu_get(sdu, &bs_after);
+
+                rlc_bs_sdu_update(ctx, &bs_before, &bs_after);
+                rlc_mem_sdu_sync(sdu);
         }
 }
 
@@ -327,8 +566,12 @@ static bool retransmit_sdu(struct rlc_context *ctx, struct rlc_sdu *sdu,
                            struct rlc_seg *seg)
 {
         struct rlc_seg uniq;
+        struct rlc_bs_sdu bs_before;
+        struct rlc_bs_sdu bs_after;
         rlc_errno status;
 
+        rlc_bs_sdu_get(sdu, &bs_before);
+
         status = rlc_seg_list_insert(&sdu->tx.unsent, seg, &uniq,
                                      ctx->alloc_misc);
         if (status == -ENODATA) {
@@ -346,21 +589,25 @@ static bool retransmit_sdu(struct rlc_context *ctx, struct rlc_sdu *sdu,
                 return true;
         }
 
+        rlc_bs_sdu_get(sdu, &bs_after);
+        rlc_bs_sdu_update(ctx, &bs_before, &bs_after);
+        rlc_mem_sdu_sync(sdu);
+
         /* Not already pending for retransmission: increase retx_count,
          * mark for retransmission. */
         if (sdu->state != RLC_READY) {
-                gabs_log_dbgf(ctx->logger,
-                              "Marking SDU SN=%" PRIu32 " for (re)transmission",
-                              sdu->sn);
-
                 sdu->state = RLC_READY;
                 sdu->tx.retx_count++;
         }
 
+        rlc_trace(ctx, RLC_TRACE_TX_RETX, sdu->sn, uniq.start, uniq.end,
+                  sdu->tx.retx_count, 0);
+
         if (sdu->tx.retx_count >= ctx->conf->max_retx_threshhold) {
                 gabs_log_errf(ctx->logger,
                               "Transmit failed; exceeded retry limit");
                 rlc_sdu_queue_remove(&ctx->tx.sdus, sdu);
+                rlc_bs_sdu_remove(ctx, sdu);
 
                 if (sdu->sn == rlc_window_base(&ctx->tx.win)) {
                         tx_win_shift(ctx);
@@ -425,33 +672,131 @@ static void process_nack_range(struct rlc_context *ctx,
         struct rlc_sdu *sdu;
         struct rlc_window nack_win;
         struct rlc_seg seg;
-        rlc_list_it it;
-        rlc_list_it skipped_to;
+        rlc_dlist_it it;
+        rlc_dlist_it skipped_to;
 
         rlc_window_init(&nack_win, cur->nack_sn, cur->range);
 
-        rlc_list_foreach(&ctx->tx.sdus, it)
+        rlc_dlist_foreach(&ctx->tx.sdus, it)
         {
                 sdu = rlc_sdu_from_it(it);
 
                 if (rlc_window_has(&nack_win, sdu->sn)) {
                         seg.start = 0;
                         seg.end = gabs_pbuf_size(sdu->tx.buffer);
-                        skipped_to = rlc_list_it_skip(it);
+
+                        /* SOstart applies to the first SN of the range and
+                         * SOend to the last */
+                        if (cur->ext.has_offset) {
+                                if (sdu->sn == cur->nack_sn) {
+                                        seg.start = cur->offset.start;
+                                }
+
+                                if (sdu->sn == cur->nack_sn + cur->range - 1 &&
+                                    cur->offset.end != RLC_STATUS_SO_MAX) {
+                                        seg.end = cur->offset.end;
+                                }
+                        }
+
+                        skipped_to = rlc_dlist_it_next(it);
 
                         /* Adjust iterator if the SDU is removed/deallocated so
                          * that we don't need to read from invalid memory when
                          * we get the next item in the iterator. */
                         if (!retransmit_sdu(ctx, sdu, &seg)) {
-                                it = rlc_list_it_repeat(skipped_to);
+                                it = rlc_dlist_it_repeat(skipped_to);
                         }
                 }
         }
 }
 
+/*
+ * @brief Check if a status PDU with fingerprint @p hash can be left out
+ *
+ * Only status PDUs triggered by polls alone are suppressed, and only while
+ * the identical previous one is recent enough that it is unlikely to have been
+ * lost. A retransmitted poll shows that it was, and is always answered.
+ */
+static bool status_suppress(struct rlc_context *ctx, uint32_t hash)
+{
+        uint64_t age;
+
+        if (!ctx->arq.report.polled_only || !ctx->arq.report.sent ||
+            ctx->arq.report.repoll || ctx->arq.report.hash != hash) {
+                return false;
+        }
+
+        age = rlc_clock_now_us(ctx) - ctx->arq.report.sent_us;
+
+        return age < (uint64_t)status_prohibit_us(ctx) *
+                             STATUS_REPEAT_PROHIBITS;
+}
+
+/*
+ * @brief Add the SDUs missing from the RX window to @p builder
+ *
+ * @return uint32_t ACK_SN of the status PDU
+ */
+static uint32_t status_build(struct rlc_context *ctx,
+                             struct status_builder *builder)
+{
+        struct rlc_sdu *sdu;
+        rlc_dlist_it it;
+        uint32_t next_sn;
+        uint32_t highest_status;
+
+        next_sn = rlc_window_base(&ctx->rx.win);
+        highest_status = ctx->rx.highest_status;
+
+        rlc_dlist_foreach(&ctx->rx.sdus, it)
+        {
+                sdu = rlc_sdu_from_it(it);
+
+                /* SDUs from RX_Highest_Status may still be in flight */
+                if (sdu->sn >= highest_status || builder->full) {
+                        break;
+                }
+
+                if (sdu->sn != next_sn) {
+                        status_hole_add(builder, next_sn, sdu->sn - 1,
+                                        (struct rlc_seg){
+                                                .start = 0,
+                                                .end = RLC_STATUS_SO_MAX,
+                                        });
+                }
+
+                if (sdu->state != RLC_DONE) {
+                        status_sdu_add(builder, sdu);
+                }
+
+                next_sn = sdu->sn + 1;
+        }
+
+        /* SDUs of which nothing has been received, up to RX_Highest_Status */
+        if (next_sn < highest_status) {
+                status_hole_add(builder, next_sn, highest_status - 1,
+                                (struct rlc_seg){
+                                        .start = 0,
+                                        .end = RLC_STATUS_SO_MAX,
+                                });
+        }
+
+        status_hole_flush(builder);
+
+        /* The RLC spec states: "set the ACK_SN to the SN of the next not
+         * received RLC SDU which is not indicated as missing in the resulting
+         * STATUS PDU". */
+        return builder->full ? builder->ack_sn
+                             : rlc_max(highest_status, next_sn);
+}
+
 /**
  * @brief Generate and submit status PDU to lower layer
  *
+ * If @p max_size can not hold every NACK, the oldest holes are reported and
+ * ACK_SN is set to the first SN left out, so that nothing after it is taken as
+ * received.
+ *
  * @param ctx
  * @param max_size Maximum available bytes in transmit window.
  *
@@ -462,71 +807,66 @@ static size_t tx_status(struct rlc_context *ctx, size_t max_size)
         ptrdiff_t ret;
         rlc_errno status;
         struct rlc_pdu pdu;
-        struct rlc_sdu *sdu;
-        struct status_pool pool;
-        rlc_list_it it;
-        gabs_pbuf buf;
-        ptrdiff_t bytes;
-        uint32_t next_sn;
+        struct status_builder builder;
+        size_t header_size;
+        size_t avail;
 
-        (void)memset(&pool, 0, sizeof(pool));
+        (void)memset(&builder, 0, sizeof(builder));
         (void)memset(&pdu, 0, sizeof(pdu));
 
-        next_sn = rlc_window_base(&ctx->rx.win);
+        pdu.flags.is_status = 1;
 
-        buf = gabs_pbuf_new(ctx->alloc_buf, max_size);
-        if (!gabs_pbuf_okay(buf)) {
-                return -ENOMEM;
+        header_size = rlc_pdu_header_size(ctx, &pdu);
+        if (header_size > max_size) {
+                return 0;
         }
 
-        rlc_list_foreach(&ctx->rx.sdus, it)
-        {
-                sdu = rlc_sdu_from_it(it);
-
-                if (sdu->sn != next_sn) {
-                        bytes = create_nack_range(ctx, &pool, &buf, sdu,
-                                                  next_sn);
-                        if (bytes == -ENOSPC) {
-                                gabs_log_wrnf(
-                                        ctx->logger,
-                                        "Unable to transmit full status: MTU "
-                                        "too low");
-                                break;
-                        }
+        builder.ctx = ctx;
+        builder.budget = max_size - header_size;
+        builder.hash = FNV_OFFSET;
 
-                        max_size -= (size_t)bytes;
-                }
-
-                if (sdu->state != RLC_DONE) {
-                        bytes = create_nack_offset(ctx, &pool, &buf, sdu);
-                        if (bytes == -ENOSPC) {
-                                gabs_log_wrnf(
-                                        ctx->logger,
-                                        "Unable to transmit full status: MTU "
-                                        "too low");
-                                break;
-                        }
-
-                        max_size -= (size_t)bytes;
+        builder.mem = rlc_backend_tx_payload(ctx, &pdu, &avail);
+        if (builder.mem != NULL) {
+                builder.budget = rlc_min(builder.budget, avail);
+        } else if (builder.budget > 0) {
+                builder.buf = gabs_pbuf_new(ctx->alloc_buf, builder.budget);
+                if (!gabs_pbuf_okay(builder.buf)) {
+                        return 0;
                 }
-
-                next_sn = sdu->sn + 1;
         }
 
-        if (status_count(&pool) > 0) {
-                encode_last(ctx, &pool, &buf);
+        pdu.sn = status_build(ctx, &builder);
 
+        if (builder.has_pending) {
+                status_entry_put(&builder, &builder.pending);
                 pdu.flags.ext = 1;
         }
 
-        /* The RLC spec states: "set the ACK_SN to the SN of the next not
-         * received RLC SDU which is not indicated as missing in the resulting
-         * STATUS PDU". This is assumed to mean the SN of the SDU after the ones
-         * we have included in the STATUS PDU. */
-        pdu.sn = next_sn;
-        pdu.flags.is_status = 1;
+        builder.hash = fnv_add(builder.hash, pdu.sn);
 
         ctx->arq.gen_status = false;
+        rlc_atomic_store(&ctx->arq.status_size_stale, false);
+        rlc_bs_status_set(ctx, 0);
+
+        if (status_suppress(ctx, builder.hash)) {
+                rlc_trace(ctx, RLC_TRACE_TX_STATUS_SUPPRESSED, pdu.sn, 0, 0, 0,
+                          0);
+
+                ctx->arq.report.status_suppressed++;
+
+                if (gabs_pbuf_okay(builder.buf)) {
+                        gabs_pbuf_decref(builder.buf);
+                }
+
+                return 0;
+        }
+
+        ctx->arq.report.hash = builder.hash;
+        ctx->arq.report.ack_sn = pdu.sn;
+        ctx->arq.report.sent_us = rlc_clock_now_us(ctx);
+        ctx->arq.report.sent = true;
+        ctx->arq.report.repoll = false;
+        ctx->arq.report.status_sent++;
 
         status = restart_status_prohibit(ctx);
         if (status != 0) {
@@ -536,13 +876,23 @@ static size_t tx_status(struct rlc_context *ctx, size_t max_size)
                         status);
 
                 rlc_assert(0);
-        } else {
-                gabs_log_dbgf(ctx->logger, "Started t-statusProhibit");
         }
 
-        gabs_log_dbgf(ctx->logger, "Submitting status PDU: SN=%i", pdu.sn);
+        rlc_trace(ctx, RLC_TRACE_TX_STATUS, pdu.sn, 0, 0, builder.used, 0);
+
+        if (builder.mem != NULL) {
+                ret = rlc_backend_tx_submit_payload(ctx, &pdu, builder.used);
+        } else {
+                if (!gabs_pbuf_okay(builder.buf)) {
+                        builder.buf = gabs_pbuf_new(ctx->alloc_buf, 0);
+                        if (!gabs_pbuf_okay(builder.buf)) {
+                                return 0;
+                        }
+                }
+
+                ret = rlc_backend_tx_submit(ctx, &pdu, builder.buf);
+        }
 
-        ret = rlc_backend_tx_submit(ctx, &pdu, buf);
         if (ret < 0) {
                 gabs_log_errf(ctx->logger,
                               "Submitting status failed: %" RLC_PRI_ERRNO,
@@ -558,11 +908,11 @@ static struct rlc_sdu *highest_sn_submitted(struct rlc_context *ctx)
 {
         struct rlc_sdu *cur;
         struct rlc_sdu *highest;
-        rlc_list_it it;
+        rlc_dlist_it it;
 
         highest = NULL;
 
-        rlc_list_foreach(&ctx->tx.sdus, it)
+        rlc_dlist_foreach(&ctx->tx.sdus, it)
         {
                 cur = rlc_sdu_from_it(it);
 
@@ -577,15 +927,11 @@ static struct rlc_sdu *highest_sn_submitted(struct rlc_context *ctx)
 
 static struct rlc_seg_item *last_segment(rlc_seg_list *list)
 {
-        rlc_list_it it;
-        rlc_list_it last;
-
-        rlc_list_foreach(list, it)
-        {
-                last = it;
+        if (list->tail == NULL) {
+                return NULL;
         }
 
-        return rlc_seg_item_from_it(last);
+        return gabs_container_of(list->tail, struct rlc_seg_item, list_node);
 }
 
 static size_t tx_poll(struct rlc_context *ctx, size_t max_size)
@@ -651,22 +997,54 @@ size_t rlc_arq_tx_yield(struct rlc_context *ctx, size_t max_size)
 
         ret = 0;
 
+        if (!rlc_backend_tx_room(ctx)) {
+                return ret;
+        }
+
         if (ctx->arq.gen_status && !ctx->arq.status_prohibit) {
                 ret += tx_status(ctx, max_size);
         }
 
         if (ctx->arq.force_poll) {
-                ret += tx_poll(ctx, max_size);
+                ret += tx_poll(ctx, max_size - ret);
         }
 
         return ret;
 }
 
-static bool tx_pollable(struct rlc_context *ctx, struct rlc_sdu *sdu)
+bool rlc_arq_tx_pending(struct rlc_context *ctx)
+{
+        return (ctx->arq.gen_status && !ctx->arq.status_prohibit) ||
+               ctx->arq.force_poll;
+}
+
+/*
+ * @brief Bytes to submit between polls when polling per round trip
+ *
+ * Polling `poll_per_rtt` times per bandwidth-delay product keeps the number
+ * of status PDUs per round trip constant regardless of the rate. The interval
+ * is scaled down by the occupancy of the TX window, so that the window is
+ * advanced before it stalls.
+ */
+static size_t poll_bytes_adaptive(struct rlc_context *ctx)
 {
-        rlc_list_it it;
-        struct rlc_seg_item *seg_item;
+        uint64_t bytes;
+        uint32_t in_flight;
+        size_t window_size;
+
+        window_size = ctx->conf->window_size;
+        in_flight = ctx->tx.next_sn - rlc_window_base(&ctx->tx.win);
+        in_flight = rlc_min(in_flight, window_size);
+
+        bytes = ctx->arq.rtt.bdp_bytes / ctx->conf->poll_per_rtt;
+        bytes = bytes * (window_size - in_flight) / window_size;
+
+        return (size_t)bytes;
+}
 
+/* Section 5.3.3.2 */
+static bool tx_pollable(struct rlc_context *ctx)
+{
         if (ctx->conf->type != RLC_AM) {
                 return false;
         }
@@ -675,32 +1053,34 @@ static bool tx_pollable(struct rlc_context *ctx, struct rlc_sdu *sdu)
                 return true;
         }
 
-        if (ctx->arq.pdu_without_poll >= ctx->conf->pdu_without_poll_max ||
-            ctx->arq.byte_without_poll >= ctx->conf->byte_without_poll_max) {
+        if (ctx->conf->poll_per_rtt != 0 && ctx->arq.rtt.samples != 0) {
+                if (ctx->arq.byte_without_poll >= poll_bytes_adaptive(ctx)) {
+                        return true;
+                }
+        } else if (ctx->arq.pdu_without_poll >=
+                           ctx->conf->pdu_without_poll_max ||
+                   ctx->arq.byte_without_poll >=
+                           ctx->conf->byte_without_poll_max) {
                 return true;
         }
 
-        it = rlc_list_it_init(&sdu->tx.unsent);
-        seg_item = rlc_seg_item_from_it(it);
-
-        if (!rlc_list_it_eoi(rlc_list_it_next(it))) {
-                return false;
-        }
-
-        if (seg_item->seg.start < seg_item->seg.end) {
-                return false;
+        /* No new SDU can be transmitted after this PDU, as the TX window is
+         * stalled */
+        if (!rlc_window_has(&ctx->tx.win, ctx->tx.next_sn)) {
+                return true;
         }
 
-        /* No more buffers to transmit - include poll */
-        return true;
+        /* Both the transmission and retransmission buffers are empty after
+         * this PDU - include poll */
+        return ctx->tx.bs.new_bytes == 0 && ctx->tx.bs.retx_bytes == 0;
 }
 
 static void adjust_poll_sn(struct rlc_context *ctx)
 {
-        rlc_list_it it;
+        rlc_dlist_it it;
         struct rlc_sdu *sdu;
 
-        rlc_list_foreach(&ctx->tx.sdus, it)
+        rlc_dlist_foreach(&ctx->tx.sdus, it)
         {
                 sdu = rlc_sdu_from_it(it);
 
@@ -712,36 +1092,40 @@ static void adjust_poll_sn(struct rlc_context *ctx)
         }
 }
 
-void rlc_arq_tx_pdu_fill(struct rlc_context *ctx, struct rlc_sdu *sdu,
-                         struct rlc_pdu *pdu)
+void rlc_arq_tx_pdu_fill(struct rlc_context *ctx, struct rlc_pdu *pdu)
 {
         rlc_errno status;
 
         ctx->arq.pdu_without_poll += 1;
         ctx->arq.byte_without_poll += pdu->size;
+        ctx->arq.tx_bytes += pdu->size;
 
-        pdu->flags.polled = tx_pollable(ctx, sdu);
+        pdu->flags.polled = tx_pollable(ctx);
         if (pdu->flags.polled) {
                 ctx->arq.pdu_without_poll = 0;
                 ctx->arq.byte_without_poll = 0;
 
                 adjust_poll_sn(ctx);
 
-                sdu->state = RLC_WAIT;
+                /* Only time first transmissions of a poll, and one poll at a
+                 * time */
+                if (!ctx->arq.force_poll && !ctx->arq.rtt.timing) {
+                        ctx->arq.rtt.timing = true;
+                        ctx->arq.rtt.sn = pdu->sn;
+                        ctx->arq.rtt.poll_us = rlc_clock_now_us(ctx);
+                        ctx->arq.rtt.poll_bytes = ctx->arq.tx_bytes;
+                }
 
                 status = rlc_timer_restart(&ctx->arq.t_poll_retransmit,
-                                           ctx->conf->time_poll_retransmit_us);
-                if (status == 0) {
-                        gabs_log_dbgf(ctx->logger, "Started t-PollRetransmit");
-                } else {
+                                           poll_retransmit_us(ctx));
+                if (status != 0) {
                         gabs_log_errf(ctx->logger,
                                       "Unable to start t-PollRetransmit: "
                                       "%" RLC_PRI_ERRNO,
                                       status);
                 }
 
-                gabs_log_dbgf(ctx->logger, "TX; Polling %" PRIu32 " for status",
-                              pdu->sn);
+                rlc_trace(ctx, RLC_TRACE_TX_POLL, pdu->sn, 0, 0, 0, 0);
 
                 ctx->arq.force_poll = false;
         }
@@ -756,10 +1140,10 @@ void rlc_arq_rx_status(struct rlc_context *ctx, const struct rlc_pdu *pdu,
 
         offset = rlc_pdu_header_size(ctx, pdu);
 
-        gabs_log_dbgf(ctx->logger,
-                      "Status PDU received: SN %" PRIu32 ", POLL_SN %" PRIu32
-                      ", %zu",
-                      pdu->sn, ctx->arq.poll_sn, gabs_pbuf_size(*buf));
+        rlc_trace(ctx, RLC_TRACE_RX_STATUS, pdu->sn, 0, 0,
+                  gabs_pbuf_size(*buf), 0);
+
+        rtt_sample(ctx, pdu->sn);
 
         if (pdu->sn > ctx->arq.poll_sn) {
                 stop_poll_retransmit(ctx);
@@ -769,12 +1153,8 @@ void rlc_arq_rx_status(struct rlc_context *ctx, const struct rlc_pdu *pdu,
 
         /* Iterate over every status */
         while ((status = rlc_status_decode(ctx, &cur, buf)) == 0) {
-                gabs_log_dbgf(ctx->logger,
-                              "TX AM STATUS; NACK_SN: %" PRIu32
-                              ", OFFSET: %" PRIu32 "->%" PRIu32
-                              ", RANGE: %" PRIu32,
-                              cur.nack_sn, cur.offset.start, cur.offset.end,
-                              cur.range);
+                rlc_trace(ctx, RLC_TRACE_RX_NACK, cur.nack_sn,
+                          cur.offset.start, cur.offset.end, cur.range, 0);
 
                 if (cur.ext.has_range) {
                         process_nack_range(ctx, &cur);
@@ -788,11 +1168,186 @@ void rlc_arq_rx_status(struct rlc_context *ctx, const struct rlc_pdu *pdu,
         tx_ack(ctx, pdu->sn);
 }
 
+/*
+ * @brief Size of the status PDU that would be built now if the grant were
+ * large enough for every NACK
+ */
+static size_t status_size_estimate(struct rlc_context *ctx)
+{
+        struct status_builder builder;
+        struct rlc_pdu pdu;
+
+        (void)memset(&builder, 0, sizeof(builder));
+        (void)memset(&pdu, 0, sizeof(pdu));
+
+        pdu.flags.is_status = 1;
+
+        builder.ctx = ctx;
+        builder.budget = SIZE_MAX;
+        builder.measure = true;
+
+        (void)status_build(ctx, &builder);
+
+        return rlc_pdu_header_size(ctx, &pdu) + (SIZE_MAX - builder.budget);
+}
+
+static void status_trigger(struct rlc_context *ctx, bool polled)
+{
+        ctx->arq.report.polled_only =
+                polled && (!ctx->arq.gen_status || ctx->arq.report.polled_only);
+        ctx->arq.gen_status = true;
+
+        rlc_atomic_store(&ctx->arq.status_size_stale, true);
+}
+
+void rlc_arq_status_size_update(struct rlc_context *ctx)
+{
+        if (!ctx->arq.status_size_stale) {
+                return;
+        }
+
+        rlc_atomic_store(&ctx->arq.status_size_stale, false);
+
+        if (ctx->arq.gen_status) {
+                rlc_bs_status_set(ctx, status_size_estimate(ctx));
+        }
+}
+
+void rlc_arq_rx_status_trigger(struct rlc_context *ctx)
+{
+        status_trigger(ctx, false);
+}
+
+/* Section 5.3.4 */
 void rlc_arq_rx_register(struct rlc_context *ctx, const struct rlc_pdu *pdu)
 {
+        uint32_t sn;
+
+        /* Holes may have been opened or filled */
+        if (ctx->arq.gen_status) {
+                rlc_atomic_store(&ctx->arq.status_size_stale, true);
+        }
+
         if (pdu->flags.polled) {
-                ctx->arq.gen_status = true;
+                poll_sample(ctx);
+
+                /* The peer only polls again for acknowledged data when
+                 * t-PollRetransmit expired before the status PDU arrived.
+                 * Within t-StatusProhibit of it the poll has likely crossed
+                 * it, later the status PDU was most likely lost. */
+                if (ctx->arq.report.sent && pdu->sn < ctx->arq.report.ack_sn &&
+                    rlc_clock_now_us(ctx) - ctx->arq.report.sent_us >=
+                            status_prohibit_us(ctx)) {
+                        ctx->arq.report.repoll = true;
+                }
+
+                if (!ctx->arq.status_delayed ||
+                    pdu->sn > ctx->arq.status_delayed_sn) {
+                        ctx->arq.status_delayed_sn = pdu->sn;
+                }
+
+                ctx->arq.status_delayed = true;
         }
+
+        if (!ctx->arq.status_delayed) {
+                return;
+        }
+
+        /* Delay the status until the polled SDU is no longer in flight, so
+         * that its remaining bytes are not reported as missing. */
+        sn = ctx->arq.status_delayed_sn;
+
+        if (sn < ctx->rx.highest_status ||
+            sn >= rlc_window_end(&ctx->rx.win)) {
+                ctx->arq.status_delayed = false;
+
+                status_trigger(ctx, true);
+        }
+}
+
+void rlc_tx_rtt_get(struct rlc_context *ctx, struct rlc_tx_rtt *rtt)
+{
+        rlc_lock_acquire(&ctx->lock);
+
+        rtt->srtt_us = ctx->arq.rtt.srtt_us;
+        rtt->rttvar_us = ctx->arq.rtt.rttvar_us;
+        rtt->samples = ctx->arq.rtt.samples;
+        rtt->poll_retransmit_us = poll_retransmit_us(ctx);
+
+        rlc_lock_release(&ctx->lock);
+}
+
+void rlc_rx_stats_get(struct rlc_context *ctx, struct rlc_rx_stats *stats)
+{
+        rlc_lock_acquire(&ctx->lock);
+
+        stats->polls = ctx->arq.report.polls;
+        stats->status_sent = ctx->arq.report.status_sent;
+        stats->status_suppressed = ctx->arq.report.status_suppressed;
+        stats->status_prohibit_us = status_prohibit_us(ctx);
+        stats->budget_rejected = ctx->rx.budget_rejected;
+        stats->budget_dropped = ctx->rx.budget_dropped;
+
+        rlc_lock_release(&ctx->lock);
+}
+
+static rlc_errno tx_lost(struct rlc_context *ctx, rlc_pdu_handle handle)
+{
+        struct rlc_sdu *sdu;
+        struct rlc_seg seg;
+        uint32_t sn;
+
+        if (handle == RLC_PDU_HANDLE_NONE) {
+                return -EINVAL;
+        }
+
+        if (!rlc_pdu_handle_parse(handle, &sn, &seg)) {
+                gabs_log_dbgf(ctx->logger, "Status PDU lost, triggering new");
+
+                ctx->arq.report.sent = false;
+                rlc_arq_rx_status_trigger(ctx);
+                return 0;
+        }
+
+        sdu = rlc_sdu_queue_get(&ctx->tx.sdus, sn);
+        if (sdu == NULL) {
+                return -ENOENT;
+        }
+
+        gabs_log_dbgf(ctx->logger,
+                      "PDU lost; SN: %" PRIu32 ", SO: %" PRIu32 "->%" PRIu32,
+                      sn, seg.start, seg.end);
+
+        /* A status PDU may still answer the poll, so the sample would be
+         * ambiguous (Karn's algorithm) */
+        if (ctx->arq.rtt.timing && sn == ctx->arq.rtt.sn) {
+                ctx->arq.rtt.timing = false;
+        }
+
+        (void)retransmit_sdu(ctx, sdu, &seg);
+
+        return 0;
+}
+
+rlc_errno rlc_tx_lost(struct rlc_context *ctx, rlc_pdu_handle handle)
+{
+        rlc_errno status;
+
+        if (ctx->conf->type != RLC_AM) {
+                return -ENOTSUP;
+        }
+
+        rlc_lock_acquire(&ctx->lock);
+
+        status = tx_lost(ctx, handle);
+        if (status == 0) {
+                rlc_backend_tx_request(ctx);
+        }
+
+        rlc_lock_release(&ctx->lock);
+        rlc_sched_yield(&ctx->sched);
+
+        return status;
 }
 
 rlc_errno rlc_arq_init(struct rlc_context *ctx)
@@ -820,10 +1375,16 @@ void rlc_arq_reset(struct rlc_context *ctx)
 {
         ctx->arq.pdu_without_poll = 0;
         ctx->arq.byte_without_poll = 0;
+        ctx->arq.tx_bytes = 0;
         ctx->arq.poll_sn = 0;
         ctx->arq.force_poll = 0;
         ctx->arq.status_prohibit = false;
         ctx->arq.gen_status = 0;
+        ctx->arq.status_size_stale = false;
+        ctx->arq.status_delayed = false;
+
+        (void)memset(&ctx->arq.rtt, 0, sizeof(ctx->arq.rtt));
+        (void)memset(&ctx->arq.report, 0, sizeof(ctx->arq.report));
 
         (void)rlc_timer_stop(&ctx->arq.t_status_prohibit);
         (void)rlc_timer_stop(&ctx->arq.t_poll_retransmit);
@@ -20,12 +20,17 @@ rlc_errno rlc_arq_deinit(struct rlc_context *ctx);
  */
 size_t rlc_arq_tx_yield(struct rlc_context *ctx, size_t max_size);
 
+/**
+ * @brief Check if ARQ has anything due for transmission, i.e a status PDU
+ * that is no longer prohibited or a poll that must be retransmitted.
+ */
+bool rlc_arq_tx_pending(struct rlc_context *ctx);
+
 /**
  * @brief "Fill" PDU with ARQ contents. This essentially just modifies the
  * poll bit, and handles state variables.
  */
-void rlc_arq_tx_pdu_fill(struct rlc_context *ctx, struct rlc_sdu *sdu,
-                         struct rlc_pdu *pdu);
+void rlc_arq_tx_pdu_fill(struct rlc_context *ctx, struct rlc_pdu *pdu);
 
 /**
  * @brief Receive status PDU
@@ -41,10 +46,24 @@ gabs_pbuf *rlc_arq_rx_status(struct rlc_context *ctx, const struct rlc_pdu *pdu,
 /**
  * @brief Register @p pdu as being received.
  *
- * This updates the internal ARQ state depending on @p pdu.
+ * This updates the internal ARQ state depending on @p pdu, and must be called
+ * after the receive state variables have been updated for it.
  */
 void rlc_arq_rx_register(struct rlc_context *ctx, const struct rlc_pdu *pdu);
 
+/**
+ * @brief Trigger a status PDU, e.g. when t-Reassembly expires.
+ */
+void rlc_arq_rx_status_trigger(struct rlc_context *ctx);
+
+/**
+ * @brief Report the size of the pending status PDU in the buffer status, if
+ * the receive state changed since it was last reported.
+ *
+ * This walks the RX queue, and must be called with the context lock held.
+ */
+void rlc_arq_status_size_update(struct rlc_context *ctx);
+
 RLC_END_DECL
 
 #endif /* RLC_ARQ_H__ */
@@ -1,17 +1,24 @@
 
 #include <errno.h>
+#include <string.h>
 
 #include <rlc/sdu.h>
 #include <rlc/utils.h>
 #include <rlc/sched.h>
 #include <rlc/backend.h>
 
+#include "capture.h"
+#include "common.h"
 #include "encode.h"
+#include "mem.h"
 
 typedef void (*offload_fn)(struct rlc_sched_item *);
 
 union offload_arg {
-        gabs_pbuf buf;
+        struct {
+                gabs_pbuf buf;
+                rlc_pdu_handle handle;
+        } submit;
         char unused;
 };
 
@@ -20,6 +27,9 @@ struct offload_item {
         union offload_arg arg;
         struct rlc_sched_item sched_item;
         struct rlc_context *ctx;
+
+        /* Bytes of the call accounted as RLC_MEM_HEADER */
+        size_t header_bytes;
 };
 
 static struct offload_item *offload_get(struct rlc_sched_item *item)
@@ -36,6 +46,13 @@ static void offload_dealloc(struct rlc_sched_item *item)
         offload = offload_get(item);
         logger = offload->ctx->logger;
 
+        if (offload->header_bytes > 0) {
+                rlc_mem_sub(offload->ctx, RLC_MEM_HEADER, 1,
+                            offload->header_bytes);
+        }
+
+        rlc_mem_sub(offload->ctx, RLC_MEM_OFFLOAD, 1, sizeof(*offload));
+
         status = gabs_dealloc(offload->ctx->alloc_misc, offload);
         if (status != 0) {
                 gabs_log_errf(logger, "Unable to dealloc offload: %i", status);
@@ -52,12 +69,19 @@ static void offload_tx_submit(struct rlc_sched_item *item)
         gabs_log_dbgf(offload->ctx->logger, "Executing TX submit");
 
         backend = offload->ctx->backend;
-        if (backend->tx_submit != NULL) {
-                status = backend->tx_submit(offload->ctx, offload->arg.buf);
-                if (status != 0) {
-                        gabs_log_errf(offload->ctx->logger, "Unable to TX: %i",
-                                      status);
-                }
+        if (backend->tx_submit_handle != NULL) {
+                status = backend->tx_submit_handle(offload->ctx,
+                                                   offload->arg.submit.buf,
+                                                   offload->arg.submit.handle);
+        } else if (backend->tx_submit != NULL) {
+                status = backend->tx_submit(offload->ctx,
+                                            offload->arg.submit.buf);
+        } else {
+                status = 0;
+        }
+
+        if (status != 0) {
+                gabs_log_errf(offload->ctx->logger, "Unable to TX: %i", status);
         }
 
         offload_dealloc(item);
@@ -79,14 +103,21 @@ static void offload_tx_request(struct rlc_sched_item *item)
                 if (status != 0) {
                         gabs_log_errf(offload->ctx->logger,
                                       "Unable to request TX: %i", status);
+
+                        /* No opportunity will answer this request, so let
+                         * the next caller try again */
+                        rlc_lock_acquire(&offload->ctx->lock);
+                        offload->ctx->tx.request_pending = false;
+                        rlc_lock_release(&offload->ctx->lock);
                 }
         }
 
         offload_dealloc(item);
 }
 
-static void offload_call(struct rlc_context *ctx, offload_fn fn,
-                         union offload_arg arg)
+/* @p header_bytes are accounted to the call until it is done */
+static rlc_errno offload_call(struct rlc_context *ctx, offload_fn fn,
+                              union offload_arg arg, size_t header_bytes)
 {
         int status;
         struct offload_item *offload;
@@ -94,16 +125,156 @@ static void offload_call(struct rlc_context *ctx, offload_fn fn,
         status = gabs_alloc(ctx->alloc_misc, sizeof(*offload),
                             (void **)&offload);
         if (status != 0) {
-                gabs_log_errf(offload->ctx->logger,
+                gabs_log_errf(ctx->logger,
                               "Unable to allocate offload request: %i", status);
-                return;
+                return status;
         }
 
         offload->ctx = ctx;
         offload->arg = arg;
+        offload->header_bytes = header_bytes;
+
+        rlc_mem_add(ctx, RLC_MEM_OFFLOAD, 1, sizeof(*offload));
+        if (header_bytes > 0) {
+                rlc_mem_add(ctx, RLC_MEM_HEADER, 1, header_bytes);
+        }
         rlc_sched_item_init(&offload->sched_item, fn, offload_dealloc);
 
         rlc_sched_put(&ctx->sched, &offload->sched_item);
+
+        return 0;
+}
+
+/**
+ * @brief Write the header of @p pdu into the build target, reserving room for
+ * @p size payload bytes after it.
+ *
+ * @return uint8_t* Location of the payload, or NULL if it does not fit
+ */
+static uint8_t *build_put(struct rlc_context *ctx, struct rlc_pdu *pdu,
+                          size_t size)
+{
+        struct rlc_backend_build *build;
+        uint8_t header[RLC_PDU_HEADER_MAX_SIZE];
+        size_t hsize;
+        uint8_t *mem;
+
+        build = ctx->tx.build;
+
+        hsize = rlc_pdu_encode_raw(ctx, pdu, header);
+        if (build->pdu_count >= build->pdu_max ||
+            hsize + size > build->size - build->used) {
+                return NULL;
+        }
+
+        mem = build->dst + build->used;
+        (void)memcpy(mem, header, hsize);
+
+        build->pdus[build->pdu_count++] = (struct rlc_tx_pdu_info){
+                .offset = build->used,
+                .size = hsize + size,
+                .handle = rlc_pdu_handle_make(pdu, size),
+        };
+        build->used += hsize + size;
+
+        return mem + hsize;
+}
+
+/* Capture the PDU last written to the build target, and get its size */
+static ptrdiff_t build_done(struct rlc_context *ctx)
+{
+        struct rlc_tx_pdu_info *info;
+
+        info = &ctx->tx.build->pdus[ctx->tx.build->pdu_count - 1];
+        rlc_capture_mem(ctx, RLC_CAPTURE_TX, ctx->tx.build->dst + info->offset,
+                        info->size);
+
+        return info->size;
+}
+
+/* Copy @p size bytes at @p offset in @p buf into the build target */
+static ptrdiff_t build_copy(struct rlc_context *ctx, struct rlc_pdu *pdu,
+                            gabs_pbuf buf, size_t offset, size_t size)
+{
+        uint8_t *mem;
+        ptrdiff_t ret;
+
+        mem = build_put(ctx, pdu, size);
+        if (mem == NULL) {
+                return -ENOSPC;
+        }
+
+        ret = gabs_pbuf_copy(buf, mem, offset, size);
+        if (ret < 0) {
+                return ret;
+        }
+
+        return build_done(ctx);
+}
+
+bool rlc_backend_tx_room(struct rlc_context *ctx)
+{
+        return ctx->tx.build == NULL ||
+               ctx->tx.build->pdu_count < ctx->tx.build->pdu_max;
+}
+
+bool rlc_backend_tx_fits(struct rlc_context *ctx, const struct rlc_pdu *pdu)
+{
+        struct rlc_backend_build *build;
+
+        build = ctx->tx.build;
+        if (build == NULL) {
+                return true;
+        }
+
+        return build->pdu_count < build->pdu_max &&
+               rlc_pdu_header_size(ctx, pdu) + pdu->size <=
+                       build->size - build->used;
+}
+
+uint8_t *rlc_backend_tx_payload(struct rlc_context *ctx,
+                                const struct rlc_pdu *pdu, size_t *avail)
+{
+        struct rlc_backend_build *build;
+        size_t hsize;
+
+        build = ctx->tx.build;
+        if (build == NULL) {
+                return NULL;
+        }
+
+        hsize = rlc_pdu_header_size(ctx, pdu);
+
+        *avail = build->size - build->used > hsize
+                         ? build->size - build->used - hsize
+                         : 0;
+
+        return build->dst + build->used + hsize;
+}
+
+ptrdiff_t rlc_backend_tx_submit_payload(struct rlc_context *ctx,
+                                        struct rlc_pdu *pdu, size_t size)
+{
+        /* The header is written in front of the payload, leaving it as is */
+        if (build_put(ctx, pdu, size) == NULL) {
+                return -ENOSPC;
+        }
+
+        return build_done(ctx);
+}
+
+ptrdiff_t rlc_backend_tx_submit_sdu(struct rlc_context *ctx,
+                                    struct rlc_pdu *pdu, gabs_pbuf buf)
+{
+        gabs_pbuf view;
+
+        if (ctx->tx.build != NULL) {
+                return build_copy(ctx, pdu, buf, pdu->seg_offset, pdu->size);
+        }
+
+        view = gabs_pbuf_view(buf, pdu->seg_offset, pdu->size, ctx->alloc_buf);
+
+        return rlc_backend_tx_submit(ctx, pdu, view);
 }
 
 ptrdiff_t rlc_backend_tx_submit(struct rlc_context *ctx, struct rlc_pdu *pdu,
@@ -111,6 +282,15 @@ ptrdiff_t rlc_backend_tx_submit(struct rlc_context *ctx, struct rlc_pdu *pdu,
 {
         ptrdiff_t size;
         gabs_pbuf header;
+        rlc_pdu_handle handle;
+        size_t header_bytes;
+
+        if (ctx->tx.build != NULL) {
+                size = build_copy(ctx, pdu, buf, 0, gabs_pbuf_size(buf));
+                gabs_pbuf_decref(buf);
+
+                return size;
+        }
 
         gabs_log_dbgf(ctx->logger, "Scheduling TX submit");
 
@@ -120,19 +300,43 @@ ptrdiff_t rlc_backend_tx_submit(struct rlc_context *ctx, struct rlc_pdu *pdu,
                 return -ENOMEM;
         }
 
+        handle = rlc_pdu_handle_make(pdu, gabs_pbuf_size(buf));
+
+        /* The payload of a status PDU is built by the library as well */
+        header_bytes = RLC_PDU_HEADER_MAX_SIZE;
+        if (pdu->flags.is_status) {
+                header_bytes += gabs_pbuf_size(buf);
+        }
+
         rlc_pdu_encode(ctx, pdu, &header);
 
         gabs_pbuf_chain_front(&buf, header);
         size = gabs_pbuf_size(buf);
 
-        offload_call(ctx, offload_tx_submit, (union offload_arg){.buf = buf});
+        rlc_capture_pbuf(ctx, RLC_CAPTURE_TX, buf);
+
+        offload_call(ctx, offload_tx_submit,
+                     (union offload_arg){
+                             .submit = {.buf = buf, .handle = handle},
+                     },
+                     header_bytes);
 
         return size;
 }
 
 void rlc_backend_tx_request(struct rlc_context *ctx)
 {
+        if (ctx->tx.request_pending) {
+                return;
+        }
+
+        ctx->tx.request_pending = true;
+
         gabs_log_dbgf(ctx->logger, "Scheduling TX request");
 
-        offload_call(ctx, offload_tx_request, (union offload_arg){0});
+        if (offload_call(ctx, offload_tx_request, (union offload_arg){0},
+                         0) != 0) {
+                /* Allow the next caller to try again */
+                ctx->tx.request_pending = false;
+        }
 }
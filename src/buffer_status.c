@@ -0,0 +1,181 @@
+
+#include <string.h>
+
+#include <rlc/rlc.h>
+#include <rlc/sdu.h>
+#include <rlc/seg_list.h>
+
+#include "arq.h"
+#include "buffer_status.h"
+#include "common.h"
+#include "encode.h"
+
+static void counter_add(size_t *counter, size_t add, size_t sub)
+{
+        rlc_assert(*counter + add >= sub);
+
+        rlc_atomic_store(counter, *counter + add - sub);
+}
+
+void rlc_bs_sdu_get(const struct rlc_sdu *sdu, struct rlc_bs_sdu *out)
+{
+        struct rlc_seg_item *item;
+        rlc_dlist_it it;
+        uint32_t split;
+
+        rlc_assert(sdu->is_tx);
+
+        (void)memset(out, 0, sizeof(*out));
+
+        rlc_dlist_foreach((rlc_seg_list *)&sdu->tx.unsent, it)
+        {
+                item = rlc_seg_item_from_it(it);
+
+                /* Everything below the highest offset ever submitted is a
+                 * retransmission, the rest is new data. */
+                split = rlc_min(rlc_max(item->seg.start, sdu->tx.sent),
+                                item->seg.end);
+
+                if (split > item->seg.start) {
+                        out->retx_bytes += split - item->seg.start;
+                        out->retx_segs++;
+                }
+
+                out->new_bytes += item->seg.end - split;
+        }
+}
+
+void rlc_bs_sdu_update(struct rlc_context *ctx,
+                       const struct rlc_bs_sdu *before,
+                       const struct rlc_bs_sdu *after)
+{
+        counter_add(&ctx->tx.bs.new_bytes, after->new_bytes,
+                    before->new_bytes);
+        counter_add(&ctx->tx.bs.retx_bytes, after->retx_bytes,
+                    before->retx_bytes);
+        counter_add(&ctx->tx.bs.retx_segs, after->retx_segs,
+                    before->retx_segs);
+        counter_add(&ctx->tx.bs.new_sdus, after->new_bytes > 0,
+                    before->new_bytes > 0);
+}
+
+/* Fire the flow control events when the queue crosses the watermarks */
+static void watermark_check(struct rlc_context *ctx)
+{
+        const struct rlc_config *conf;
+        size_t queued;
+
+        conf = ctx->conf;
+        queued = ctx->tx.bs.queued_bytes;
+
+        if (!ctx->tx.paused) {
+                if (conf->tx_queue_high_bytes != 0 &&
+                    queued >= conf->tx_queue_high_bytes) {
+                        ctx->tx.paused = true;
+                        rlc_event_tx_pause(ctx);
+                }
+        } else if (queued <= conf->tx_queue_low_bytes) {
+                ctx->tx.paused = false;
+                rlc_event_tx_resume(ctx);
+        }
+}
+
+void rlc_bs_sdu_add(struct rlc_context *ctx, const struct rlc_sdu *sdu)
+{
+        struct rlc_bs_sdu before;
+        struct rlc_bs_sdu after;
+
+        (void)memset(&before, 0, sizeof(before));
+        rlc_bs_sdu_get(sdu, &after);
+
+        rlc_bs_sdu_update(ctx, &before, &after);
+
+        counter_add(&ctx->tx.bs.queued_bytes, gabs_pbuf_size(sdu->tx.buffer),
+                    0);
+        counter_add(&ctx->tx.bs.queued_sdus, 1, 0);
+        watermark_check(ctx);
+}
+
+void rlc_bs_sdu_remove(struct rlc_context *ctx, const struct rlc_sdu *sdu)
+{
+        struct rlc_bs_sdu before;
+        struct rlc_bs_sdu after;
+
+        rlc_bs_sdu_get(sdu, &before);
+        (void)memset(&after, 0, sizeof(after));
+
+        rlc_bs_sdu_update(ctx, &before, &after);
+
+        counter_add(&ctx->tx.bs.queued_bytes, 0,
+                    gabs_pbuf_size(sdu->tx.buffer));
+        counter_add(&ctx->tx.bs.queued_sdus, 0, 1);
+        watermark_check(ctx);
+}
+
+bool rlc_bs_queue_full(struct rlc_context *ctx, size_t size)
+{
+        const struct rlc_config *conf;
+
+        conf = ctx->conf;
+
+        if (conf->tx_queue_max_bytes != 0 &&
+            ctx->tx.bs.queued_bytes + size > conf->tx_queue_max_bytes) {
+                return true;
+        }
+
+        return conf->tx_queue_max_sdus != 0 &&
+               ctx->tx.bs.queued_sdus >= conf->tx_queue_max_sdus;
+}
+
+void rlc_bs_status_set(struct rlc_context *ctx, size_t size)
+{
+        rlc_atomic_store(&ctx->tx.bs.status_bytes, size);
+}
+
+void rlc_bs_reset(struct rlc_context *ctx)
+{
+        rlc_atomic_store(&ctx->tx.bs.new_bytes, 0);
+        rlc_atomic_store(&ctx->tx.bs.retx_bytes, 0);
+        rlc_atomic_store(&ctx->tx.bs.status_bytes, 0);
+        rlc_atomic_store(&ctx->tx.bs.new_sdus, 0);
+        rlc_atomic_store(&ctx->tx.bs.retx_segs, 0);
+        rlc_atomic_store(&ctx->tx.bs.queued_bytes, 0);
+        rlc_atomic_store(&ctx->tx.bs.queued_sdus, 0);
+
+        watermark_check(ctx);
+}
+
+void rlc_tx_buffer_status(struct rlc_context *ctx,
+                          struct rlc_tx_buffer_status *status)
+{
+        struct rlc_pdu pdu;
+        size_t new_sdus;
+        size_t retx_segs;
+
+        /* The status PDU is sized here rather than as PDUs are received, so
+         * that it is sized once however many arrive in between */
+        if (rlc_atomic_load(&ctx->arq.status_size_stale)) {
+                rlc_lock_acquire(&ctx->lock);
+                rlc_arq_status_size_update(ctx);
+                rlc_lock_release(&ctx->lock);
+        }
+
+        status->new_bytes = rlc_atomic_load(&ctx->tx.bs.new_bytes);
+        status->retx_bytes = rlc_atomic_load(&ctx->tx.bs.retx_bytes);
+        status->status_bytes = rlc_atomic_load(&ctx->tx.bs.status_bytes);
+
+        new_sdus = rlc_atomic_load(&ctx->tx.bs.new_sdus);
+        retx_segs = rlc_atomic_load(&ctx->tx.bs.retx_segs);
+
+        /* New data is assumed to go out as full SDUs, retransmissions as
+         * segments carrying an SO field. */
+        (void)memset(&pdu, 0, sizeof(pdu));
+        pdu.flags.is_first = 1;
+        status->header_bytes = new_sdus * rlc_pdu_header_size(ctx, &pdu);
+
+        pdu.flags.is_first = 0;
+        status->header_bytes += retx_segs * rlc_pdu_header_size(ctx, &pdu);
+
+        status->queued_bytes = rlc_atomic_load(&ctx->tx.bs.queued_bytes);
+        status->queued_sdus = rlc_atomic_load(&ctx->tx.bs.queued_sdus);
+}
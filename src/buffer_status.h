@@ -0,0 +1,48 @@
+
+#ifndef RLC_BUFFER_STATUS_H__
+#define RLC_BUFFER_STATUS_H__
+
+#include <rlc/rlc.h>
+
+RLC_BEGIN_DECL
+
+/** @brief Contribution of a single TX SDU to the buffer status */
+struct rlc_bs_sdu {
+        size_t new_bytes;
+        size_t retx_bytes;
+        size_t retx_segs;
+};
+
+/**
+ * @brief Get the current contribution of @p sdu.
+ *
+ * Callers take one snapshot before and one after modifying the unsent
+ * segments of an SDU, and apply the difference with `rlc_bs_sdu_update`.
+ */
+void rlc_bs_sdu_get(const struct rlc_sdu *sdu, struct rlc_bs_sdu *out);
+
+/** @brief Apply the change in contribution from @p before to @p after */
+void rlc_bs_sdu_update(struct rlc_context *ctx,
+                       const struct rlc_bs_sdu *before,
+                       const struct rlc_bs_sdu *after);
+
+/** @brief Add a newly queued SDU to the buffer status */
+void rlc_bs_sdu_add(struct rlc_context *ctx, const struct rlc_sdu *sdu);
+
+/** @brief Remove the contribution of an SDU leaving the queue */
+void rlc_bs_sdu_remove(struct rlc_context *ctx, const struct rlc_sdu *sdu);
+
+/**
+ * @brief Check whether an SDU of @p size bytes would exceed the TX queue
+ * limits. Must be called with the context lock held.
+ */
+bool rlc_bs_queue_full(struct rlc_context *ctx, size_t size);
+
+/** @brief Set the estimated size of the pending status PDU */
+void rlc_bs_status_set(struct rlc_context *ctx, size_t size);
+
+void rlc_bs_reset(struct rlc_context *ctx);
+
+RLC_END_DECL
+
+#endif /* RLC_BUFFER_STATUS_H__ */
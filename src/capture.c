@@ -0,0 +1,388 @@
+
+#include <string.h>
+#include <errno.h>
+
+#include <rlc/rlc.h>
+#include <rlc/capture.h>
+
+#include "capture.h"
+#include "clock.h"
+#include "common.h"
+
+#define US_PER_S (1000000)
+
+/* Framing of the Wireshark rlc-nr heuristic UDP dissector */
+#define NR_START_STRING    "rlc-nr"
+#define NR_SN_LENGTH_TAG   0x02
+#define NR_DIRECTION_TAG   0x03
+#define NR_UEID_TAG        0x04
+#define NR_PAYLOAD_TAG     0x01
+#define NR_MODE_TM         1
+#define NR_MODE_UM         2
+#define NR_MODE_AM         4
+#define NR_DIRECTION_UL    0
+#define NR_DIRECTION_DL    1
+#define NR_FRAMING_SIZE    (sizeof(NR_START_STRING) - 1 + 1 + 2 + 2 + 3 + 1)
+
+#define PCAP_MAGIC         0xa1b2c3d4
+#define PCAP_LINKTYPE_IPV4 228
+#define IPV4_HEADER_SIZE   20
+#define UDP_HEADER_SIZE    8
+#define UDP_PORT           9999
+#define PACKET_HEADER_SIZE (IPV4_HEADER_SIZE + UDP_HEADER_SIZE + NR_FRAMING_SIZE)
+
+/* Slots are claimed by producers in the order of `seq`. A slot at position
+ * `pos` is free to be written when `seq` is `pos`, and ready to be drained
+ * when it is `pos + 1`. */
+struct capture_slot {
+        uint64_t seq;
+        uint64_t time_us;
+        uint32_t size;   /* Size of the PDU */
+        uint32_t caplen; /* Bytes kept in `data` */
+        uint16_t id;
+        uint8_t dir;
+        uint8_t mode;
+        uint8_t sn_bits;
+        uint8_t data[];
+};
+
+struct pcap_file_header {
+        uint32_t magic;
+        uint16_t version_major;
+        uint16_t version_minor;
+        int32_t thiszone;
+        uint32_t sigfigs;
+        uint32_t snaplen;
+        uint32_t linktype;
+};
+
+struct pcap_record_header {
+        uint32_t ts_sec;
+        uint32_t ts_usec;
+        uint32_t incl_len;
+        uint32_t orig_len;
+};
+
+static struct capture_slot *slot_at(const struct rlc_capture *cap,
+                                    uint64_t pos)
+{
+        return (struct capture_slot *)(cap->slots + (pos & cap->slot_mask) *
+                                                            cap->slot_size);
+}
+
+static uint8_t sn_bits(enum rlc_sn_width width)
+{
+        switch (width) {
+        case RLC_SN_6BIT:
+                return 6;
+        case RLC_SN_12BIT:
+                return 12;
+        case RLC_SN_18BIT:
+                return 18;
+        default:
+                return 0;
+        }
+}
+
+static uint8_t nr_mode(enum rlc_service_type type)
+{
+        switch (type) {
+        case RLC_AM:
+                return NR_MODE_AM;
+        case RLC_UM:
+                return NR_MODE_UM;
+        default:
+                return NR_MODE_TM;
+        }
+}
+
+rlc_errno rlc_capture_init(struct rlc_capture *cap,
+                           const gabs_allocator_h *allocator,
+                           size_t slot_count, size_t snaplen,
+                           bool tx_downlink)
+{
+        rlc_errno status;
+        size_t i;
+
+        if (slot_count == 0 || (slot_count & (slot_count - 1)) != 0 ||
+            snaplen > UINT16_MAX) {
+                return -EINVAL;
+        }
+
+        (void)memset(cap, 0, sizeof(*cap));
+
+        /* Keep the 64 bit fields of every slot aligned */
+        cap->slot_size = (sizeof(struct capture_slot) + snaplen + 7) & ~7u;
+        cap->slot_mask = slot_count - 1;
+        cap->snaplen = snaplen;
+        cap->tx_downlink = tx_downlink;
+        cap->allocator = allocator;
+
+        status = gabs_alloc(allocator, cap->slot_size * slot_count,
+                            (void **)&cap->slots);
+        if (status != 0) {
+                return status;
+        }
+
+        for (i = 0; i < slot_count; i++) {
+                slot_at(cap, i)->seq = i;
+        }
+
+        return 0;
+}
+
+void rlc_capture_deinit(struct rlc_capture *cap)
+{
+        (void)gabs_dealloc(cap->allocator, cap->slots);
+        cap->slots = NULL;
+}
+
+void rlc_capture_attach(struct rlc_context *ctx, struct rlc_capture *cap,
+                        uint16_t id)
+{
+        rlc_lock_acquire(&ctx->lock);
+
+        ctx->capture.ring = cap;
+        ctx->capture.id = id;
+
+        rlc_lock_release(&ctx->lock);
+}
+
+/* Claim a slot, or return NULL if the ring is full */
+static struct capture_slot *slot_claim(struct rlc_capture *cap)
+{
+        struct capture_slot *slot;
+        uint64_t pos;
+        uint64_t seq;
+
+        pos = rlc_atomic_load(&cap->head);
+
+        for (;;) {
+                slot = slot_at(cap, pos);
+                seq = rlc_atomic_load_acquire(&slot->seq);
+
+                if (seq == pos) {
+                        if (rlc_atomic_cas(&cap->head, &pos, pos + 1)) {
+                                return slot;
+                        }
+                } else if (seq < pos) {
+                        /* Not yet drained since the last lap */
+                        (void)rlc_atomic_add(&cap->dropped, 1);
+                        return NULL;
+                } else {
+                        pos = rlc_atomic_load(&cap->head);
+                }
+        }
+}
+
+static struct capture_slot *slot_fill(struct rlc_context *ctx,
+                                      enum rlc_capture_dir dir, size_t size)
+{
+        struct rlc_capture *cap;
+        struct capture_slot *slot;
+
+        cap = ctx->capture.ring;
+
+        slot = slot_claim(cap);
+        if (slot == NULL) {
+                return NULL;
+        }
+
+        slot->time_us = rlc_clock_now_us(ctx);
+        slot->size = size;
+        slot->caplen = rlc_min(size, cap->snaplen);
+        slot->id = ctx->capture.id;
+        slot->dir = dir;
+        slot->mode = nr_mode(ctx->conf->type);
+        slot->sn_bits = sn_bits(ctx->conf->sn_width);
+
+        return slot;
+}
+
+static void slot_publish(struct capture_slot *slot)
+{
+        rlc_atomic_store_release(&slot->seq, slot->seq + 1);
+}
+
+void rlc_capture_pbuf_(struct rlc_context *ctx, enum rlc_capture_dir dir,
+                       gabs_pbuf buf)
+{
+        struct capture_slot *slot;
+        ptrdiff_t ret;
+
+        slot = slot_fill(ctx, dir, gabs_pbuf_size(buf));
+        if (slot == NULL) {
+                return;
+        }
+
+        ret = gabs_pbuf_copy(buf, slot->data, 0, slot->caplen);
+        if (ret < 0) {
+                slot->caplen = 0;
+        }
+
+        slot_publish(slot);
+}
+
+void rlc_capture_mem_(struct rlc_context *ctx, enum rlc_capture_dir dir,
+                      const uint8_t *data, size_t size)
+{
+        struct capture_slot *slot;
+
+        slot = slot_fill(ctx, dir, size);
+        if (slot == NULL) {
+                return;
+        }
+
+        (void)memcpy(slot->data, data, slot->caplen);
+
+        slot_publish(slot);
+}
+
+int rlc_capture_pcap_header(const struct rlc_capture *cap,
+                            rlc_capture_write write, void *arg)
+{
+        struct pcap_file_header header = {
+                .magic = PCAP_MAGIC,
+                .version_major = 2,
+                .version_minor = 4,
+                .thiszone = 0,
+                .sigfigs = 0,
+                .snaplen = PACKET_HEADER_SIZE + cap->snaplen,
+                .linktype = PCAP_LINKTYPE_IPV4,
+        };
+
+        return write(arg, &header, sizeof(header));
+}
+
+static void put_be16(uint8_t *dst, uint16_t value)
+{
+        dst[0] = value >> 8;
+        dst[1] = value & 0xff;
+}
+
+static uint16_t ipv4_checksum(const uint8_t *header)
+{
+        uint32_t sum;
+        size_t i;
+
+        sum = 0;
+
+        for (i = 0; i < IPV4_HEADER_SIZE; i += 2) {
+                sum += (header[i] << 8) | header[i + 1];
+        }
+
+        while (sum >> 16) {
+                sum = (sum & 0xffff) + (sum >> 16);
+        }
+
+        return ~sum;
+}
+
+/* IPv4 and UDP headers, followed by the rlc-nr framing up to the payload */
+static void packet_header(const struct rlc_capture *cap,
+                          const struct capture_slot *slot,
+                          uint8_t data[PACKET_HEADER_SIZE])
+{
+        uint8_t *ip;
+        uint8_t *udp;
+        uint8_t *nr;
+        bool downlink;
+
+        ip = data;
+        udp = ip + IPV4_HEADER_SIZE;
+        nr = udp + UDP_HEADER_SIZE;
+
+        (void)memset(data, 0, PACKET_HEADER_SIZE);
+
+        ip[0] = 0x45; /* Version 4, 5 words of header */
+        put_be16(&ip[2], PACKET_HEADER_SIZE + slot->caplen);
+        ip[8] = 64;  /* TTL */
+        ip[9] = 17;  /* UDP */
+        ip[12] = 127;
+        ip[15] = 1;
+        ip[16] = 127;
+        ip[19] = 1;
+        put_be16(&ip[10], ipv4_checksum(ip));
+
+        put_be16(&udp[0], UDP_PORT);
+        put_be16(&udp[2], UDP_PORT);
+        put_be16(&udp[4], UDP_HEADER_SIZE + NR_FRAMING_SIZE + slot->caplen);
+
+        downlink = (slot->dir == RLC_CAPTURE_TX) == cap->tx_downlink;
+
+        (void)memcpy(nr, NR_START_STRING, sizeof(NR_START_STRING) - 1);
+        nr += sizeof(NR_START_STRING) - 1;
+
+        *nr++ = slot->mode;
+        *nr++ = NR_SN_LENGTH_TAG;
+        *nr++ = slot->sn_bits;
+        *nr++ = NR_DIRECTION_TAG;
+        *nr++ = downlink ? NR_DIRECTION_DL : NR_DIRECTION_UL;
+        *nr++ = NR_UEID_TAG;
+        put_be16(nr, slot->id);
+        nr += 2;
+        *nr++ = NR_PAYLOAD_TAG;
+}
+
+static int record_write(const struct rlc_capture *cap,
+                        const struct capture_slot *slot,
+                        rlc_capture_write write, void *arg)
+{
+        struct pcap_record_header record;
+        uint8_t header[PACKET_HEADER_SIZE];
+        int status;
+
+        record = (struct pcap_record_header){
+                .ts_sec = slot->time_us / US_PER_S,
+                .ts_usec = slot->time_us % US_PER_S,
+                .incl_len = PACKET_HEADER_SIZE + slot->caplen,
+                .orig_len = PACKET_HEADER_SIZE + slot->size,
+        };
+
+        packet_header(cap, slot, header);
+
+        status = write(arg, &record, sizeof(record));
+        if (status != 0) {
+                return status;
+        }
+
+        status = write(arg, header, sizeof(header));
+        if (status != 0) {
+                return status;
+        }
+
+        return write(arg, slot->data, slot->caplen);
+}
+
+ptrdiff_t rlc_capture_drain_pcap(struct rlc_capture *cap,
+                                 rlc_capture_write write, void *arg)
+{
+        struct capture_slot *slot;
+        ptrdiff_t count;
+        int status;
+
+        count = 0;
+
+        for (;;) {
+                slot = slot_at(cap, cap->tail);
+
+                if (rlc_atomic_load_acquire(&slot->seq) != cap->tail + 1) {
+                        break;
+                }
+
+                status = record_write(cap, slot, write, arg);
+
+                /* Hand the slot back to the producers of the next lap */
+                rlc_atomic_store_release(&slot->seq,
+                                         cap->tail + cap->slot_mask + 1);
+                cap->tail++;
+
+                if (status != 0) {
+                        return status;
+                }
+
+                count++;
+        }
+
+        return count;
+}
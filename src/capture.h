@@ -0,0 +1,37 @@
+
+#ifndef RLC_CAPTURE_INTERNAL_H__
+#define RLC_CAPTURE_INTERNAL_H__
+
+#include <rlc/rlc.h>
+#include <rlc/capture.h>
+
+RLC_BEGIN_DECL
+
+void rlc_capture_pbuf_(struct rlc_context *ctx, enum rlc_capture_dir dir,
+                       gabs_pbuf buf);
+
+void rlc_capture_mem_(struct rlc_context *ctx, enum rlc_capture_dir dir,
+                      const uint8_t *data, size_t size);
+
+/** @brief Capture the PDU in @p buf, if capturing is enabled for @p ctx */
+static inline void rlc_capture_pbuf(struct rlc_context *ctx,
+                                    enum rlc_capture_dir dir, gabs_pbuf buf)
+{
+        if (ctx->capture.ring != NULL) {
+                rlc_capture_pbuf_(ctx, dir, buf);
+        }
+}
+
+/** @brief Capture the PDU at @p data, if capturing is enabled for @p ctx */
+static inline void rlc_capture_mem(struct rlc_context *ctx,
+                                   enum rlc_capture_dir dir,
+                                   const uint8_t *data, size_t size)
+{
+        if (ctx->capture.ring != NULL) {
+                rlc_capture_mem_(ctx, dir, data, size);
+        }
+}
+
+RLC_END_DECL
+
+#endif /* RLC_CAPTURE_INTERNAL_H__ */
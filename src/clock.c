@@ -0,0 +1,36 @@
+
+#if !defined(__ZEPHYR__)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdint.h>
+
+#if defined(__ZEPHYR__)
+#include <zephyr/kernel.h>
+#else
+#include <time.h>
+#endif
+
+#include <rlc/rlc.h>
+
+#include "clock.h"
+
+uint64_t rlc_clock_now_us(const struct rlc_context *ctx)
+{
+        if (ctx->vclock != NULL) {
+                return rlc_vclock_now_us(ctx->vclock);
+        }
+
+#if defined(__ZEPHYR__)
+        return k_ticks_to_us_floor64(k_uptime_ticks());
+#else
+        struct timespec ts;
+
+        if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+                rlc_assert(0);
+                return 0;
+        }
+
+        return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+#endif
+}
@@ -0,0 +1,19 @@
+
+#ifndef RLC_CLOCK_H__
+#define RLC_CLOCK_H__
+
+#include <stdint.h>
+
+#include <rlc/utils.h>
+
+RLC_BEGIN_DECL
+
+struct rlc_context;
+
+/** @brief Current time of a monotonic clock, or of the virtual clock attached
+ * to @p ctx, in microseconds */
+uint64_t rlc_clock_now_us(const struct rlc_context *ctx);
+
+RLC_END_DECL
+
+#endif /* RLC_CLOCK_H__ */
@@ -130,14 +130,11 @@ static size_t bytes_ceil_(size_t num_bits)
         return num_bits / 8 + ((num_bits % 8) != 0);
 }
 
-static void encode_status_header_(const struct rlc_context *ctx,
-                                  const struct rlc_pdu *pdu, gabs_pbuf *buf)
+static size_t encode_status_header_(const struct rlc_context *ctx,
+                                    const struct rlc_pdu *pdu, uint8_t *data)
 {
         size_t full_width;
         size_t sn_width;
-        uint8_t data[RLC_STATUS_MAX_SIZE];
-
-        (void)memset(data, 0, sizeof(data));
 
         full_width = 0;
 
@@ -151,27 +148,24 @@ static void encode_status_header_(const struct rlc_context *ctx,
         bit_copy_mem_(data, pdu->flags.ext, full_width, 1);
         full_width += 1;
 
-        gabs_pbuf_put(buf, data, bytes_ceil_(full_width));
+        return bytes_ceil_(full_width);
 }
 
-void rlc_pdu_encode(struct rlc_context *ctx, const struct rlc_pdu *pdu,
-                    gabs_pbuf *buf)
+size_t rlc_pdu_encode_raw(struct rlc_context *ctx, const struct rlc_pdu *pdu,
+                          uint8_t data[RLC_PDU_HEADER_MAX_SIZE])
 {
-        size_t size;
         size_t full_width;
         uint8_t si;
-        uint8_t data[RLC_PDU_HEADER_MAX_SIZE];
 
-        (void)memset(data, 0, sizeof(data));
+        (void)memset(data, 0, RLC_PDU_HEADER_MAX_SIZE);
 
         switch (ctx->conf->type) {
         case RLC_TM:
                 /* Nothing to be done */
-                return;
+                return 0;
         case RLC_AM:
                 if (pdu->flags.is_status) {
-                        encode_status_header_(ctx, pdu, buf);
-                        return;
+                        return encode_status_header_(ctx, pdu, data);
                 }
                 /* fallthrough */
         case RLC_UM:
@@ -179,7 +173,6 @@ void rlc_pdu_encode(struct rlc_context *ctx, const struct rlc_pdu *pdu,
         }
 
         full_width = 0;
-        size = 0;
 
         if (ctx->conf->type == RLC_AM) {
                 /* Data bit and polled bit */
@@ -214,7 +207,19 @@ void rlc_pdu_encode(struct rlc_context *ctx, const struct rlc_pdu *pdu,
                 }
         }
 
-        gabs_pbuf_put(buf, data, bytes_ceil_(full_width));
+        return bytes_ceil_(full_width);
+}
+
+void rlc_pdu_encode(struct rlc_context *ctx, const struct rlc_pdu *pdu,
+                    gabs_pbuf *buf)
+{
+        size_t size;
+        uint8_t data[RLC_PDU_HEADER_MAX_SIZE];
+
+        size = rlc_pdu_encode_raw(ctx, pdu, data);
+        if (size > 0) {
+                gabs_pbuf_put(buf, data, size);
+        }
 }
 
 static rlc_errno
@@ -326,7 +331,18 @@ size_t rlc_pdu_header_size(const struct rlc_context *ctx,
 {
         switch (ctx->conf->type) {
         case RLC_AM:
+                if (pdu->flags.is_status) {
+                        /* D/C, CPT, ACK_SN and E1 */
+                        return bytes_ceil_(
+                                4 + sn_num_bits_(ctx->conf->sn_width) + 1);
+                }
+                /* fallthrough */
         case RLC_UM:
+                /* Only SI and reserved bits for a complete SDU in UM */
+                if (!has_sn_(pdu, ctx->conf->type)) {
+                        return 1;
+                }
+
                 return sn_num_bytes_(ctx->conf->sn_width) +
                        (SO_SIZE_ * has_so_(pdu));
         case RLC_TM:
@@ -337,15 +353,15 @@ size_t rlc_pdu_header_size(const struct rlc_context *ctx,
         }
 }
 
-void rlc_status_encode(struct rlc_context *ctx,
-                       const struct rlc_pdu_status *status, gabs_pbuf *buf)
+size_t rlc_status_encode_raw(struct rlc_context *ctx,
+                             const struct rlc_pdu_status *status,
+                             uint8_t data[RLC_STATUS_MAX_SIZE])
 {
         size_t full_width;
         size_t sn_width;
         uint8_t ext;
-        uint8_t data[RLC_STATUS_MAX_SIZE];
 
-        (void)memset(data, 0, sizeof(data));
+        (void)memset(data, 0, RLC_STATUS_MAX_SIZE);
 
         full_width = 0;
         sn_width = sn_num_bits_(ctx->conf->sn_width);
@@ -372,7 +388,17 @@ void rlc_status_encode(struct rlc_context *ctx,
                 full_width += 8;
         }
 
-        gabs_pbuf_put(buf, data, bytes_ceil_(full_width));
+        return bytes_ceil_(full_width);
+}
+
+void rlc_status_encode(struct rlc_context *ctx,
+                       const struct rlc_pdu_status *status, gabs_pbuf *buf)
+{
+        size_t size;
+        uint8_t data[RLC_STATUS_MAX_SIZE];
+
+        size = rlc_status_encode_raw(ctx, status, data);
+        gabs_pbuf_put(buf, data, size);
 }
 
 rlc_errno rlc_status_decode(struct rlc_context *ctx,
@@ -448,3 +474,34 @@ size_t rlc_status_size(const struct rlc_context *ctx,
 
         return ret;
 }
+
+/* The SN is kept in the lower 24 bits, followed by the 20 bit start and end of
+ * the SDU bytes. Data PDUs always carry payload, so an empty range marks a
+ * status PDU. */
+rlc_pdu_handle rlc_pdu_handle_make(const struct rlc_pdu *pdu, size_t size)
+{
+        uint64_t start;
+        uint64_t end;
+
+        if (pdu->flags.is_status) {
+                return 0;
+        }
+
+        start = pdu->seg_offset;
+        end = (uint64_t)pdu->seg_offset + size;
+        if (end > RLC_PDU_HANDLE_SO_MAX) {
+                return RLC_PDU_HANDLE_NONE;
+        }
+
+        return (uint64_t)pdu->sn | (start << 24) | (end << 44);
+}
+
+bool rlc_pdu_handle_parse(rlc_pdu_handle handle, uint32_t *sn,
+                          struct rlc_seg *seg)
+{
+        *sn = handle & RLC_PDU_HANDLE_SN_MAX;
+        seg->start = (handle >> 24) & RLC_PDU_HANDLE_SO_MAX;
+        seg->end = (handle >> 44) & RLC_PDU_HANDLE_SO_MAX;
+
+        return seg->end > seg->start;
+}
@@ -12,6 +12,14 @@ RLC_BEGIN_DECL
 void rlc_pdu_encode(struct rlc_context *ctx, const struct rlc_pdu *pdu,
                     gabs_pbuf *buf);
 
+/**
+ * @brief Encode the header of @p pdu into @p data.
+ *
+ * @return size_t Size of the encoded header
+ */
+size_t rlc_pdu_encode_raw(struct rlc_context *ctx, const struct rlc_pdu *pdu,
+                          uint8_t data[RLC_PDU_HEADER_MAX_SIZE]);
+
 rlc_errno rlc_pdu_decode(struct rlc_context *ctx, struct rlc_pdu *pdu,
                          gabs_pbuf *buf);
 
@@ -21,12 +29,47 @@ size_t rlc_pdu_header_size(const struct rlc_context *ctx,
 void rlc_status_encode(struct rlc_context *ctc,
                        const struct rlc_pdu_status *status, gabs_pbuf *buf);
 
+/**
+ * @brief Encode the status entry @p status into @p data.
+ *
+ * @return size_t Size of the encoded entry
+ */
+size_t rlc_status_encode_raw(struct rlc_context *ctx,
+                             const struct rlc_pdu_status *status,
+                             uint8_t data[RLC_STATUS_MAX_SIZE]);
+
 rlc_errno rlc_status_decode(struct rlc_context *ctx,
                             struct rlc_pdu_status *status, gabs_pbuf *buf);
 
 size_t rlc_status_size(const struct rlc_context *ctx,
                        struct rlc_pdu_status *status);
 
+/* Largest SN and SDU offset held by a PDU handle */
+#define RLC_PDU_HANDLE_SN_MAX ((UINT32_C(1) << 24) - 1)
+#define RLC_PDU_HANDLE_SO_MAX ((UINT32_C(1) << 20) - 1)
+
+/* Handle of a PDU whose SDU bytes do not fit in a handle */
+#define RLC_PDU_HANDLE_NONE (UINT64_MAX)
+
+/**
+ * @brief Make a handle for @p pdu, carrying @p size bytes of payload.
+ *
+ * @return rlc_pdu_handle
+ * @retval RLC_PDU_HANDLE_NONE The carried bytes end past
+ * `RLC_PDU_HANDLE_SO_MAX`
+ */
+rlc_pdu_handle rlc_pdu_handle_make(const struct rlc_pdu *pdu, size_t size);
+
+/**
+ * @brief Get the SN and the SDU bytes carried by the PDU of @p handle.
+ *
+ * @return bool
+ * @retval false @p handle refers to a status PDU, or is
+ * `RLC_PDU_HANDLE_NONE`
+ */
+bool rlc_pdu_handle_parse(rlc_pdu_handle handle, uint32_t *sn,
+                          struct rlc_seg *seg);
+
 RLC_END_DECL
 
 #endif /* RLC_ENCODE_H__ */
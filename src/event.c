@@ -2,6 +2,8 @@
 #include <rlc/rlc.h>
 
 #include "log.h"
+#include "mem.h"
+#include "trace.h"
 
 static struct rlc_event *event_get(struct rlc_sched_item *item)
 {
@@ -25,12 +27,17 @@ static void event_dealloc(struct rlc_sched_item *item)
         event = event_get(item);
 
         switch (event->type) {
+        case RLC_EVENT_TX_PAUSE:
+        case RLC_EVENT_TX_RESUME:
+                break;
         case RLC_EVENT_RX_DONE_DIRECT:
                 gabs_pbuf_decref(*event->rx_done_direct.buf);
         default:
                 rlc_sdu_decref(event->sdu);
         }
 
+        rlc_mem_sub(event->ctx, RLC_MEM_EVENT, 1, sizeof(*event));
+
         status = gabs_dealloc(event->ctx->alloc_misc, event);
         if (status != 0) {
                 gabs_log_errf(event->ctx->logger, "Failed to dealloc event: %i",
@@ -63,43 +70,65 @@ static struct rlc_event *event_alloc(struct rlc_context *ctx)
 
         mem->ctx = ctx;
 
+        rlc_mem_add(ctx, RLC_MEM_EVENT, 1, sizeof(*mem));
+
         rlc_sched_item_init(&mem->sched, event_sched_cb, event_dealloc);
 
         return mem;
 }
 
-static void sdu_event(struct rlc_context *ctx, struct rlc_sdu *sdu,
-                      enum rlc_event_type type)
+static struct rlc_event *sdu_event(struct rlc_context *ctx,
+                                   struct rlc_sdu *sdu,
+                                   enum rlc_event_type type)
 {
         struct rlc_event *event;
 
         event = event_alloc(ctx);
         if (event == NULL) {
-                return;
+                return NULL;
         }
 
         event->type = type;
         event->sdu = sdu;
 
         rlc_sdu_incref(sdu);
-        rlc_sched_put(&ctx->sched, &event->sched);
+
+        return event;
 }
 
-void rlc_event_rx_done(struct rlc_context *ctx, struct rlc_sdu *sdu)
+static void sdu_event_put(struct rlc_context *ctx, struct rlc_sdu *sdu,
+                          enum rlc_event_type type)
+{
+        struct rlc_event *event;
+
+        event = sdu_event(ctx, sdu, type);
+        if (event != NULL) {
+                rlc_sched_put(&ctx->sched, &event->sched);
+        }
+}
+
+static void tx_release_put(struct rlc_context *ctx, struct rlc_sdu *sdu,
+                           enum rlc_tx_release_reason reason)
 {
-        gabs_log_inff(ctx->logger,
-                      "RX; SDU %" PRIu32 " received (%" PRIu32 "B)", sdu->sn,
-                      gabs_pbuf_size(sdu->rx.buffer.buf));
+        struct rlc_event *event;
+
+        event = sdu_event(ctx, sdu, RLC_EVENT_TX_RELEASE);
+        if (event != NULL) {
+                event->tx_release.reason = reason;
+                rlc_sched_put(&ctx->sched, &event->sched);
+        }
+}
 
-        sdu_event(ctx, sdu, RLC_EVENT_RX_DONE);
+void rlc_event_rx_done(struct rlc_context *ctx, struct rlc_sdu *sdu)
+{
+        sdu_event_put(ctx, sdu, RLC_EVENT_RX_DONE);
 }
 
 void rlc_event_rx_done_direct(struct rlc_context *ctx, gabs_pbuf *buf)
 {
         struct rlc_event *event;
 
-        gabs_log_inff(ctx->logger, "RX; Full SDU delivered (%zuB)",
-                      gabs_pbuf_size(*buf));
+        rlc_trace(ctx, RLC_TRACE_RX_DELIVER, 0, 0, 0, 0, 0);
 
         event = event_alloc(ctx);
         if (event == NULL) {
@@ -115,22 +144,74 @@ void rlc_event_rx_done_direct(struct rlc_context *ctx, gabs_pbuf *buf)
 
 void rlc_event_tx_done(struct rlc_context *ctx, struct rlc_sdu *sdu)
 {
-        gabs_log_inff(ctx->logger, "TX; SDU %" PRIu32 " transmitted (%zuB)",
-                      sdu->sn, gabs_pbuf_size(sdu->tx.buffer));
+        rlc_trace(ctx, RLC_TRACE_TX_DONE, sdu->sn, 0, 0, 0, 0);
 
-        sdu_event(ctx, sdu, RLC_EVENT_TX_RELEASE);
+        tx_release_put(ctx, sdu, RLC_TX_RELEASE_DONE);
 }
 
 void rlc_event_rx_drop(struct rlc_context *ctx, struct rlc_sdu *sdu)
 {
         gabs_log_wrnf(ctx->logger, "Dropping SN=%" PRIu32, sdu->sn);
+        rlc_trace(ctx, RLC_TRACE_RX_DROP, sdu->sn, 0, 0, 0, 0);
 
-        sdu_event(ctx, sdu, RLC_EVENT_RX_FAIL);
+        sdu_event_put(ctx, sdu, RLC_EVENT_RX_FAIL);
 }
 
 void rlc_event_tx_fail(struct rlc_context *ctx, struct rlc_sdu *sdu)
 {
         gabs_log_errf(ctx->logger, "Failed transmit of SN=%" PRIu32, sdu->sn);
+        rlc_trace(ctx, RLC_TRACE_TX_FAIL, sdu->sn, 0, 0, 0, 0);
+
+        tx_release_put(ctx, sdu, RLC_TX_RELEASE_FAIL);
+}
+
+void rlc_event_tx_discard(struct rlc_context *ctx, struct rlc_sdu *sdu)
+{
+        gabs_log_wrnf(ctx->logger, "Discarding SDU");
+        rlc_trace(ctx, RLC_TRACE_TX_DISCARD, sdu->sn, 0, 0, 0, 0);
+
+        tx_release_put(ctx, sdu, RLC_TX_RELEASE_DISCARD);
+}
+
+void rlc_event_tx_aqm_drop(struct rlc_context *ctx, struct rlc_sdu *sdu)
+{
+        gabs_log_dbgf(ctx->logger, "Queue management dropping SDU");
+        rlc_trace(ctx, RLC_TRACE_TX_DISCARD, sdu->sn, 0, 0, 0, 0);
+
+        tx_release_put(ctx, sdu, RLC_TX_RELEASE_AQM);
+}
+
+void rlc_event_tx_mark(struct rlc_context *ctx, struct rlc_sdu *sdu)
+{
+        gabs_log_dbgf(ctx->logger, "Queue management marking SN=%" PRIu32,
+                      sdu->sn);
+
+        sdu_event_put(ctx, sdu, RLC_EVENT_TX_MARK);
+}
+
+static void flow_event_put(struct rlc_context *ctx, enum rlc_event_type type)
+{
+        struct rlc_event *event;
+
+        event = event_alloc(ctx);
+        if (event != NULL) {
+                event->type = type;
+                event->sdu = NULL;
+
+                rlc_sched_put(&ctx->sched, &event->sched);
+        }
+}
+
+void rlc_event_tx_pause(struct rlc_context *ctx)
+{
+        gabs_log_dbgf(ctx->logger, "TX queue above high watermark");
+
+        flow_event_put(ctx, RLC_EVENT_TX_PAUSE);
+}
+
+void rlc_event_tx_resume(struct rlc_context *ctx)
+{
+        gabs_log_dbgf(ctx->logger, "TX queue below low watermark");
 
-        sdu_event(ctx, sdu, RLC_EVENT_TX_RELEASE);
+        flow_event_put(ctx, RLC_EVENT_TX_RESUME);
 }
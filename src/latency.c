@@ -0,0 +1,129 @@
+
+#include <string.h>
+
+#include <rlc/rlc.h>
+#include <rlc/latency.h>
+
+#include "common.h"
+#include "latency.h"
+
+size_t rlc_hist_bucket(uint64_t value_us)
+{
+        uint32_t value;
+        unsigned int shift;
+
+        value = rlc_min(value_us, UINT32_MAX);
+        if (value < RLC_HIST_SUB_COUNT) {
+                return value;
+        }
+
+        /* Position of the most significant bit, less the bits kept */
+        shift = 31 - __builtin_clz(value) - RLC_HIST_SUB_BITS;
+
+        return (shift + 1) * RLC_HIST_SUB_COUNT +
+               ((value >> shift) - RLC_HIST_SUB_COUNT);
+}
+
+uint32_t rlc_hist_bucket_start(size_t index)
+{
+        unsigned int shift;
+
+        if (index < RLC_HIST_SUB_COUNT) {
+                return index;
+        }
+
+        shift = index / RLC_HIST_SUB_COUNT - 1;
+
+        return (RLC_HIST_SUB_COUNT + index % RLC_HIST_SUB_COUNT) << shift;
+}
+
+static uint32_t bucket_last(size_t index)
+{
+        if (index + 1 >= RLC_HIST_BUCKETS) {
+                return UINT32_MAX;
+        }
+
+        return rlc_hist_bucket_start(index + 1) - 1;
+}
+
+void rlc_hist_add(struct rlc_hist *hist, uint64_t value_us)
+{
+        uint32_t value;
+
+        value = rlc_min(value_us, UINT32_MAX);
+
+        if (hist->count == 0 || value < hist->min_us) {
+                hist->min_us = value;
+        }
+
+        hist->max_us = rlc_max(hist->max_us, value);
+        hist->sum_us += value;
+        hist->count++;
+
+        hist->buckets[rlc_hist_bucket(value)]++;
+}
+
+void rlc_hist_reset(struct rlc_hist *hist)
+{
+        (void)memset(hist, 0, sizeof(*hist));
+}
+
+uint32_t rlc_hist_value_at(const struct rlc_hist *hist, double quantile)
+{
+        uint64_t rank;
+        uint64_t seen;
+        size_t i;
+
+        if (hist->count == 0) {
+                return 0;
+        }
+
+        quantile = rlc_max(rlc_min(quantile, 1.0), 0.0);
+
+        /* Number of samples at or below the value, at least one */
+        rank = (uint64_t)(quantile * hist->count);
+        if (rank < quantile * hist->count || rank == 0) {
+                rank++;
+        }
+
+        seen = 0;
+
+        for (i = 0; i < RLC_HIST_BUCKETS; i++) {
+                seen += hist->buckets[i];
+
+                if (seen >= rank) {
+                        return rlc_min(bucket_last(i), hist->max_us);
+                }
+        }
+
+        return hist->max_us;
+}
+
+void rlc_latency_attach(struct rlc_context *ctx, struct rlc_latency *latency)
+{
+        if (latency != NULL) {
+                (void)memset(latency, 0, sizeof(*latency));
+        }
+
+        rlc_lock_acquire(&ctx->lock);
+        ctx->latency = latency;
+        rlc_lock_release(&ctx->lock);
+}
+
+void rlc_latency_snapshot(struct rlc_context *ctx, struct rlc_latency *out,
+                          bool reset)
+{
+        rlc_lock_acquire(&ctx->lock);
+
+        if (ctx->latency == NULL) {
+                (void)memset(out, 0, sizeof(*out));
+        } else {
+                *out = *ctx->latency;
+
+                if (reset) {
+                        (void)memset(ctx->latency, 0, sizeof(*ctx->latency));
+                }
+        }
+
+        rlc_lock_release(&ctx->lock);
+}
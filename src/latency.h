@@ -0,0 +1,26 @@
+
+#ifndef RLC_LATENCY_INTERNAL_H__
+#define RLC_LATENCY_INTERNAL_H__
+
+#include <rlc/rlc.h>
+#include <rlc/latency.h>
+
+RLC_BEGIN_DECL
+
+/**
+ * @brief Record the time from @p start_us to @p end_us as @p kind, if
+ * histograms are attached to @p ctx. Must be called with the context lock
+ * held.
+ */
+static inline void rlc_latency_add(struct rlc_context *ctx,
+                                   enum rlc_latency_kind kind,
+                                   uint64_t start_us, uint64_t end_us)
+{
+        if (ctx->latency != NULL && end_us >= start_us) {
+                rlc_hist_add(&ctx->latency->hist[kind], end_us - start_us);
+        }
+}
+
+RLC_END_DECL
+
+#endif /* RLC_LATENCY_INTERNAL_H__ */
@@ -0,0 +1,270 @@
+
+#include <rlc/rlc.h>
+#include <rlc/lcp.h>
+
+#include "common.h"
+
+#define US_PER_S (1000000)
+
+static struct rlc_lcp_channel *chan_from_it(rlc_dlist_it it)
+{
+        return rlc_dlist_it_item(it, struct rlc_lcp_channel, list_node);
+}
+
+static struct rlc_lcp_channel *chan_from_node(rlc_dlist_node *node)
+{
+        return gabs_container_of(node, struct rlc_lcp_channel, list_node);
+}
+
+/* Number of bytes the channel needs to empty its buffer */
+static size_t chan_pending(struct rlc_lcp_channel *chan)
+{
+        struct rlc_tx_buffer_status status;
+
+        rlc_tx_buffer_status(chan->ctx, &status);
+
+        if (status.new_bytes == 0 && status.retx_bytes == 0 &&
+            status.status_bytes == 0) {
+                return 0;
+        }
+
+        return status.new_bytes + status.retx_bytes + status.status_bytes +
+               status.header_bytes;
+}
+
+static int64_t bucket_max(struct rlc_lcp_channel *chan)
+{
+        return (int64_t)((uint64_t)chan->pbr * chan->bsd_us / US_PER_S);
+}
+
+void rlc_lcp_channel_init(struct rlc_lcp_channel *chan,
+                          struct rlc_context *ctx, unsigned int priority,
+                          uint32_t pbr, uint32_t bsd_us)
+{
+        chan->ctx = ctx;
+        chan->priority = priority;
+        chan->pbr = pbr;
+        chan->bsd_us = bsd_us;
+        chan->bucket = 0;
+        chan->bucket_frac = 0;
+
+        chan->grant.next = NULL;
+        chan->grant.bucket = 0;
+        chan->grant.used = 0;
+
+        rlc_dlist_node_init(&chan->list_node);
+}
+
+rlc_errno rlc_lcp_init(struct rlc_lcp *lcp)
+{
+        rlc_errno status;
+
+        rlc_dlist_init(&lcp->channels);
+
+        status = gabs_mutex_init(&lcp->lock);
+        if (status != 0) {
+                return status;
+        }
+
+        status = gabs_mutex_init(&lcp->grant_lock);
+        if (status != 0) {
+                (void)gabs_mutex_deinit(&lcp->lock);
+        }
+
+        return status;
+}
+
+rlc_errno rlc_lcp_deinit(struct rlc_lcp *lcp)
+{
+        rlc_errno status;
+
+        status = gabs_mutex_deinit(&lcp->grant_lock);
+        if (status != 0) {
+                return status;
+        }
+
+        return gabs_mutex_deinit(&lcp->lock);
+}
+
+void rlc_lcp_add(struct rlc_lcp *lcp, struct rlc_lcp_channel *chan)
+{
+        rlc_dlist_node *pos;
+
+        rlc_lock_acquire(&lcp->lock);
+
+        /* Channels are mostly added in order of priority, so the place is
+         * looked for from the back. Channels of the same priority are served
+         * in the order they were added. */
+        for (pos = lcp->channels.tail;
+             pos != NULL && chan_from_node(pos)->priority > chan->priority;
+             pos = pos->prev) {
+        }
+
+        rlc_dlist_insert_after(&lcp->channels, pos, &chan->list_node);
+
+        rlc_lock_release(&lcp->lock);
+}
+
+void rlc_lcp_remove(struct rlc_lcp *lcp, struct rlc_lcp_channel *chan)
+{
+        rlc_lock_acquire(&lcp->grant_lock);
+        rlc_lock_acquire(&lcp->lock);
+
+        rlc_dlist_remove(&lcp->channels, &chan->list_node);
+
+        rlc_lock_release(&lcp->lock);
+        rlc_lock_release(&lcp->grant_lock);
+}
+
+void rlc_lcp_tick(struct rlc_lcp *lcp, uint32_t elapsed_us)
+{
+        struct rlc_lcp_channel *chan;
+        rlc_dlist_it it;
+        uint64_t added;
+        int64_t max;
+
+        rlc_lock_acquire(&lcp->lock);
+
+        rlc_dlist_foreach(&lcp->channels, it)
+        {
+                chan = chan_from_it(it);
+
+                if (chan->pbr == RLC_LCP_PBR_INFINITY) {
+                        continue;
+                }
+
+                max = bucket_max(chan);
+
+                /* Carry what is short of a whole byte to the next tick, or
+                 * short ticks would never fill the bucket */
+                added = (uint64_t)chan->pbr * elapsed_us + chan->bucket_frac;
+
+                chan->bucket += (int64_t)(added / US_PER_S);
+                chan->bucket_frac = (uint32_t)(added % US_PER_S);
+
+                if (chan->bucket >= max) {
+                        chan->bucket = max;
+                        chan->bucket_frac = 0;
+                }
+        }
+
+        rlc_lock_release(&lcp->lock);
+}
+
+size_t rlc_lcp_grant(struct rlc_lcp *lcp, size_t grant)
+{
+        struct rlc_lcp_channel *chan;
+        struct rlc_lcp_channel *head;
+        struct rlc_lcp_channel **tail;
+        rlc_dlist_it it;
+        size_t prioritized;
+        size_t remaining;
+        size_t pending;
+        size_t share;
+        size_t used;
+        size_t carry;
+        size_t take;
+        size_t from_carry;
+
+        rlc_lock_acquire(&lcp->grant_lock);
+
+        /* Take the channels in order of priority along with their buckets,
+         * so that they are served without holding the lock */
+        head = NULL;
+        tail = &head;
+
+        rlc_lock_acquire(&lcp->lock);
+
+        rlc_dlist_foreach(&lcp->channels, it)
+        {
+                chan = chan_from_it(it);
+
+                chan->grant.next = NULL;
+                chan->grant.bucket = chan->bucket;
+                chan->grant.used = 0;
+
+                *tail = chan;
+                tail = &chan->grant.next;
+        }
+
+        rlc_lock_release(&lcp->lock);
+
+        /* Step 1: find out how much of the grant goes to prioritized bit
+         * rates, so that the second step knows what is left over. */
+        prioritized = 0;
+
+        for (chan = head; chan != NULL; chan = chan->grant.next) {
+                if (prioritized >= grant) {
+                        break;
+                }
+
+                if (chan->pbr != RLC_LCP_PBR_INFINITY &&
+                    chan->grant.bucket <= 0) {
+                        continue;
+                }
+
+                pending = chan_pending(chan);
+                if (chan->pbr != RLC_LCP_PBR_INFINITY) {
+                        pending = rlc_min(pending, (size_t)chan->grant.bucket);
+                }
+
+                prioritized += rlc_min(pending, grant - prioritized);
+        }
+
+        /* Step 2 and 3: serve every channel once in priority order, giving
+         * it its prioritized share plus whatever it can use of the
+         * remaining bytes. Bytes a channel does not use are carried over to
+         * the next one. */
+        remaining = grant - prioritized;
+        carry = 0;
+
+        for (chan = head; chan != NULL; chan = chan->grant.next) {
+                pending = chan_pending(chan);
+                if (pending == 0) {
+                        continue;
+                }
+
+                share = 0;
+                if (chan->pbr == RLC_LCP_PBR_INFINITY) {
+                        share = pending;
+                } else if (chan->grant.bucket > 0) {
+                        share = rlc_min(pending, (size_t)chan->grant.bucket);
+                }
+
+                share = rlc_min(share, prioritized);
+                prioritized -= share;
+
+                /* Top up with bytes left unused by earlier channels first,
+                 * then with the rest of the grant. */
+                take = rlc_min(pending - share, carry + remaining);
+                share += take;
+
+                from_carry = rlc_min(take, carry);
+                carry -= from_carry;
+                remaining -= take - from_carry;
+
+                if (share == 0) {
+                        continue;
+                }
+
+                used = share - rlc_tx_avail(chan->ctx, share);
+                carry += share - used;
+
+                chan->grant.used = used;
+        }
+
+        /* The buckets may have been filled meanwhile, so only what was used
+         * is taken from them */
+        rlc_lock_acquire(&lcp->lock);
+
+        for (chan = head; chan != NULL; chan = chan->grant.next) {
+                if (chan->pbr != RLC_LCP_PBR_INFINITY) {
+                        chan->bucket -= (int64_t)chan->grant.used;
+                }
+        }
+
+        rlc_lock_release(&lcp->lock);
+        rlc_lock_release(&lcp->grant_lock);
+
+        return remaining + carry + prioritized;
+}
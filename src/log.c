@@ -30,11 +30,11 @@ static const char *fmt_segments(rlc_seg_list *list, char *buf, size_t max_size,
         int bytes;
         int ret;
         struct rlc_seg_item *seg_item;
-        rlc_list_it it;
+        rlc_dlist_it it;
 
         bytes = 0;
 
-        rlc_list_foreach(list, it)
+        rlc_dlist_foreach(list, it)
         {
                 seg_item = rlc_seg_item_from_it(it);
                 ret = snprintf(buf + bytes, max_size - bytes,
@@ -66,7 +66,8 @@ void rlc_log_tx_sdu(const gabs_logger_h *logger, struct rlc_sdu *sdu)
                       "%s"
                       "\t}\n"
                       "}",
-                      sdu->sn, sdu_state_str(sdu->state), sdu->refcount,
+                      sdu->sn, sdu_state_str(sdu->state),
+                      rlc_atomic_load(&sdu->refcount),
                       sdu->tx.retx_count,
                       fmt_segments(&sdu->tx.unsent, buf, sizeof(buf), "\t\t"));
 }
@@ -86,7 +87,8 @@ void rlc_log_rx_sdu(const gabs_logger_h *logger, struct rlc_sdu *sdu)
                       "%s"
                       "\t}\n"
                       "}",
-                      sdu->sn, sdu_state_str(sdu->state), sdu->refcount,
+                      sdu->sn, sdu_state_str(sdu->state),
+                      rlc_atomic_load(&sdu->refcount),
                       sdu->rx.last_received,
                       fmt_segments(&sdu->rx.buffer.segments, buf, sizeof(buf), "\t\t"));
 }
@@ -95,13 +97,13 @@ static void log_window(struct rlc_context *ctx, rlc_sdu_queue *q,
                        struct rlc_window *win, bool rx)
 {
         struct rlc_sdu *cur;
-        rlc_list_it it;
+        rlc_dlist_it it;
 
         gabs_log_dbgf(ctx->logger, "%s window(%" PRIu32 "->%" PRIu32 "): {",
                       rx ? "RX" : "TX", rlc_window_base(win),
                       rlc_window_end(win));
 
-        rlc_list_foreach(q, it)
+        rlc_dlist_foreach(q, it)
         {
                 cur = rlc_sdu_from_it(it);
 
@@ -0,0 +1,175 @@
+
+#include <rlc/rlc.h>
+#include <rlc/mem.h>
+#include <rlc/seg_list.h>
+
+#include "mem.h"
+
+static void peak_raise(size_t *peak, size_t value)
+{
+        size_t cur;
+
+        cur = rlc_atomic_load(peak);
+        while (cur < value && !rlc_atomic_cas(peak, &cur, value)) {
+        }
+}
+
+/* The counters are unsigned, and `rlc_mem_sub` relies on them wrapping
+ * around. Peaks are left to `rlc_mem_peak_update`. */
+void rlc_mem_add(struct rlc_context *ctx, enum rlc_mem_kind kind,
+                 size_t count, size_t bytes)
+{
+        struct rlc_mem_stat *stat;
+
+        stat = &ctx->mem.kind[kind];
+
+        (void)rlc_atomic_add(&stat->count, count);
+        (void)rlc_atomic_add(&stat->bytes, bytes);
+        (void)rlc_atomic_add(&ctx->mem.bytes, bytes);
+}
+
+void rlc_mem_sub(struct rlc_context *ctx, enum rlc_mem_kind kind,
+                 size_t count, size_t bytes)
+{
+        rlc_assert(rlc_atomic_load(&ctx->mem.kind[kind].count) >= count);
+        rlc_assert(rlc_atomic_load(&ctx->mem.kind[kind].bytes) >= bytes);
+
+        rlc_mem_add(ctx, kind, -count, -bytes);
+}
+
+/* RX SDUs are counted against the shared budget of the context as well */
+static void rx_budget_add(struct rlc_sdu *sdu, size_t bytes)
+{
+        struct rlc_rx_budget *budget;
+
+        budget = sdu->ctx->rx.budget;
+        if (!sdu->is_tx && budget != NULL) {
+                (void)rlc_atomic_add(&budget->used_bytes, bytes);
+        }
+}
+
+void rlc_mem_sdu_sync(struct rlc_sdu *sdu)
+{
+        enum rlc_mem_kind kind;
+        rlc_seg_list *segments;
+        gabs_pbuf buf;
+        size_t bytes;
+        size_t nodes;
+
+        if (sdu->is_tx) {
+                kind = RLC_MEM_TX_SDU;
+                segments = &sdu->tx.unsent;
+                buf = sdu->tx.buffer;
+        } else {
+                kind = RLC_MEM_RX_SDU;
+                segments = &sdu->rx.buffer.segments;
+                buf = sdu->rx.buffer.buf;
+        }
+
+        bytes = sizeof(*sdu);
+        if (gabs_pbuf_okay(buf)) {
+                bytes += gabs_pbuf_size(buf);
+        }
+
+        nodes = rlc_dlist_count(segments);
+
+        /* The SDU itself is counted on the first sync. Differences wrap
+         * around when the SDU shrinks. */
+        if (bytes != sdu->mem.bytes) {
+                rlc_mem_add(sdu->ctx, kind, sdu->mem.bytes == 0,
+                            bytes - sdu->mem.bytes);
+                rx_budget_add(sdu, bytes - sdu->mem.bytes);
+        }
+
+        if (nodes != sdu->mem.nodes) {
+                rlc_mem_add(sdu->ctx, RLC_MEM_SEG_NODE, nodes - sdu->mem.nodes,
+                            (nodes - sdu->mem.nodes) *
+                                    sizeof(struct rlc_seg_item));
+        }
+
+        sdu->mem.bytes = bytes;
+        sdu->mem.nodes = nodes;
+}
+
+void rlc_mem_sdu_release(struct rlc_sdu *sdu)
+{
+        if (sdu->mem.bytes == 0) {
+                return;
+        }
+
+        rlc_mem_sub(sdu->ctx, sdu->is_tx ? RLC_MEM_TX_SDU : RLC_MEM_RX_SDU, 1,
+                    sdu->mem.bytes);
+        rx_budget_add(sdu, -sdu->mem.bytes);
+        rlc_mem_sub(sdu->ctx, RLC_MEM_SEG_NODE, sdu->mem.nodes,
+                    sdu->mem.nodes * sizeof(struct rlc_seg_item));
+
+        sdu->mem.bytes = 0;
+        sdu->mem.nodes = 0;
+}
+
+void rlc_mem_peak_update(struct rlc_context *ctx)
+{
+        struct rlc_mem_stat *stat;
+        size_t i;
+
+        for (i = 0; i < RLC_MEM_COUNT; i++) {
+                stat = &ctx->mem.kind[i];
+
+                peak_raise(&stat->peak_count, rlc_atomic_load(&stat->count));
+                peak_raise(&stat->peak_bytes, rlc_atomic_load(&stat->bytes));
+        }
+
+        peak_raise(&ctx->mem.peak_bytes, rlc_atomic_load(&ctx->mem.bytes));
+}
+
+void rlc_mem_usage(struct rlc_context *ctx, struct rlc_mem_stats *out,
+                   bool reset_peaks)
+{
+        struct rlc_mem_stat *stat;
+        size_t i;
+
+        rlc_mem_peak_update(ctx);
+
+        for (i = 0; i < RLC_MEM_COUNT; i++) {
+                stat = &ctx->mem.kind[i];
+
+                out->kind[i].bytes = rlc_atomic_load(&stat->bytes);
+                out->kind[i].count = rlc_atomic_load(&stat->count);
+                out->kind[i].peak_bytes = rlc_atomic_load(&stat->peak_bytes);
+                out->kind[i].peak_count = rlc_atomic_load(&stat->peak_count);
+
+                if (reset_peaks) {
+                        rlc_atomic_store(&stat->peak_bytes,
+                                         out->kind[i].bytes);
+                        rlc_atomic_store(&stat->peak_count,
+                                         out->kind[i].count);
+                }
+        }
+
+        out->bytes = rlc_atomic_load(&ctx->mem.bytes);
+        out->peak_bytes = rlc_atomic_load(&ctx->mem.peak_bytes);
+
+        if (reset_peaks) {
+                rlc_atomic_store(&ctx->mem.peak_bytes, out->bytes);
+        }
+}
+
+const char *rlc_mem_kind_str(enum rlc_mem_kind kind)
+{
+        switch (kind) {
+        case RLC_MEM_TX_SDU:
+                return "tx_sdu";
+        case RLC_MEM_RX_SDU:
+                return "rx_sdu";
+        case RLC_MEM_SEG_NODE:
+                return "seg_node";
+        case RLC_MEM_EVENT:
+                return "event";
+        case RLC_MEM_OFFLOAD:
+                return "offload";
+        case RLC_MEM_HEADER:
+                return "header";
+        default:
+                return "unknown";
+        }
+}
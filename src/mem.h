@@ -0,0 +1,42 @@
+
+#ifndef RLC_MEM_INTERNAL_H__
+#define RLC_MEM_INTERNAL_H__
+
+#include <rlc/rlc.h>
+#include <rlc/mem.h>
+
+RLC_BEGIN_DECL
+
+/**
+ * @brief Account @p count objects of @p bytes in total to @p kind. The peaks
+ * are not raised until the next `rlc_mem_peak_update`.
+ *
+ * May be called without the context lock, as events and offloads are
+ * released from the scheduler.
+ */
+void rlc_mem_add(struct rlc_context *ctx, enum rlc_mem_kind kind,
+                 size_t count, size_t bytes);
+
+/** @brief Undo `rlc_mem_add` */
+void rlc_mem_sub(struct rlc_context *ctx, enum rlc_mem_kind kind,
+                 size_t count, size_t bytes);
+
+/**
+ * @brief Bring the accounting of @p sdu up to date with its data and segment
+ * list. Must be called with the context lock held after either changes.
+ */
+void rlc_mem_sdu_sync(struct rlc_sdu *sdu);
+
+/** @brief Remove everything accounted to @p sdu, when it is deallocated */
+void rlc_mem_sdu_release(struct rlc_sdu *sdu);
+
+/**
+ * @brief Raise the peaks of @p ctx to the current values. Called once at the
+ * end of each call that may allocate, rather than on every change, so that
+ * memory held only within a call is not seen in the peaks.
+ */
+void rlc_mem_peak_update(struct rlc_context *ctx);
+
+RLC_END_DECL
+
+#endif /* RLC_MEM_INTERNAL_H__ */
@@ -149,5 +149,8 @@ rlc_errno rlc_reset(struct rlc_context *ctx)
 
         rlc_lock_release(&ctx->lock);
 
+        /* Emptying the TX queue may have resumed the upper layer */
+        rlc_sched_yield(&ctx->sched);
+
         return 0;
 }
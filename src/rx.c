@@ -7,17 +7,21 @@
 #include <rlc/backend.h>
 
 #include "arq.h"
+#include "capture.h"
 #include "encode.h"
 #include "log.h"
+#include "clock.h"
 #include "common.h"
-
-/* Section 5.2.3.2.4, "when t-Reassembly expires" */
-static bool should_restart_reassembly(struct rlc_context *ctx)
+#include "latency.h"
+#include "mem.h"
+#include "trace.h"
+
+/* Section 5.2.3.2.4, "when t-Reassembly expires". @p rx_highest_ack is
+ * RX_Highest_Status in AM, and RX_Next_Reassembly in UM. */
+static bool should_restart_reassembly(struct rlc_context *ctx,
+                                      uint32_t rx_highest_ack)
 {
         struct rlc_sdu *sdu;
-        uint32_t rx_highest_ack;
-
-        rx_highest_ack = rlc_window_base(&ctx->rx.win);
 
         if (ctx->rx.next_highest > rx_highest_ack + 1) {
                 return true;
@@ -87,14 +91,43 @@ static bool should_stop_reassembly(struct rlc_context *ctx)
         return false;
 }
 
+static void deliver_latency(struct rlc_context *ctx, struct rlc_sdu *sdu)
+{
+        uint64_t now_us;
+
+        if (ctx->latency == NULL) {
+                return;
+        }
+
+        now_us = rlc_clock_now_us(ctx);
+
+        rlc_latency_add(ctx, RLC_LATENCY_RX_DELIVER, sdu->rx.first_us, now_us);
+        rlc_latency_add(ctx, RLC_LATENCY_RX_HOLD, sdu->rx.done_us, now_us);
+}
+
 static void deliver_sdu(struct rlc_context *ctx, struct rlc_sdu *sdu)
 {
-        gabs_log_inff(ctx->logger, "Delivering SDU %i", sdu->sn);
+        if (!sdu->rx.delivered) {
+                deliver_latency(ctx, sdu);
+                rlc_trace(ctx, RLC_TRACE_RX_DELIVER, sdu->sn, 0, 0, 0, 0);
+
+                rlc_event_rx_done(ctx, sdu);
+        }
 
-        rlc_event_rx_done(ctx, sdu);
         rlc_sdu_decref(sdu);
 }
 
+/* Deliver @p sdu while keeping it in the RX queue, so that it is still
+ * reported correctly in status PDUs until the window moves past it. */
+static void deliver_early(struct rlc_context *ctx, struct rlc_sdu *sdu)
+{
+        rlc_trace(ctx, RLC_TRACE_RX_DELIVER, sdu->sn, 0, 0, 1, 0);
+        deliver_latency(ctx, sdu);
+
+        sdu->rx.delivered = true;
+        rlc_event_rx_done(ctx, sdu);
+}
+
 static void drop_sdu(struct rlc_context *ctx, struct rlc_sdu *sdu)
 {
         gabs_log_wrnf(ctx->logger, "Dropping SDU %i", sdu->sn);
@@ -103,21 +136,188 @@ static void drop_sdu(struct rlc_context *ctx, struct rlc_sdu *sdu)
         rlc_sdu_decref(sdu);
 }
 
+/* Bytes by which the RX budgets would be exceeded if @p need more bytes
+ * were held, 0 if they would not */
+static size_t budget_excess(struct rlc_context *ctx, size_t need)
+{
+        size_t limit;
+        size_t used;
+        size_t excess;
+
+        excess = 0;
+
+        limit = ctx->conf->rx_budget_bytes;
+        if (limit != 0) {
+                used = rlc_atomic_load(&ctx->mem.kind[RLC_MEM_RX_SDU].bytes);
+                if (used + need > limit) {
+                        excess = used + need - limit;
+                }
+        }
+
+        if (ctx->rx.budget != NULL) {
+                limit = ctx->rx.budget->limit_bytes;
+                used = rlc_atomic_load(&ctx->rx.budget->used_bytes);
+                if (used + need > limit) {
+                        excess = rlc_max(excess, used + need - limit);
+                }
+        }
+
+        return excess;
+}
+
+/* Incomplete SDU with the oldest first segment, other than @p keep and the
+ * SDU at the start of the window */
+static struct rlc_sdu *budget_victim(struct rlc_context *ctx,
+                                     struct rlc_sdu *keep)
+{
+        struct rlc_sdu *victim;
+        struct rlc_sdu *cur;
+        rlc_dlist_it it;
+
+        victim = NULL;
+
+        rlc_dlist_foreach(&ctx->rx.sdus, it)
+        {
+                cur = rlc_sdu_from_it(it);
+
+                if (cur == keep || cur->state == RLC_DONE ||
+                    cur->sn == rlc_window_base(&ctx->rx.win)) {
+                        continue;
+                }
+
+                if (victim == NULL || cur->rx.first_us < victim->rx.first_us) {
+                        victim = cur;
+                }
+        }
+
+        return victim;
+}
+
+/* Drop @p sdu to make room in the RX budgets. Its data is released right
+ * away, rather than when the listener is done with the event. */
+static void budget_drop(struct rlc_context *ctx, struct rlc_sdu *sdu)
+{
+        rlc_sdu_queue_remove(&ctx->rx.sdus, sdu);
+
+        rlc_seg_buf_destroy(&sdu->rx.buffer, ctx->alloc_misc);
+        (void)memset(&sdu->rx.buffer, 0, sizeof(sdu->rx.buffer));
+        rlc_mem_sdu_sync(sdu);
+
+        ctx->rx.budget_dropped++;
+        drop_sdu(ctx, sdu);
+}
+
+/**
+ * @brief Check whether @p need bytes of a PDU for SN=@p sn fit in the RX
+ * budgets, applying the budget policy if they do not.
+ *
+ * @param sdu SDU of @p sn, if it is already being reassembled
+ */
+static bool budget_admit(struct rlc_context *ctx, struct rlc_sdu *sdu,
+                         uint32_t sn, size_t need)
+{
+        struct rlc_sdu *victim;
+        size_t excess;
+
+        excess = budget_excess(ctx, need);
+        if (excess == 0) {
+                return true;
+        }
+
+        if (ctx->conf->rx_budget_policy == RLC_RX_BUDGET_DROP_OLDEST) {
+                while (excess > 0) {
+                        victim = budget_victim(ctx, sdu);
+                        if (victim == NULL) {
+                                break;
+                        }
+
+                        budget_drop(ctx, victim);
+                        excess = budget_excess(ctx, need);
+                }
+
+                if (excess == 0) {
+                        return true;
+                }
+        } else if (sdu != NULL) {
+                return true;
+        }
+
+        /* The window only moves once its first SDU is complete, so that SDU
+         * is never held back by the budget */
+        if (sn == rlc_window_base(&ctx->rx.win)) {
+                return true;
+        }
+
+        gabs_log_wrnf(ctx->logger,
+                      "RX; SN=%" PRIu32 " exceeds RX budget by %zu, discarding",
+                      sn, excess);
+
+        ctx->rx.budget_rejected++;
+
+        return false;
+}
+
+/* Lowest SN from @p next for which not all bytes have been received */
+static uint32_t lowest_sn_not_recv(struct rlc_context *ctx, uint32_t next)
+{
+        struct rlc_sdu *cur;
+        rlc_dlist_it it;
+
+        rlc_dlist_foreach(&ctx->rx.sdus, it)
+        {
+                cur = rlc_sdu_from_it(it);
+
+                if (cur->sn < next) {
+                        continue;
+                }
+
+                if (cur->sn != next || cur->state != RLC_DONE) {
+                        return next;
+                }
+
+                next += 1;
+        }
+
+        return next;
+}
+
 static void alarm_reassembly(struct rlc_timer *timer, struct rlc_context *ctx)
 {
         struct rlc_sdu *sdu;
         uint32_t lowest;
         uint32_t next;
-        rlc_list_it it;
+        rlc_dlist_it it;
 
         gabs_log_dbgf(ctx->logger, "Reassembly alarm");
 
+        /* In AM, the window only moves past SDUs that are received in full.
+         * Missing SDUs are reported in a status PDU rather than dropped. */
+        if (ctx->conf->type == RLC_AM) {
+                ctx->rx.highest_status = lowest_sn_not_recv(
+                        ctx, rlc_max(ctx->rx.next_status_trigger,
+                                     rlc_window_base(&ctx->rx.win)));
+
+                rlc_arq_rx_status_trigger(ctx);
+
+                if (should_restart_reassembly(ctx, ctx->rx.highest_status)) {
+                        ctx->rx.next_status_trigger = ctx->rx.next_highest;
+
+                        rlc_timer_start(timer, ctx->conf->time_reassembly_us);
+                }
+
+                if (rlc_arq_tx_pending(ctx)) {
+                        rlc_backend_tx_request(ctx);
+                }
+
+                return;
+        }
+
         lowest = ctx->rx.next_highest;
         next = rlc_window_base(&ctx->rx.win);
 
         /* Find the SDU with the lowest SN that is >= RX_Next_status_trigger,
          * and set the highest status to that SN */
-        rlc_list_foreach(&ctx->rx.sdus, it)
+        rlc_dlist_foreach(&ctx->rx.sdus, it)
         {
                 sdu = rlc_sdu_from_it(it);
 
@@ -132,7 +332,7 @@ static void alarm_reassembly(struct rlc_timer *timer, struct rlc_context *ctx)
 
         rlc_window_move_to(&ctx->rx.win, lowest);
 
-        rlc_list_foreach(&ctx->rx.sdus, it)
+        rlc_dlist_foreach(&ctx->rx.sdus, it)
         {
                 sdu = rlc_sdu_from_it(it);
 
@@ -140,7 +340,7 @@ static void alarm_reassembly(struct rlc_timer *timer, struct rlc_context *ctx)
                         break;
                 }
 
-                it = rlc_list_it_pop(it, NULL);
+                it = rlc_dlist_it_pop(it, NULL);
 
                 if (sdu->state == RLC_DONE) {
                         deliver_sdu(ctx, sdu);
@@ -150,44 +350,22 @@ static void alarm_reassembly(struct rlc_timer *timer, struct rlc_context *ctx)
         }
 
         /* If there are any more SDUs which are awaiting more bytes, restart */
-        if (should_restart_reassembly(ctx)) {
+        if (should_restart_reassembly(ctx, rlc_window_base(&ctx->rx.win))) {
                 ctx->rx.next_status_trigger = ctx->rx.next_highest;
 
                 rlc_timer_start(timer, ctx->conf->time_reassembly_us);
         }
 }
 
-static uint32_t lowest_sn_not_recv(struct rlc_context *ctx)
-{
-        uint32_t next;
-        struct rlc_sdu *cur;
-        rlc_list_it it;
-
-        next = rlc_window_base(&ctx->rx.win);
-
-        rlc_list_foreach(&ctx->rx.sdus, it)
-        {
-                cur = rlc_sdu_from_it(it);
-
-                if (cur->sn != next || cur->state != RLC_DONE) {
-                        return next;
-                }
-
-                next += 1;
-        }
-
-        return ctx->rx.next_highest;
-}
-
 static void deliver_ready(struct rlc_context *ctx)
 {
         struct rlc_sdu *sdu;
         uint32_t next;
-        rlc_list_it it;
+        rlc_dlist_it it;
 
         next = rlc_window_base(&ctx->rx.win);
 
-        rlc_list_foreach(&ctx->rx.sdus, it)
+        rlc_dlist_foreach(&ctx->rx.sdus, it)
         {
                 sdu = rlc_sdu_from_it(it);
 
@@ -199,7 +377,7 @@ static void deliver_ready(struct rlc_context *ctx)
                         break;
                 }
 
-                it = rlc_list_it_pop(it, NULL);
+                it = rlc_dlist_it_pop(it, NULL);
 
                 deliver_sdu(ctx, sdu);
                 next += 1;
@@ -230,10 +408,38 @@ void rlc_rx_reset(struct rlc_context *ctx)
 
         ctx->rx.next_highest = 0;
         ctx->rx.next_status_trigger = 0;
+        ctx->rx.highest_status = 0;
 
         (void)rlc_timer_stop(&ctx->rx.t_reassembly);
 }
 
+void rlc_rx_budget_init(struct rlc_rx_budget *budget, size_t limit_bytes)
+{
+        budget->limit_bytes = limit_bytes;
+        budget->used_bytes = 0;
+}
+
+rlc_errno rlc_rx_budget_attach(struct rlc_context *ctx,
+                               struct rlc_rx_budget *budget)
+{
+        rlc_errno status;
+
+        rlc_lock_acquire(&ctx->lock);
+
+        /* SDUs are taken off whichever budget is attached when they are
+         * freed, so it may only change while there are none */
+        if (rlc_atomic_load(&ctx->mem.kind[RLC_MEM_RX_SDU].count) != 0) {
+                status = -EBUSY;
+        } else {
+                ctx->rx.budget = budget;
+                status = 0;
+        }
+
+        rlc_lock_release(&ctx->lock);
+
+        return status;
+}
+
 rlc_errno rlc_rx_deinit(struct rlc_context *ctx)
 {
         rlc_sdu_queue_clear(&ctx->rx.sdus);
@@ -248,9 +454,14 @@ void rlc_rx_submit(struct rlc_context *ctx, gabs_pbuf buf)
         struct rlc_pdu pdu;
         struct rlc_seg segment;
         struct rlc_sdu *sdu;
+        bool am_data;
+
+        am_data = false;
 
         rlc_lock_acquire(&ctx->lock);
 
+        rlc_capture_pbuf(ctx, RLC_CAPTURE_RX, buf);
+
         status = rlc_pdu_decode(ctx, &pdu, &buf);
         if (status != 0) {
                 gabs_log_errf(ctx->logger, "Decode failed: %" RLC_PRI_ERRNO,
@@ -267,26 +478,39 @@ void rlc_rx_submit(struct rlc_context *ctx, gabs_pbuf buf)
         if (pdu.flags.is_status) {
                 rlc_arq_rx_status(ctx, &pdu, &buf);
 
+                /* NACKs may have marked SDUs for retransmission, while a
+                 * status PDU that only acknowledges leaves nothing to send */
+                if (rlc_arq_tx_pending(ctx) || ctx->tx.bs.retx_bytes > 0 ||
+                    ctx->tx.bs.new_bytes > 0) {
+                        rlc_backend_tx_request(ctx);
+                }
+
                 goto exit;
         }
 
-        if (ctx->conf->type == RLC_AM && pdu.flags.polled) {
-                rlc_arq_rx_register(ctx, &pdu);
-        }
+        /* Polls are handled after the state variables have been updated,
+         * even if the PDU itself is discarded */
+        am_data = ctx->conf->type == RLC_AM;
 
         sdu = rlc_sdu_queue_get(&ctx->rx.sdus, pdu.sn);
 
-        if (sdu == NULL) {
-                if (!rlc_window_has(&ctx->rx.win, pdu.sn)) {
-                        gabs_log_wrnf(ctx->logger,
-                                      "RX; SN %" PRIu32
-                                      " outside RX window (%" PRIu32
-                                      "->%" PRIu32 "), dropping",
-                                      pdu.sn, rlc_window_base(&ctx->rx.win),
-                                      rlc_window_end(&ctx->rx.win));
-                        goto exit;
-                }
+        if (sdu == NULL && !rlc_window_has(&ctx->rx.win, pdu.sn)) {
+                gabs_log_wrnf(ctx->logger,
+                              "RX; SN %" PRIu32 " outside RX window (%" PRIu32
+                              "->%" PRIu32 "), dropping",
+                              pdu.sn, rlc_window_base(&ctx->rx.win),
+                              rlc_window_end(&ctx->rx.win));
+                goto exit;
+        }
 
+        if ((sdu == NULL || sdu->state == RLC_READY) &&
+            !budget_admit(ctx, sdu, pdu.sn,
+                          gabs_pbuf_size(buf) +
+                                  (sdu == NULL ? sizeof(*sdu) : 0))) {
+                goto exit;
+        }
+
+        if (sdu == NULL) {
                 sdu = rlc_sdu_alloc(ctx, false);
                 if (sdu == NULL) {
                         gabs_log_errf(ctx->logger,
@@ -298,6 +522,7 @@ void rlc_rx_submit(struct rlc_context *ctx, gabs_pbuf buf)
 
                 sdu->state = RLC_READY;
                 sdu->sn = pdu.sn;
+                sdu->rx.first_us = rlc_clock_now_us(ctx);
 
                 rlc_sdu_queue_insert(&ctx->rx.sdus, sdu);
         }
@@ -310,15 +535,14 @@ void rlc_rx_submit(struct rlc_context *ctx, gabs_pbuf buf)
                 goto exit;
         }
 
-        gabs_log_dbgf(ctx->logger,
-                      "RX; SN: %" PRIu32 ", RANGE: %" PRIu32 "->%zu", pdu.sn,
-                      pdu.seg_offset, pdu.seg_offset + gabs_pbuf_size(buf));
-
         segment = (struct rlc_seg){
                 .start = pdu.seg_offset,
                 .end = pdu.seg_offset + (uint32_t)gabs_pbuf_size(buf),
         };
 
+        rlc_trace(ctx, RLC_TRACE_RX_PDU, pdu.sn, segment.start, segment.end,
+                  rlc_trace_pdu_flags(&pdu), 0);
+
         status = rlc_seg_buf_insert(&sdu->rx.buffer, &buf, segment,
                                     ctx->alloc_misc, ctx->alloc_buf);
         if (status != 0) {
@@ -328,6 +552,8 @@ void rlc_rx_submit(struct rlc_context *ctx, gabs_pbuf buf)
                 goto exit;
         }
 
+        rlc_mem_sdu_sync(sdu);
+
         if (pdu.flags.is_last) {
                 sdu->rx.last_received = 1;
         }
@@ -336,18 +562,30 @@ void rlc_rx_submit(struct rlc_context *ctx, gabs_pbuf buf)
                 ctx->rx.next_highest = sdu->sn + 1;
         }
 
-        rlc_log_rx_sdu(ctx->logger, sdu);
-        rlc_log_rx_window(ctx);
-
         if (rlc_sdu_is_rx_done(sdu)) {
-                gabs_log_inff(ctx->logger, "RX; SN: %" PRIu32 " completed",
-                              sdu->sn);
+                sdu->rx.done_us = rlc_clock_now_us(ctx);
+
+                rlc_trace(ctx, RLC_TRACE_RX_SDU, sdu->sn, 0,
+                          gabs_pbuf_size(sdu->rx.buffer.buf), 0, 0);
 
                 /* In acknowledged mode, we must wait until after receiving
                  * the status before deallocating. */
                 if (ctx->conf->type == RLC_AM) {
                         sdu->state = RLC_DONE;
-                        lowest = lowest_sn_not_recv(ctx);
+                        lowest = lowest_sn_not_recv(
+                                ctx, rlc_window_base(&ctx->rx.win));
+
+                        if (sdu->sn == ctx->rx.highest_status) {
+                                ctx->rx.highest_status =
+                                        lowest_sn_not_recv(ctx, sdu->sn);
+                        }
+
+                        /* The SDU at the start of the window is delivered
+                         * in order below */
+                        if (ctx->conf->deliver_out_of_order &&
+                            sdu->sn != rlc_window_base(&ctx->rx.win)) {
+                                deliver_early(ctx, sdu);
+                        }
 
                         deliver_ready(ctx);
 
@@ -383,8 +621,18 @@ void rlc_rx_submit(struct rlc_context *ctx, gabs_pbuf buf)
                 }
         }
 exit:
-        rlc_backend_tx_request(ctx);
+        if (am_data) {
+                rlc_arq_rx_register(ctx, &pdu);
+        }
+
+        /* Data PDUs never make new data available for transmission, so the
+         * lower layer only needs to be notified of a due status PDU. */
+        if (rlc_arq_tx_pending(ctx)) {
+                rlc_backend_tx_request(ctx);
+        }
+
         gabs_pbuf_decref(buf);
+        rlc_mem_peak_update(ctx);
 
         rlc_lock_release(&ctx->lock);
         rlc_sched_yield(&ctx->sched);
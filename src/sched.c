@@ -3,9 +3,9 @@
 
 #include "common.h"
 
-static struct rlc_sched_item *from_it(rlc_list_it it)
+static struct rlc_sched_item *from_it(rlc_dlist_it it)
 {
-        return rlc_list_it_item(it, struct rlc_sched_item, list_node);
+        return rlc_dlist_it_item(it, struct rlc_sched_item, list_node);
 }
 
 static void item_dealloc(struct rlc_sched_item *item)
@@ -17,7 +17,7 @@ static void item_dealloc(struct rlc_sched_item *item)
 
 rlc_errno rlc_sched_init(struct rlc_sched *sched)
 {
-        rlc_list_init(&sched->queue);
+        rlc_dlist_init(&sched->queue);
         return gabs_mutex_init(&sched->lock);
 }
 
@@ -29,31 +29,27 @@ rlc_errno rlc_sched_deinit(struct rlc_sched *sched)
 void rlc_sched_reset(struct rlc_sched *sched)
 {
         struct rlc_sched_item *item;
-        rlc_list_it it;
+        rlc_dlist_it it;
 
         rlc_lock_acquire(&sched->lock);
 
-        rlc_list_foreach(&sched->queue, it)
+        rlc_dlist_foreach(&sched->queue, it)
         {
                 item = from_it(it);
-                it = rlc_list_it_pop(it, NULL);
+                it = rlc_dlist_it_pop(it, NULL);
 
                 item_dealloc(item);
         }
 
-        rlc_list_init(&sched->queue);
+        rlc_dlist_init(&sched->queue);
         rlc_lock_release(&sched->lock);
 }
 
 void rlc_sched_put(struct rlc_sched *sched, struct rlc_sched_item *item)
 {
-        rlc_list_it it;
-
         rlc_lock_acquire(&sched->lock);
 
-        rlc_list_foreach(&sched->queue, it){}
-
-        (void)rlc_list_it_put_back(it, &item->list_node);
+        rlc_dlist_push_back(&sched->queue, &item->list_node);
 
         rlc_lock_release(&sched->lock);
 }
@@ -61,20 +57,20 @@ void rlc_sched_put(struct rlc_sched *sched, struct rlc_sched_item *item)
 void rlc_sched_yield(struct rlc_sched *sched)
 {
         struct rlc_sched_item *item;
-        rlc_list_it it;
+        rlc_dlist_it it;
 
         rlc_lock_acquire(&sched->lock);
 
         for (;;) {
                 /* Always get head, as we don't want to depend on iteration
                  * when multiple threads may remove from the queue. */
-                it = rlc_list_it_init(&sched->queue);
-                if (rlc_list_it_node(it) == NULL) {
+                it = rlc_dlist_it_init(&sched->queue);
+                if (rlc_dlist_it_eoi(it)) {
                         break;
                 }
 
                 item = from_it(it);
-                (void)rlc_list_it_pop(it, NULL);
+                rlc_dlist_remove(&sched->queue, &item->list_node);
 
                 rlc_lock_release(&sched->lock);
 
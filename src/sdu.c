@@ -7,6 +7,7 @@
 
 #include "common.h"
 #include "log.h"
+#include "mem.h"
 
 struct rlc_sdu *rlc_sdu_alloc(struct rlc_context *ctx, bool is_tx)
 {
@@ -28,69 +29,69 @@ struct rlc_sdu *rlc_sdu_alloc(struct rlc_context *ctx, bool is_tx)
 
 void rlc_sdu_incref(struct rlc_sdu *sdu)
 {
-        sdu->refcount++;
+        /* A reference is already held, so nothing needs to be ordered */
+        (void)rlc_atomic_add(&sdu->refcount, 1);
+}
+
+static void sdu_free(struct rlc_sdu *sdu)
+{
+        rlc_mem_sdu_release(sdu);
+
+        if (sdu->is_tx) {
+                gabs_pbuf_decref(sdu->tx.buffer);
+                rlc_seg_list_clear(&sdu->tx.unsent, sdu->ctx->alloc_misc);
+        } else {
+                rlc_seg_buf_destroy(&sdu->rx.buffer, sdu->ctx->alloc_misc);
+        }
+
+        rlc_dealloc(sdu->ctx, sdu);
 }
 
 void rlc_sdu_decref(struct rlc_sdu *sdu)
 {
-        if (--sdu->refcount == 0) {
-                if (sdu->is_tx) {
-                        gabs_pbuf_decref(sdu->tx.buffer);
-                        rlc_seg_list_clear(&sdu->tx.unsent,
-                                           sdu->ctx->alloc_misc);
-                } else {
-                        rlc_seg_buf_destroy(&sdu->rx.buffer,
-                                            sdu->ctx->alloc_misc);
-                }
+        /* No other thread can take a reference without holding one, so the
+         * only reference is dropped without a read-modify-write. The load
+         * pairs with the decrements of the other holders, as the one below
+         * does. */
+        if (rlc_atomic_load_acquire(&sdu->refcount) == 1) {
+                sdu_free(sdu);
+                return;
+        }
 
-                rlc_dealloc(sdu->ctx, sdu);
+        if (rlc_atomic_sub_acq_rel(&sdu->refcount, 1) == 1) {
+                sdu_free(sdu);
         }
 }
 
 void rlc_sdu_queue_insert(rlc_sdu_queue *q, struct rlc_sdu *sdu)
 {
-        struct rlc_sdu *cur;
-        rlc_list_it it;
+        rlc_dlist_node *node;
 
-        rlc_list_foreach(q, it)
-        {
-                cur = rlc_sdu_from_it(it);
-
-                if (sdu->sn <= cur->sn) {
+        /* SDUs are mostly queued with a higher SN than any before them, so
+         * the place is looked for from the back */
+        for (node = q->tail; node != NULL; node = node->prev) {
+                if (rlc_sdu_from_node(node)->sn < sdu->sn) {
                         break;
                 }
         }
 
-        (void)rlc_list_it_put_front(it, &sdu->list_node);
+        rlc_dlist_insert_after(q, node, &sdu->list_node);
 }
 
 void rlc_sdu_queue_remove(rlc_sdu_queue *q, struct rlc_sdu *sdu)
 {
-        struct rlc_sdu *cur;
-        rlc_list_it it;
-
-        rlc_list_foreach(q, it)
-        {
-                cur = rlc_sdu_from_it(it);
-
-                if (cur == sdu) {
-                        (void)rlc_list_it_pop(it, NULL);
-                        return;
-                }
-        }
-
-        rlc_assert(0);
+        rlc_dlist_remove(q, &sdu->list_node);
 }
 
 void rlc_sdu_queue_clear(rlc_sdu_queue *q)
 {
-        rlc_list_it it;
+        rlc_dlist_it it;
         struct rlc_sdu *sdu;
 
-        rlc_list_foreach(q, it)
+        rlc_dlist_foreach(q, it)
         {
                 sdu = rlc_sdu_from_it(it);
-                it = rlc_list_it_pop(it, NULL);
+                it = rlc_dlist_it_pop(it, NULL);
 
                 rlc_sdu_decref(sdu);
         }
@@ -99,9 +100,9 @@ void rlc_sdu_queue_clear(rlc_sdu_queue *q)
 struct rlc_sdu *rlc_sdu_queue_get(rlc_sdu_queue *q, uint32_t sn)
 {
         struct rlc_sdu *sdu;
-        rlc_list_it it;
+        rlc_dlist_it it;
 
-        rlc_list_foreach(q, it)
+        rlc_dlist_foreach(q, it)
         {
                 sdu = rlc_sdu_from_it(it);
 
@@ -11,11 +11,11 @@ static size_t seg_byte_offset(struct rlc_seg_buf *seg_buf, size_t start)
 {
         struct rlc_seg_item *cur;
         size_t ret;
-        rlc_list_it it;
+        rlc_dlist_it it;
 
         ret = 0;
 
-        rlc_list_foreach(&seg_buf->segments, it)
+        rlc_dlist_foreach(&seg_buf->segments, it)
         {
                 cur = rlc_seg_item_from_it(it);
 
@@ -21,7 +21,7 @@ rlc_errno rlc_seg_list_insert(rlc_seg_list *list, struct rlc_seg *segptr,
         struct rlc_seg_item *left;
         struct rlc_seg_item *right;
         struct rlc_seg seg;
-        rlc_list_it it;
+        rlc_dlist_it it;
         bool overlap_left;
         bool overlap_right;
 
@@ -30,10 +30,10 @@ rlc_errno rlc_seg_list_insert(rlc_seg_list *list, struct rlc_seg *segptr,
 
         seg = *segptr;
 
-        rlc_list_foreach(list, it)
+        rlc_dlist_foreach(list, it)
         {
                 left = rlc_seg_item_from_it(it);
-                right = rlc_seg_item_from_it(rlc_list_it_next(it));
+                right = rlc_seg_item_from_it(rlc_dlist_it_next(it));
 
                 overlap_left = seg_overlap(&left->seg, &seg);
                 overlap_right = right && seg_overlap(&seg, &right->seg);
@@ -100,10 +100,10 @@ rlc_errno rlc_seg_list_insert(rlc_seg_list *list, struct rlc_seg *segptr,
                  * meaning one can be deleted. In this case, we delete the right
                  * one */
                 if (slot != NULL) {
-                        it = rlc_list_it_next(it);
-                        rlc_assert(!rlc_list_it_eoi(it));
+                        it = rlc_dlist_it_next(it);
+                        rlc_assert(!rlc_dlist_it_eoi(it));
 
-                        it = rlc_list_it_pop(it, NULL);
+                        it = rlc_dlist_it_pop(it, NULL);
                         (void)gabs_dealloc(allocator, slot);
                 }
 
@@ -115,7 +115,7 @@ rlc_errno rlc_seg_list_insert(rlc_seg_list *list, struct rlc_seg *segptr,
                 }
 
                 slot->seg = seg;
-                it = rlc_list_it_put_front(it, &slot->list_node);
+                it = rlc_dlist_it_put_front(it, &slot->list_node);
         }
 
         segptr->start = slot->seg.end;
@@ -143,31 +143,29 @@ rlc_errno rlc_seg_list_insert_all(rlc_seg_list *list, struct rlc_seg seg,
 void rlc_seg_list_clear_until_last(rlc_seg_list *list,
                                    const gabs_allocator_h *allocator)
 {
-        rlc_list_it it;
+        rlc_dlist_it it;
         struct rlc_seg_item *item;
 
-        it = rlc_list_it_init(list);
-
-        for (;;) {
-                if (rlc_list_it_eoi(rlc_list_it_next(it))) {
-                        break;
-                }
+        it = rlc_dlist_it_init(list);
 
+        while (!rlc_dlist_it_eoi(it) && rlc_dlist_it_node(it)->next != NULL) {
                 item = rlc_seg_item_from_it(it);
-                it = rlc_list_it_pop(it, NULL);
+
+                /* Popping leaves the iterator at the following item */
+                it = rlc_dlist_it_next(rlc_dlist_it_pop(it, NULL));
                 (void)gabs_dealloc(allocator, item);
         }
 }
 
 void rlc_seg_list_clear(rlc_seg_list *list, const gabs_allocator_h *allocator)
 {
-        rlc_list_it it;
+        rlc_dlist_it it;
         struct rlc_seg_item *item;
 
-        rlc_list_foreach(list, it)
+        rlc_dlist_foreach(list, it)
         {
                 item = rlc_seg_item_from_it(it);
-                it = rlc_list_it_pop(it, NULL);
+                it = rlc_dlist_it_pop(it, NULL);
 
                 (void)gabs_dealloc(allocator, item);
         }
@@ -3,6 +3,7 @@
 #include <rlc/rlc.h>
 
 #include "common.h"
+#include "vclock.h"
 
 static void timer_alarm(gabs_timer gtimer, void *user_data)
 {
@@ -26,11 +27,50 @@ static void timer_alarm(gabs_timer gtimer, void *user_data)
         rlc_sched_yield(&ctx->sched);
 }
 
+void rlc_timer_fire(struct rlc_timer *timer)
+{
+        struct rlc_context *ctx = timer->ctx;
+
+        rlc_lock_acquire(&ctx->lock);
+
+        /* Same as above, the timer may have been stopped or rearmed between
+         * being found due and taking the lock */
+        if (timer->vstate != RLC_TIMER_FIRING) {
+                rlc_lock_release(&ctx->lock);
+                return;
+        }
+
+        rlc_assert(timer->cb != NULL);
+        timer->cb(timer, ctx);
+
+        /* Still active during the callback, as for platform timers */
+        if (timer->vstate == RLC_TIMER_FIRING) {
+                timer->vstate = RLC_TIMER_IDLE;
+        }
+
+        rlc_lock_release(&ctx->lock);
+        rlc_sched_yield(&ctx->sched);
+}
+
+/* Virtual clock of @p timer, or NULL if it runs on the platform. Timers that
+ * were never installed have no context. */
+static struct rlc_vclock *timer_vclock(struct rlc_timer *timer)
+{
+        if (timer->ctx == NULL) {
+                return NULL;
+        }
+
+        return timer->ctx->vclock;
+}
+
 rlc_errno rlc_timer_install(struct rlc_timer *timer, rlc_timer_cb cb,
                             struct rlc_context *ctx)
 {
         timer->cb = cb;
         timer->ctx = ctx;
+        timer->vstate = RLC_TIMER_IDLE;
+        rlc_dlist_node_init(&timer->vnode);
+
         timer->gtimer = gabs_timer_install(&ctx->timer_ctx, timer_alarm, timer);
 
         if (!gabs_timer_okay(timer->gtimer)) {
@@ -39,3 +79,63 @@ rlc_errno rlc_timer_install(struct rlc_timer *timer, rlc_timer_cb cb,
 
         return 0;
 }
+
+rlc_errno rlc_timer_uninstall(struct rlc_timer *timer)
+{
+        struct rlc_vclock *clock;
+
+        clock = timer_vclock(timer);
+        if (clock != NULL) {
+                rlc_vclock_disarm(clock, timer);
+        }
+
+        return gabs_timer_uninstall(timer->gtimer);
+}
+
+rlc_errno rlc_timer_start(struct rlc_timer *timer, uint32_t delay_us)
+{
+        struct rlc_vclock *clock;
+
+        clock = timer_vclock(timer);
+        if (clock != NULL) {
+                rlc_vclock_arm(clock, timer, delay_us);
+                return 0;
+        }
+
+        return gabs_timer_start(timer->gtimer, delay_us);
+}
+
+rlc_errno rlc_timer_restart(struct rlc_timer *timer, uint32_t delay_us)
+{
+        struct rlc_vclock *clock;
+
+        clock = timer_vclock(timer);
+        if (clock != NULL) {
+                rlc_vclock_arm(clock, timer, delay_us);
+                return 0;
+        }
+
+        return gabs_timer_restart(timer->gtimer, delay_us);
+}
+
+rlc_errno rlc_timer_stop(struct rlc_timer *timer)
+{
+        struct rlc_vclock *clock;
+
+        clock = timer_vclock(timer);
+        if (clock != NULL) {
+                rlc_vclock_disarm(clock, timer);
+                return 0;
+        }
+
+        return gabs_timer_stop(timer->gtimer);
+}
+
+bool rlc_timer_active(struct rlc_timer *timer)
+{
+        if (timer_vclock(timer) != NULL) {
+                return timer->vstate != RLC_TIMER_IDLE;
+        }
+
+        return gabs_timer_active(timer->gtimer);
+}
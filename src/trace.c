@@ -0,0 +1,91 @@
+
+#include <errno.h>
+
+#include <rlc/rlc.h>
+#include <rlc/trace.h>
+
+#include "clock.h"
+#include "common.h"
+#include "trace.h"
+
+rlc_errno rlc_trace_init(struct rlc_trace *trace,
+                         struct rlc_trace_record *records, size_t count)
+{
+        if (count == 0 || (count & (count - 1)) != 0 || count > UINT32_MAX) {
+                return -EINVAL;
+        }
+
+        trace->records = records;
+        trace->mask = count - 1;
+        trace->head = 0;
+        trace->tail = 0;
+
+        return 0;
+}
+
+void rlc_trace_attach(struct rlc_context *ctx, struct rlc_trace *trace)
+{
+        rlc_lock_acquire(&ctx->lock);
+        ctx->trace = trace;
+        rlc_lock_release(&ctx->lock);
+}
+
+void rlc_trace_put_(struct rlc_context *ctx, enum rlc_trace_event event,
+                    uint32_t sn, uint32_t so_start, uint32_t so_end,
+                    uint32_t arg0, uint32_t arg1)
+{
+        struct rlc_trace *trace;
+        struct rlc_trace_record *record;
+
+        trace = ctx->trace;
+        record = &trace->records[trace->head & trace->mask];
+
+        record->time_us = rlc_clock_now_us(ctx);
+        record->sn = sn;
+        record->so_start = so_start;
+        record->so_end = so_end;
+        record->arg[0] = arg0;
+        record->arg[1] = arg1;
+        record->event = event;
+        record->reserved = 0;
+
+        trace->head++;
+}
+
+size_t rlc_trace_read(struct rlc_context *ctx, struct rlc_trace_record *out,
+                      size_t max, uint64_t *lost)
+{
+        struct rlc_trace *trace;
+        uint64_t count;
+        size_t i;
+
+        *lost = 0;
+
+        rlc_lock_acquire(&ctx->lock);
+
+        trace = ctx->trace;
+        if (trace == NULL) {
+                rlc_lock_release(&ctx->lock);
+                return 0;
+        }
+
+        /* Skip records that have been overwritten */
+        count = trace->head - trace->tail;
+        if (count > (uint64_t)trace->mask + 1) {
+                *lost = count - trace->mask - 1;
+                trace->tail += *lost;
+                count = trace->mask + 1;
+        }
+
+        count = rlc_min(count, max);
+
+        for (i = 0; i < count; i++) {
+                out[i] = trace->records[(trace->tail + i) & trace->mask];
+        }
+
+        trace->tail += count;
+
+        rlc_lock_release(&ctx->lock);
+
+        return count;
+}
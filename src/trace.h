@@ -0,0 +1,38 @@
+
+#ifndef RLC_TRACE_INTERNAL_H__
+#define RLC_TRACE_INTERNAL_H__
+
+#include <rlc/rlc.h>
+#include <rlc/trace.h>
+#include <rlc/pdu.h>
+
+RLC_BEGIN_DECL
+
+void rlc_trace_put_(struct rlc_context *ctx, enum rlc_trace_event event,
+                    uint32_t sn, uint32_t so_start, uint32_t so_end,
+                    uint32_t arg0, uint32_t arg1);
+
+/**
+ * @brief Record @p event, if tracing is enabled for @p ctx. Must be called
+ * with the context lock held.
+ */
+static inline void rlc_trace(struct rlc_context *ctx,
+                             enum rlc_trace_event event, uint32_t sn,
+                             uint32_t so_start, uint32_t so_end, uint32_t arg0,
+                             uint32_t arg1)
+{
+        if (ctx->trace != NULL) {
+                rlc_trace_put_(ctx, event, sn, so_start, so_end, arg0, arg1);
+        }
+}
+
+static inline uint32_t rlc_trace_pdu_flags(const struct rlc_pdu *pdu)
+{
+        return (pdu->flags.is_first ? RLC_TRACE_FLAG_FIRST : 0) |
+               (pdu->flags.is_last ? RLC_TRACE_FLAG_LAST : 0) |
+               (pdu->flags.polled ? RLC_TRACE_FLAG_POLLED : 0);
+}
+
+RLC_END_DECL
+
+#endif /* RLC_TRACE_INTERNAL_H__ */
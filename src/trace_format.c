@@ -0,0 +1,109 @@
+
+#include <stdio.h>
+#include <inttypes.h>
+
+#include <rlc/trace.h>
+
+/* Kept free of any context or platform dependency, so that it can be built
+ * into the offline decoder as is. */
+
+static const char *const event_names[RLC_TRACE_EVENT_COUNT] = {
+        [RLC_TRACE_TX_SDU] = "TX_SDU",
+        [RLC_TRACE_TX_AVAIL] = "TX_AVAIL",
+        [RLC_TRACE_TX_PDU] = "TX_PDU",
+        [RLC_TRACE_TX_POLL] = "TX_POLL",
+        [RLC_TRACE_TX_RETX] = "TX_RETX",
+        [RLC_TRACE_TX_STATUS] = "TX_STATUS",
+        [RLC_TRACE_TX_STATUS_SUPPRESSED] = "TX_STATUS_SUPPRESSED",
+        [RLC_TRACE_TX_NACK] = "TX_NACK",
+        [RLC_TRACE_TX_DONE] = "TX_DONE",
+        [RLC_TRACE_TX_FAIL] = "TX_FAIL",
+        [RLC_TRACE_TX_DISCARD] = "TX_DISCARD",
+        [RLC_TRACE_RX_PDU] = "RX_PDU",
+        [RLC_TRACE_RX_STATUS] = "RX_STATUS",
+        [RLC_TRACE_RX_NACK] = "RX_NACK",
+        [RLC_TRACE_RX_SDU] = "RX_SDU",
+        [RLC_TRACE_RX_DELIVER] = "RX_DELIVER",
+        [RLC_TRACE_RX_DROP] = "RX_DROP",
+};
+
+const char *rlc_trace_event_name(uint16_t event)
+{
+        if (event >= RLC_TRACE_EVENT_COUNT) {
+                return NULL;
+        }
+
+        return event_names[event];
+}
+
+static int format_flags(uint32_t flags, char *buf, size_t size)
+{
+        return snprintf(buf, size, "%s%s%s",
+                        (flags & RLC_TRACE_FLAG_FIRST) ? " first" : "",
+                        (flags & RLC_TRACE_FLAG_LAST) ? " last" : "",
+                        (flags & RLC_TRACE_FLAG_POLLED) ? " polled" : "");
+}
+
+int rlc_trace_format(const struct rlc_trace_record *r, char *buf, size_t size)
+{
+        const char *name;
+        char flags[32];
+
+        name = rlc_trace_event_name(r->event);
+        if (name == NULL) {
+                return snprintf(buf, size, "%" PRIu64 " UNKNOWN(%u)",
+                                r->time_us, (unsigned int)r->event);
+        }
+
+        switch (r->event) {
+        case RLC_TRACE_TX_AVAIL:
+                return snprintf(buf, size,
+                                "%" PRIu64 " %s size %" PRIu32
+                                ", unused %" PRIu32,
+                                r->time_us, name, r->arg[0], r->arg[1]);
+        case RLC_TRACE_TX_PDU:
+        case RLC_TRACE_RX_PDU:
+                (void)format_flags(r->arg[0], flags, sizeof(flags));
+
+                return snprintf(buf, size,
+                                "%" PRIu64 " %s SN %" PRIu32 " SO %" PRIu32
+                                "->%" PRIu32 "%s",
+                                r->time_us, name, r->sn, r->so_start,
+                                r->so_end, flags);
+        case RLC_TRACE_TX_SDU:
+        case RLC_TRACE_RX_SDU:
+                return snprintf(buf, size,
+                                "%" PRIu64 " %s SN %" PRIu32 " size %" PRIu32,
+                                r->time_us, name, r->sn, r->so_end);
+        case RLC_TRACE_TX_RETX:
+                return snprintf(buf, size,
+                                "%" PRIu64 " %s SN %" PRIu32 " SO %" PRIu32
+                                "->%" PRIu32 " RETX_COUNT %" PRIu32,
+                                r->time_us, name, r->sn, r->so_start,
+                                r->so_end, r->arg[0]);
+        case RLC_TRACE_TX_NACK:
+        case RLC_TRACE_RX_NACK:
+                return snprintf(buf, size,
+                                "%" PRIu64 " %s NACK_SN %" PRIu32
+                                " SO %" PRIu32 "->%" PRIu32
+                                " NACK_range %" PRIu32,
+                                r->time_us, name, r->sn, r->so_start,
+                                r->so_end, r->arg[0]);
+        case RLC_TRACE_TX_STATUS:
+        case RLC_TRACE_RX_STATUS:
+                return snprintf(buf, size,
+                                "%" PRIu64 " %s ACK_SN %" PRIu32
+                                " size %" PRIu32,
+                                r->time_us, name, r->sn, r->arg[0]);
+        case RLC_TRACE_TX_STATUS_SUPPRESSED:
+                return snprintf(buf, size, "%" PRIu64 " %s ACK_SN %" PRIu32,
+                                r->time_us, name, r->sn);
+        case RLC_TRACE_RX_DELIVER:
+                return snprintf(buf, size, "%" PRIu64 " %s SN %" PRIu32 "%s",
+                                r->time_us, name, r->sn,
+                                r->arg[0] ? " out of order" : "");
+        default:
+                return snprintf(buf, size, "%" PRIu64 " %s SN %" PRIu32,
+                                r->time_us, name, r->sn);
+        }
+}
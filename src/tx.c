@@ -8,13 +8,20 @@
 #include <rlc/backend.h>
 
 #include "encode.h"
+#include "aqm.h"
 #include "arq.h"
+#include "buffer_status.h"
+#include "clock.h"
 #include "common.h"
+#include "latency.h"
 #include "log.h"
+#include "mem.h"
+#include "trace.h"
 
 void rlc_tx_init(struct rlc_context *ctx)
 {
         rlc_window_init(&ctx->tx.win, 0, ctx->conf->window_size);
+        ctx->tx.discard_due_us = UINT64_MAX;
 }
 
 void rlc_tx_reset(struct rlc_context *ctx)
@@ -22,6 +29,11 @@ void rlc_tx_reset(struct rlc_context *ctx)
         rlc_sdu_queue_clear(&ctx->tx.sdus);
         rlc_window_init(&ctx->tx.win, 0, ctx->conf->window_size);
         ctx->tx.next_sn = 0;
+        ctx->tx.request_pending = false;
+        ctx->tx.discard_due_us = UINT64_MAX;
+
+        rlc_aqm_reset(ctx);
+        rlc_bs_reset(ctx);
 }
 
 void rlc_tx_deinit(struct rlc_context *ctx)
@@ -29,22 +41,138 @@ void rlc_tx_deinit(struct rlc_context *ctx)
         rlc_sdu_queue_clear(&ctx->tx.sdus);
 }
 
+/* Only an SDU that has not been served can be discarded, as it has not taken
+ * an SN yet */
+static bool discardable(const struct rlc_sdu *sdu)
+{
+        return sdu->tx.sent == 0 && sdu->state == RLC_READY;
+}
+
+static void discard_sdu(struct rlc_context *ctx, struct rlc_sdu *sdu)
+{
+        rlc_bs_sdu_remove(ctx, sdu);
+        rlc_event_tx_discard(ctx, sdu);
+        rlc_sdu_decref(sdu);
+}
+
+/*
+ * @brief Discard SDUs that have waited longer than the discard timer.
+ *
+ * SDUs are queued in the order they arrive, so the first SDU that has not
+ * expired gives the time of the next check. Until then this is a single
+ * comparison, and no timer is needed per SDU. SNs are taken on the first
+ * transmission, so discarding leaves no gap in them.
+ */
+static void discard_expired(struct rlc_context *ctx)
+{
+        struct rlc_sdu *sdu;
+        rlc_dlist_it it;
+        uint64_t timeout;
+        uint64_t now;
+        bool removed;
+
+        timeout = ctx->conf->discard_timer_us;
+        if (timeout == 0) {
+                return;
+        }
+
+        now = rlc_clock_now_us(ctx);
+        if (now < ctx->tx.discard_due_us) {
+                return;
+        }
+
+        ctx->tx.discard_due_us = UINT64_MAX;
+        removed = false;
+
+        rlc_dlist_foreach(&ctx->tx.sdus, it)
+        {
+                sdu = rlc_sdu_from_it(it);
+
+                /* Served SDUs all come before those that are not */
+                if (!discardable(sdu)) {
+                        rlc_assert(!removed);
+                        continue;
+                }
+
+                if (sdu->tx.queued_us + timeout > now) {
+                        ctx->tx.discard_due_us = sdu->tx.queued_us + timeout;
+                        break;
+                }
+
+                it = rlc_dlist_it_pop(it, NULL);
+                discard_sdu(ctx, sdu);
+
+                removed = true;
+        }
+}
+
+/*
+ * @brief Drop the SDU at @p it, which queue management picked as it was about
+ * to be submitted for the first time.
+ *
+ * @return rlc_dlist_it Iterator to continue the TX queue walk with
+ */
+static rlc_dlist_it aqm_drop(struct rlc_context *ctx, rlc_dlist_it it,
+                              struct rlc_sdu *sdu)
+{
+        rlc_latency_add(ctx, RLC_LATENCY_TX_DROP, sdu->tx.queued_us,
+                        rlc_clock_now_us(ctx));
+
+        it = rlc_dlist_it_pop(it, NULL);
+
+        rlc_bs_sdu_remove(ctx, sdu);
+        rlc_event_tx_aqm_drop(ctx, sdu);
+        rlc_sdu_decref(sdu);
+
+        return it;
+}
+
+rlc_errno rlc_tx_discard(struct rlc_context *ctx, struct rlc_sdu *sdu)
+{
+        struct rlc_sdu *cur;
+        rlc_dlist_it it;
+        rlc_errno status;
+
+        rlc_lock_acquire(&ctx->lock);
+
+        status = -ENOENT;
+
+        rlc_dlist_foreach(&ctx->tx.sdus, it)
+        {
+                cur = rlc_sdu_from_it(it);
+
+                if (cur != sdu) {
+                        continue;
+                }
+
+                if (!discardable(sdu)) {
+                        status = -EBUSY;
+                        break;
+                }
+
+                (void)rlc_dlist_it_pop(it, NULL);
+                discard_sdu(ctx, sdu);
+
+                status = 0;
+                break;
+        }
+
+        rlc_lock_release(&ctx->lock);
+        rlc_sched_yield(&ctx->sched);
+
+        return status;
+}
+
 static ptrdiff_t tx_pdu_view(struct rlc_context *ctx, struct rlc_pdu *pdu,
                              struct rlc_sdu *sdu, size_t max_size)
 {
-        gabs_pbuf buf;
         ptrdiff_t ret;
 
         if (pdu->seg_offset + pdu->size > gabs_pbuf_size(sdu->tx.buffer)) {
                 return -ENODATA;
         }
 
-        buf = gabs_pbuf_view(sdu->tx.buffer, pdu->seg_offset, pdu->size,
-                             ctx->alloc_buf);
-        gabs_log_dbgf(ctx->logger, "Sending PDU: size %zu, buffer size: %zu",
-                      pdu->size, gabs_pbuf_size(buf));
-
-        ret = rlc_backend_tx_submit(ctx, pdu, buf);
+        ret = rlc_backend_tx_submit_sdu(ctx, pdu, sdu->tx.buffer);
 
         return ret;
 }
@@ -69,7 +197,7 @@ static bool pdu_size_adjust(const struct rlc_context *ctx, struct rlc_pdu *pdu,
         if (ctx->conf->type == RLC_UM && pdu->flags.is_first) {
                 /* If size plus the header can be fit as is both SN and SO can
                  * be omitted */
-                if (max_size - 1 >= pdu->size) {
+                if (max_size > 0 && max_size - 1 >= pdu->size) {
                         pdu->flags.is_last = 1;
                         return true;
                 }
@@ -78,7 +206,7 @@ static bool pdu_size_adjust(const struct rlc_context *ctx, struct rlc_pdu *pdu,
         hsize = rlc_pdu_header_size(ctx, pdu);
         if (pdu->size + hsize > max_size) {
                 diff = pdu->size + hsize - max_size;
-                if (diff > pdu->size) {
+                if (diff >= pdu->size) {
                         return false;
                 }
 
@@ -88,18 +216,34 @@ static bool pdu_size_adjust(const struct rlc_context *ctx, struct rlc_pdu *pdu,
         return true;
 }
 
-static bool serve_sdu(struct rlc_context *ctx, struct rlc_sdu *sdu,
-                      struct rlc_pdu *pdu, size_t size_avail)
+/* Whether an SDU that has not been served can take TX_Next. Only AM has a TX
+ * window, which is moved by status PDUs. */
+static bool tx_next_in_window(struct rlc_context *ctx)
+{
+        return ctx->conf->type != RLC_AM ||
+               rlc_window_has(&ctx->tx.win, ctx->tx.next_sn);
+}
+
+/*
+ * @brief Set up @p pdu with the next bytes of @p sdu that fit in
+ * @p size_avail and in the build target.
+ *
+ * Nothing is changed for a PDU that is not served, so that the caller may
+ * still decide against it.
+ *
+ * @return bool Whether a PDU fits
+ */
+static bool next_pdu(struct rlc_context *ctx, struct rlc_sdu *sdu,
+                     struct rlc_pdu *pdu, size_t size_avail)
 {
         struct rlc_seg_item *seg_item;
-        rlc_list_it it;
+        rlc_dlist_it it;
 
-        it = rlc_list_it_init(&sdu->tx.unsent);
+        it = rlc_dlist_it_init(&sdu->tx.unsent);
         seg_item = rlc_seg_item_from_it(it);
 
-        rlc_assert(!rlc_list_it_eoi(it));
+        rlc_assert(!rlc_dlist_it_eoi(it));
 
-        pdu->sn = sdu->sn;
         pdu->size = seg_item->seg.end - seg_item->seg.start;
         if (pdu->size == 0) {
                 rlc_assert(ctx->conf->type == RLC_AM);
@@ -115,27 +259,76 @@ static bool serve_sdu(struct rlc_context *ctx, struct rlc_sdu *sdu,
                 return false;
         }
 
+        if (pdu->seg_offset + pdu->size >= seg_item->seg.end &&
+            rlc_dlist_it_eoi(rlc_dlist_it_next(it))) {
+                pdu->flags.is_last = 1;
+        }
+
+        return rlc_backend_tx_fits(ctx, pdu);
+}
+
+/* Mark the bytes of @p pdu, set up by `next_pdu`, as served */
+static void serve_sdu(struct rlc_context *ctx, struct rlc_sdu *sdu,
+                      struct rlc_pdu *pdu)
+{
+        struct rlc_seg_item *seg_item;
+        struct rlc_bs_sdu bs_before;
+        struct rlc_bs_sdu bs_after;
+        struct rlc_seg_item *next_item;
+        rlc_dlist_it it;
+        rlc_dlist_it next;
+
+        it = rlc_dlist_it_init(&sdu->tx.unsent);
+        seg_item = rlc_seg_item_from_it(it);
+        next = rlc_dlist_it_next(it);
+
+        /* SNs are taken in the order SDUs are first submitted, which is the
+         * order they are queued in */
+        if (sdu->tx.sent == 0) {
+                sdu->sn = ctx->tx.next_sn++;
+        }
+
+        pdu->sn = sdu->sn;
+
+        rlc_bs_sdu_get(sdu, &bs_before);
+
         seg_item->seg.start += pdu->size;
         if (seg_item->seg.start >= seg_item->seg.end) {
-                if (rlc_list_it_eoi(rlc_list_it_next(it))) {
-                        /* If last segment, set last flag and go into waiting
-                         * state. The last segment is kept alive until the
-                         * SDU is deallocated, so that it can be used to
+                if (pdu->flags.is_last) {
+                        /* If last segment, go into waiting state. The last
+                         * segment is kept alive until the SDU is
+                         * deallocated, so that it can be used to
                          * distuingish between retransmitted PDUs and
                          * first-time-transmitted PDUs. */
                         sdu->state = RLC_WAIT;
-                        pdu->flags.is_last = 1;
                 } else {
-                        it = rlc_list_it_pop(it, NULL);
+                        it = rlc_dlist_it_pop(it, NULL);
                         rlc_dealloc(ctx, seg_item);
+
+                        /* Only the empty last segment kept alive is left
+                         * after a retransmission, and nothing to serve on
+                         * the next opportunity */
+                        next_item = rlc_seg_item_from_it(next);
+                        if (rlc_dlist_it_eoi(rlc_dlist_it_next(next)) &&
+                            next_item->seg.start == next_item->seg.end) {
+                                sdu->state = RLC_WAIT;
+                        }
                 }
         }
 
-        rlc_arq_tx_pdu_fill(ctx, sdu, pdu);
+        if (sdu->tx.sent == 0) {
+                sdu->tx.sent_us = rlc_clock_now_us(ctx);
+                rlc_latency_add(ctx, RLC_LATENCY_TX_QUEUE, sdu->tx.queued_us,
+                                sdu->tx.sent_us);
+        }
 
-        rlc_log_tx_sdu(ctx->logger, sdu);
+        sdu->tx.sent = rlc_max(sdu->tx.sent, pdu->seg_offset + pdu->size);
 
-        return true;
+        rlc_bs_sdu_get(sdu, &bs_after);
+        rlc_bs_sdu_update(ctx, &bs_before, &bs_after);
+        rlc_mem_sdu_sync(sdu);
+
+        rlc_arq_tx_pdu_fill(ctx, pdu);
 }
 
 size_t rlc_tx_yield(struct rlc_context *ctx, size_t max_size)
@@ -144,11 +337,11 @@ size_t rlc_tx_yield(struct rlc_context *ctx, size_t max_size)
         struct rlc_pdu pdu;
         ptrdiff_t ret;
         size_t size;
-        rlc_list_it it;
+        rlc_dlist_it it;
 
         size = 0;
 
-        rlc_list_foreach(&ctx->tx.sdus, it)
+        rlc_dlist_foreach(&ctx->tx.sdus, it)
         {
                 sdu = rlc_sdu_from_it(it);
 
@@ -156,17 +349,37 @@ size_t rlc_tx_yield(struct rlc_context *ctx, size_t max_size)
                         continue;
                 }
 
+                if (!rlc_backend_tx_room(ctx)) {
+                        break;
+                }
+
+                if (sdu->tx.sent == 0 && !tx_next_in_window(ctx)) {
+                        break;
+                }
+
                 (void)memset(&pdu, 0, sizeof(pdu));
 
-                if (!serve_sdu(ctx, sdu, &pdu, max_size)) {
+                if (!next_pdu(ctx, sdu, &pdu, max_size)) {
+                        /* SDUs are served for the first time in the order
+                         * they are queued, so that their SNs follow it */
+                        if (sdu->tx.sent == 0) {
+                                break;
+                        }
+
+                        continue;
+                }
+
+                /* Once the PDU is known to be written, so that queue
+                 * management sees each SDU once */
+                if (sdu->tx.sent == 0 && rlc_aqm_dequeue(ctx, sdu)) {
+                        it = aqm_drop(ctx, it, sdu);
                         continue;
                 }
 
-                gabs_log_dbgf(ctx->logger,
-                              "TX PDU; SN: %" PRIu32 ", range: %" PRIu32 "->"
-                              "%zu",
-                              pdu.sn, pdu.seg_offset,
-                              pdu.seg_offset + pdu.size);
+                serve_sdu(ctx, sdu, &pdu);
+
+                rlc_trace(ctx, RLC_TRACE_TX_PDU, pdu.sn, pdu.seg_offset,
+                          pdu.seg_offset + pdu.size, rlc_trace_pdu_flags(&pdu), 0);
 
                 ret = tx_pdu_view(ctx, &pdu, sdu, max_size);
                 if (ret <= 0) {
@@ -174,12 +387,15 @@ size_t rlc_tx_yield(struct rlc_context *ctx, size_t max_size)
                                 ctx->logger,
                                 "PDU submit failed: error %" RLC_PRI_ERRNO,
                                 (rlc_errno)ret);
+                        continue;
                 }
 
                 if (ctx->conf->type != RLC_AM && pdu.flags.is_last) {
+                        rlc_bs_sdu_remove(ctx, sdu);
                         rlc_event_tx_done(ctx, sdu);
-                        rlc_sdu_queue_remove(&ctx->tx.sdus, sdu);
-                        rlc_dealloc(ctx, sdu);
+
+                        it = rlc_dlist_it_pop(it, NULL);
+                        rlc_sdu_decref(sdu);
                 }
 
                 size += (size_t)ret;
@@ -193,20 +409,71 @@ size_t rlc_tx_yield(struct rlc_context *ctx, size_t max_size)
         return size;
 }
 
-size_t rlc_tx_avail(struct rlc_context *ctx, size_t size)
+/* Check if there is anything to transmit, either from ARQ or SDUs with
+ * unsent segments. */
+static bool tx_pending(struct rlc_context *ctx)
 {
+        struct rlc_sdu *sdu;
+        rlc_dlist_it it;
+
+        if (rlc_arq_tx_pending(ctx)) {
+                return true;
+        }
+
+        rlc_dlist_foreach(&ctx->tx.sdus, it)
         {
-                rlc_lock_acquire(&ctx->lock);
+                sdu = rlc_sdu_from_it(it);
+
+                /* Every SDU after one that has not been served is waiting
+                 * for the same TX window */
+                if (sdu->state == RLC_READY) {
+                        return sdu->tx.sent > 0 || tx_next_in_window(ctx);
+                }
+        }
+
+        return false;
+}
+
+/* Serve a transmit opportunity of @p size bytes. Must be called with the
+ * lock held. */
+static size_t tx_opportunity(struct rlc_context *ctx, size_t size)
+{
+        size_t avail;
+
+        avail = size;
+
+        /* This is the answer to any outstanding request */
+        ctx->tx.request_pending = false;
 
-                gabs_log_dbgf(ctx->logger, "TX availability for context %p",
-                              ctx);
+        discard_expired(ctx);
 
-                size -= rlc_arq_tx_yield(ctx, size);
-                if (size > 0) {
-                        size -= rlc_tx_yield(ctx, size);
+        size -= rlc_arq_tx_yield(ctx, size);
+        if (size > 0) {
+                size -= rlc_tx_yield(ctx, size);
+        }
+
+        /* Opportunity was not large enough to empty the buffer, so ask for
+         * another one. The caller of `rlc_tx_build` is told instead, so that
+         * nothing is allocated or scheduled for it. */
+        if (tx_pending(ctx)) {
+                if (ctx->tx.build != NULL) {
+                        ctx->tx.build->pending = true;
+                } else {
+                        rlc_backend_tx_request(ctx);
                 }
+        }
+
+        rlc_trace(ctx, RLC_TRACE_TX_AVAIL, 0, 0, 0, avail, size);
+        rlc_mem_peak_update(ctx);
 
-                rlc_log_tx_window(ctx);
+        return size;
+}
+
+size_t rlc_tx_avail(struct rlc_context *ctx, size_t size)
+{
+        {
+                rlc_lock_acquire(&ctx->lock);
+                size = tx_opportunity(ctx, size);
                 rlc_lock_release(&ctx->lock);
         }
 
@@ -215,6 +482,40 @@ size_t rlc_tx_avail(struct rlc_context *ctx, size_t size)
         return size;
 }
 
+size_t rlc_tx_build(struct rlc_context *ctx, uint8_t *dst, size_t grant,
+                    struct rlc_tx_pdu_info *pdus, size_t *pdu_count,
+                    bool *pending)
+{
+        struct rlc_backend_build build;
+
+        build = (struct rlc_backend_build){
+                .dst = dst,
+                .size = grant,
+                .pdus = pdus,
+                .pdu_max = *pdu_count,
+        };
+
+        {
+                rlc_lock_acquire(&ctx->lock);
+
+                ctx->tx.build = &build;
+                (void)tx_opportunity(ctx, grant);
+                ctx->tx.build = NULL;
+
+                rlc_lock_release(&ctx->lock);
+        }
+
+        rlc_sched_yield(&ctx->sched);
+
+        *pdu_count = build.pdu_count;
+
+        if (pending != NULL) {
+                *pending = build.pending;
+        }
+
+        return build.used;
+}
+
 rlc_errno rlc_tx(struct rlc_context *ctx, gabs_pbuf buf,
                  struct rlc_sdu **sdu_out)
 {
@@ -222,14 +523,10 @@ rlc_errno rlc_tx(struct rlc_context *ctx, gabs_pbuf buf,
         struct rlc_sdu *sdu;
         rlc_errno status;
 
-        if (!rlc_window_has(&ctx->tx.win, ctx->tx.next_sn)) {
-                gabs_log_errf(ctx->logger,
-                              "TX_Next outside TX window: TX_Next=%" PRIu32
-                              ", window: %" PRIu32 "->%" PRIu32,
-                              ctx->tx.next_sn, rlc_window_base(&ctx->tx.win),
-                              rlc_window_end(&ctx->tx.win));
-
-                return -ENOSPC;
+        /* An empty SDU has nothing to be served, and would never leave the
+         * queue */
+        if (gabs_pbuf_size(buf) == 0) {
+                return -ENODATA;
         }
 
         sdu = rlc_sdu_alloc(ctx, true);
@@ -239,29 +536,45 @@ rlc_errno rlc_tx(struct rlc_context *ctx, gabs_pbuf buf,
 
         gabs_pbuf_incref(buf);
 
-        sdu->sn = ctx->tx.next_sn++;
         sdu->tx.buffer = buf;
 
         rlc_lock_acquire(&ctx->lock);
 
+        discard_expired(ctx);
+
+        if (rlc_bs_queue_full(ctx, gabs_pbuf_size(buf))) {
+                rlc_lock_release(&ctx->lock);
+                rlc_sdu_decref(sdu);
+
+                return -ENOBUFS;
+        }
+
         seg.start = 0;
         seg.end = gabs_pbuf_size(sdu->tx.buffer);
 
-        gabs_log_inff(ctx->logger,
-                      "TX; Queueing SDU %" PRIu32 ", RANGE: %" PRIu32
-                      "->%" PRIu32,
-                      sdu->sn, seg.start, seg.end);
-
         status = rlc_seg_list_insert_all(&sdu->tx.unsent, seg, ctx->alloc_misc);
         if (status != 0) {
                 rlc_lock_release(&ctx->lock);
                 rlc_sdu_decref(sdu);
-                gabs_pbuf_decref(buf);
 
                 return status;
         }
 
-        rlc_sdu_queue_insert(&ctx->tx.sdus, sdu);
+        sdu->sn = RLC_SN_NONE;
+        sdu->tx.queued_us = rlc_clock_now_us(ctx);
+
+        if (ctx->conf->discard_timer_us != 0 &&
+            ctx->tx.discard_due_us == UINT64_MAX) {
+                ctx->tx.discard_due_us =
+                        sdu->tx.queued_us + ctx->conf->discard_timer_us;
+        }
+
+        rlc_trace(ctx, RLC_TRACE_TX_SDU, sdu->sn, seg.start, seg.end, 0, 0);
+
+        /* Behind every SDU that has taken an SN */
+        rlc_dlist_push_back(&ctx->tx.sdus, &sdu->list_node);
+        rlc_bs_sdu_add(ctx, sdu);
+        rlc_mem_sdu_sync(sdu);
 
         if (sdu_out != NULL) {
                 *sdu_out = sdu;
@@ -269,9 +582,12 @@ rlc_errno rlc_tx(struct rlc_context *ctx, gabs_pbuf buf,
                 rlc_sdu_incref(sdu);
         }
 
-        rlc_lock_release(&ctx->lock);
-
+        /* Ignored if a request is already pending, i.e the buffer was not
+         * empty before this SDU. */
         rlc_backend_tx_request(ctx);
+        rlc_mem_peak_update(ctx);
+
+        rlc_lock_release(&ctx->lock);
         rlc_sched_yield(&ctx->sched);
 
         return 0;
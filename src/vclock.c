@@ -0,0 +1,178 @@
+
+#include <errno.h>
+
+#include <rlc/rlc.h>
+#include <rlc/timer.h>
+#include <rlc/vclock.h>
+
+#include "common.h"
+#include "vclock.h"
+
+static struct rlc_timer *timer_from_it(rlc_dlist_it it)
+{
+        return rlc_dlist_it_item(it, struct rlc_timer, vnode);
+}
+
+static struct rlc_timer *timer_from_node(rlc_dlist_node *node)
+{
+        return gabs_container_of(node, struct rlc_timer, vnode);
+}
+
+rlc_errno rlc_vclock_init(struct rlc_vclock *clock, uint64_t start_us)
+{
+        clock->now_us = start_us;
+        rlc_dlist_init(&clock->timers);
+
+        return gabs_mutex_init(&clock->lock);
+}
+
+rlc_errno rlc_vclock_deinit(struct rlc_vclock *clock)
+{
+        return gabs_mutex_deinit(&clock->lock);
+}
+
+/* Disarm all timers of @p ctx on @p clock */
+static void disarm_context(struct rlc_vclock *clock, struct rlc_context *ctx)
+{
+        struct rlc_timer *timer;
+        rlc_dlist_it it;
+
+        rlc_lock_acquire(&clock->lock);
+
+        rlc_dlist_foreach(&clock->timers, it)
+        {
+                timer = timer_from_it(it);
+                if (timer->ctx == ctx) {
+                        timer->vstate = RLC_TIMER_IDLE;
+                        it = rlc_dlist_it_pop(it, NULL);
+                }
+        }
+
+        rlc_lock_release(&clock->lock);
+}
+
+rlc_errno rlc_vclock_attach(struct rlc_context *ctx, struct rlc_vclock *clock)
+{
+        struct rlc_timer *timers[] = {
+                &ctx->rx.t_reassembly,
+                &ctx->arq.t_poll_retransmit,
+                &ctx->arq.t_status_prohibit,
+        };
+        size_t i;
+
+        rlc_lock_acquire(&ctx->lock);
+
+        for (i = 0; i < rlc_array_size(timers); i++) {
+                if (ctx->vclock == NULL && rlc_timer_okay(timers[i]) &&
+                    gabs_timer_active(timers[i]->gtimer)) {
+                        rlc_lock_release(&ctx->lock);
+                        return -EBUSY;
+                }
+        }
+
+        if (ctx->vclock != NULL) {
+                disarm_context(ctx->vclock, ctx);
+        }
+
+        ctx->vclock = clock;
+
+        rlc_lock_release(&ctx->lock);
+
+        return 0;
+}
+
+uint64_t rlc_vclock_now_us(struct rlc_vclock *clock)
+{
+        return rlc_atomic_load(&clock->now_us);
+}
+
+bool rlc_vclock_next_due(struct rlc_vclock *clock, uint64_t *due_us)
+{
+        struct rlc_timer *timer;
+
+        rlc_lock_acquire(&clock->lock);
+
+        timer = timer_from_it(rlc_dlist_it_init(&clock->timers));
+        if (timer != NULL) {
+                *due_us = timer->due_us;
+        }
+
+        rlc_lock_release(&clock->lock);
+
+        return timer != NULL;
+}
+
+void rlc_vclock_arm(struct rlc_vclock *clock, struct rlc_timer *timer,
+                    uint32_t delay_us)
+{
+        rlc_dlist_node *pos;
+
+        rlc_lock_acquire(&clock->lock);
+
+        if (timer->vstate == RLC_TIMER_ARMED) {
+                rlc_dlist_remove(&clock->timers, &timer->vnode);
+        }
+
+        timer->due_us = clock->now_us + delay_us;
+
+        /* Timers are mostly armed with the latest due time, so the place is
+         * looked for from the back. Timers due at the same time fire in the
+         * order they were armed. */
+        for (pos = clock->timers.tail;
+             pos != NULL && timer_from_node(pos)->due_us > timer->due_us;
+             pos = pos->prev) {
+        }
+
+        rlc_dlist_insert_after(&clock->timers, pos, &timer->vnode);
+        timer->vstate = RLC_TIMER_ARMED;
+
+        rlc_lock_release(&clock->lock);
+}
+
+void rlc_vclock_disarm(struct rlc_vclock *clock, struct rlc_timer *timer)
+{
+        rlc_lock_acquire(&clock->lock);
+
+        if (timer->vstate == RLC_TIMER_ARMED) {
+                rlc_dlist_remove(&clock->timers, &timer->vnode);
+        }
+
+        timer->vstate = RLC_TIMER_IDLE;
+
+        rlc_lock_release(&clock->lock);
+}
+
+void rlc_time_advance(struct rlc_vclock *clock, uint64_t delta_us)
+{
+        struct rlc_timer *timer;
+        uint64_t end_us;
+        rlc_dlist_it it;
+
+        rlc_lock_acquire(&clock->lock);
+
+        end_us = clock->now_us + delta_us;
+
+        for (;;) {
+                it = rlc_dlist_it_init(&clock->timers);
+                timer = timer_from_it(it);
+
+                if (timer == NULL || timer->due_us > end_us) {
+                        break;
+                }
+
+                (void)rlc_dlist_it_pop(it, NULL);
+                timer->vstate = RLC_TIMER_FIRING;
+
+                rlc_atomic_store(&clock->now_us,
+                                 rlc_max(clock->now_us, timer->due_us));
+
+                /* The callback takes the context lock, and may arm timers */
+                rlc_lock_release(&clock->lock);
+                rlc_timer_fire(timer);
+                rlc_lock_acquire(&clock->lock);
+        }
+
+        rlc_atomic_store(&clock->now_us, end_us);
+
+        rlc_lock_release(&clock->lock);
+}
@@ -0,0 +1,26 @@
+
+#ifndef RLC_VCLOCK_INTERNAL_H__
+#define RLC_VCLOCK_INTERNAL_H__
+
+#include <rlc/timer.h>
+#include <rlc/vclock.h>
+
+RLC_BEGIN_DECL
+
+/** @brief Arm @p timer to be due @p delay_us from now, rearming it if it is
+ * already armed */
+void rlc_vclock_arm(struct rlc_vclock *clock, struct rlc_timer *timer,
+                    uint32_t delay_us);
+
+/** @brief Disarm @p timer, if it is armed */
+void rlc_vclock_disarm(struct rlc_vclock *clock, struct rlc_timer *timer);
+
+/**
+ * @brief Run the callback of @p timer, unless it was stopped or rearmed after
+ * it was found to be due. Defined in timer.c.
+ */
+void rlc_timer_fire(struct rlc_timer *timer);
+
+RLC_END_DECL
+
+#endif /* RLC_VCLOCK_INTERNAL_H__ */
@@ -0,0 +1,294 @@
+
+#ifndef RLC_TESTS_ENTITY_HH__
+#define RLC_TESTS_ENTITY_HH__
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+
+#include <gabs/pbuf.h>
+#include <gabs/alloc/std.hh>
+
+#include <rlc/rlc.h>
+#include <rlc/vclock.h>
+
+inline gabs::memory::allocator alloc;
+
+namespace test
+{
+
+using pdu = std::vector<std::uint8_t>;
+
+class entity;
+
+/* Standard layout, so that the context pointer given to the backend and the
+ * listener can be converted back to the entity. */
+struct endpoint {
+        ::rlc_context ctx;
+        entity *owner;
+};
+
+/**
+ * RLC entity on a virtual clock. PDUs are built into memory with
+ * `rlc_tx_build` and handed to the test, which decides what reaches the peer.
+ * Each SDU sent carries its index in the first byte, followed by the same
+ * byte repeated.
+ */
+class entity
+{
+      public:
+        /* Calls to the `tx_request` of the backend */
+        std::size_t requests = 0;
+
+        /* Returned by the `tx_request` of the backend */
+        ::rlc_errno request_status = 0;
+
+        /* PDUs submitted through the backend, outside of `build` */
+        std::vector<pdu> submitted;
+
+        /* Data was left over by the last `build` */
+        bool pending = false;
+
+        /* Handles of the PDUs written by the last `build` */
+        std::vector<::rlc_pdu_handle> handles;
+
+        std::vector<pdu> delivered;
+
+        /* SNs and reasons of `RLC_EVENT_TX_RELEASE` */
+        std::vector<std::pair<std::uint32_t, int>> released;
+
+        entity(const ::rlc_config &conf, ::rlc_vclock *vclock) : conf(conf)
+        {
+                ep.owner = this;
+
+                REQUIRE(::rlc_init(&ep.ctx, &backend, alloc, alloc) == 0);
+                ::rlc_set_config(&ep.ctx, &this->conf);
+                (void)::rlc_reset(&ep.ctx);
+
+                REQUIRE(::rlc_attach_listener(&ep.ctx, on_event) == 0);
+                REQUIRE(::rlc_vclock_attach(&ep.ctx, vclock) == 0);
+        }
+
+        ~entity()
+        {
+                (void)::rlc_vclock_attach(&ep.ctx, nullptr);
+                ::rlc_detach_listener(&ep.ctx);
+                (void)::rlc_deinit(&ep.ctx);
+        }
+
+        entity(const entity &) = delete;
+        entity &operator=(const entity &) = delete;
+
+        ::rlc_context *context()
+        {
+                return &ep.ctx;
+        }
+
+        ::rlc_errno send(std::size_t size, ::rlc_sdu **sdu = nullptr)
+        {
+                std::vector<std::uint8_t> data(size, sent & 0xff);
+                ::rlc_errno status;
+
+                auto buf = ::gabs_pbuf_new(alloc, size);
+                REQUIRE(::gabs_pbuf_okay(buf));
+                ::gabs_pbuf_put(&buf, data.data(), size);
+
+                status = ::rlc_tx(&ep.ctx, buf, sdu);
+                ::gabs_pbuf_decref(buf);
+
+                if (status == 0) {
+                        sent++;
+                }
+
+                return status;
+        }
+
+        /* Serve a transmit opportunity of @p grant bytes, holding at most
+         * @p pdu_max PDUs */
+        std::vector<pdu> build(std::size_t grant, std::size_t pdu_max = 64)
+        {
+                std::vector<std::uint8_t> dst(grant);
+                std::vector<::rlc_tx_pdu_info> info(pdu_max);
+                std::vector<pdu> pdus;
+                std::size_t count = pdu_max;
+                std::size_t used;
+
+                used = ::rlc_tx_build(&ep.ctx, dst.data(), grant, info.data(),
+                                      &count, &pending);
+                REQUIRE(used <= grant);
+                REQUIRE(count <= pdu_max);
+
+                handles.clear();
+
+                for (std::size_t i = 0; i < count; i++) {
+                        auto begin = dst.begin() + info[i].offset;
+
+                        REQUIRE(info[i].offset + info[i].size <= used);
+                        pdus.emplace_back(begin, begin + info[i].size);
+                        handles.push_back(info[i].handle);
+                }
+
+                return pdus;
+        }
+
+        /* Serve a transmit opportunity of @p grant bytes through the backend,
+         * returning the PDUs submitted */
+        std::vector<pdu> avail(std::size_t grant)
+        {
+                std::vector<pdu> pdus;
+
+                submitted.clear();
+                (void)::rlc_tx_avail(&ep.ctx, grant);
+                pdus.swap(submitted);
+
+                return pdus;
+        }
+
+        void receive(const pdu &pdu)
+        {
+                auto buf = ::gabs_pbuf_new(alloc, pdu.size());
+
+                REQUIRE(::gabs_pbuf_okay(buf));
+                ::gabs_pbuf_put(&buf, pdu.data(), pdu.size());
+
+                ::rlc_rx_submit(&ep.ctx, buf);
+        }
+
+        void receive(const std::vector<pdu> &pdus)
+        {
+                for (auto &pdu : pdus) {
+                        receive(pdu);
+                }
+        }
+
+        struct ::rlc_tx_buffer_status buffer_status()
+        {
+                struct ::rlc_tx_buffer_status status;
+
+                ::rlc_tx_buffer_status(&ep.ctx, &status);
+
+                return status;
+        }
+
+      private:
+        ::rlc_config conf;
+        endpoint ep;
+        std::size_t sent = 0;
+
+        static entity *from_ctx(::rlc_context *ctx)
+        {
+                return reinterpret_cast<endpoint *>(ctx)->owner;
+        }
+
+        static ::rlc_errno on_submit(::rlc_context *ctx, ::gabs_pbuf buf)
+        {
+                test::pdu pdu(::gabs_pbuf_size(buf));
+
+                (void)::gabs_pbuf_copy(buf, pdu.data(), 0, pdu.size());
+                ::gabs_pbuf_decref(buf);
+
+                from_ctx(ctx)->submitted.push_back(std::move(pdu));
+
+                return 0;
+        }
+
+        static ::rlc_errno on_request(::rlc_context *ctx)
+        {
+                auto self = from_ctx(ctx);
+
+                self->requests++;
+                return self->request_status;
+        }
+
+        static void on_event(::rlc_context *ctx, const ::rlc_event *event)
+        {
+                auto self = from_ctx(ctx);
+
+                switch (event->type) {
+                case ::rlc_event::RLC_EVENT_RX_DONE: {
+                        auto buf = ::rlc_sdu_buffer(event->sdu);
+                        test::pdu data(::gabs_pbuf_size(buf));
+
+                        (void)::gabs_pbuf_copy(buf, data.data(), 0,
+                                               data.size());
+                        self->delivered.push_back(std::move(data));
+                        break;
+                }
+                case ::rlc_event::RLC_EVENT_TX_RELEASE:
+                        self->released.emplace_back(
+                                event->tx_release.sdu->sn,
+                                static_cast<int>(event->tx_release.reason));
+                        break;
+                default:
+                        break;
+                }
+        }
+
+        static constexpr ::rlc_backend backend = {
+                on_submit,
+                on_request,
+                nullptr,
+        };
+};
+
+/* Configuration of an AM entity, with timers long enough that they only fire
+ * when time is advanced on purpose */
+inline ::rlc_config am_config()
+{
+        ::rlc_config conf = {};
+
+        conf.type = ::RLC_AM;
+        conf.window_size = 2048;
+        conf.pdu_without_poll_max = 64;
+        conf.byte_without_poll_max = 64000;
+        conf.time_reassembly_us = 20000;
+        conf.time_poll_retransmit_us = 50000;
+        conf.time_status_prohibit_us = 10000;
+        conf.max_retx_threshhold = 8;
+        conf.sn_width = ::RLC_SN_12BIT;
+
+        return conf;
+}
+
+inline ::rlc_config um_config()
+{
+        ::rlc_config conf = {};
+
+        conf.type = ::RLC_UM;
+        conf.window_size = 2048;
+        conf.time_reassembly_us = 20000;
+        conf.sn_width = ::RLC_SN_12BIT;
+
+        return conf;
+}
+
+/* Virtual clock that is set up and torn down with the test */
+struct clock {
+        ::rlc_vclock vclock;
+
+        clock()
+        {
+                REQUIRE(::rlc_vclock_init(&vclock, 0) == 0);
+        }
+
+        ~clock()
+        {
+                (void)::rlc_vclock_deinit(&vclock);
+        }
+
+        ::rlc_vclock *get()
+        {
+                return &vclock;
+        }
+
+        void advance(std::uint64_t delta_us)
+        {
+                ::rlc_time_advance(&vclock, delta_us);
+        }
+};
+
+}; // namespace test
+
+#endif /* RLC_TESTS_ENTITY_HH__ */
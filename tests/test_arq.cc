@@ -0,0 +1,517 @@
+#include <algorithm>
+
+#include <catch2/catch_all.hpp>
+
+#include <rlc/rlc.h>
+
+#include "encode.h"
+#include "entity.hh"
+
+namespace
+{
+
+/* t-PollRetransmit derived from the round trip time */
+::rlc_config rtt_config()
+{
+        auto conf = test::am_config();
+
+        conf.time_poll_retransmit_min_us = 10000;
+        conf.time_poll_retransmit_max_us = 200000;
+
+        return conf;
+}
+
+/* Send an SDU with a poll, and answer it after @p rtt_us */
+void round_trip(test::clock &clock, test::entity &tx, test::entity &rx,
+                std::uint64_t rtt_us)
+{
+        REQUIRE(tx.send(100) == 0);
+
+        auto pdus = tx.build(1000);
+        REQUIRE(pdus.size() == 1);
+
+        clock.advance(rtt_us);
+
+        rx.receive(pdus);
+        tx.receive(rx.build(1000));
+
+        /* Let status prohibit expire before the next round */
+        clock.advance(test::am_config().time_status_prohibit_us);
+}
+
+::rlc_tx_rtt rtt_get(test::entity &tx)
+{
+        ::rlc_tx_rtt rtt;
+
+        ::rlc_tx_rtt_get(tx.context(), &rtt);
+
+        return rtt;
+}
+
+struct status {
+        std::uint32_t ack_sn;
+        std::vector<::rlc_pdu_status> entries;
+};
+
+status decode_status(test::entity &entity, const test::pdu &data)
+{
+        ::rlc_pdu pdu;
+        status result;
+
+        auto buf = ::gabs_pbuf_new(alloc, data.size());
+        ::gabs_pbuf_put(&buf, data.data(), data.size());
+
+        REQUIRE(::rlc_pdu_decode(entity.context(), &pdu, &buf) == 0);
+        REQUIRE(pdu.flags.is_status);
+
+        result.ack_sn = pdu.sn;
+
+        for (;;) {
+                ::rlc_pdu_status entry = {};
+
+                if (::rlc_status_decode(entity.context(), &entry, &buf) != 0) {
+                        break;
+                }
+
+                result.entries.push_back(entry);
+        }
+
+        ::gabs_pbuf_decref(buf);
+
+        return result;
+}
+
+/* Build the status PDU due at @p rx into @p grant bytes */
+status build_status(test::entity &rx, std::size_t grant)
+{
+        auto pdus = rx.build(grant);
+
+        REQUIRE(pdus.size() == 1);
+        REQUIRE(pdus[0].size() <= grant);
+
+        return decode_status(rx, pdus[0]);
+}
+
+/* Receive @p pdus at @p rx, leaving out those at @p lost, and let reassembly
+ * time out so that the holes are reported */
+void receive_lossy(test::clock &clock, test::entity &rx,
+                   const std::vector<test::pdu> &pdus,
+                   std::initializer_list<std::size_t> lost)
+{
+        for (std::size_t i = 0; i < pdus.size(); i++) {
+                if (std::find(lost.begin(), lost.end(), i) == lost.end()) {
+                        rx.receive(pdus[i]);
+                }
+        }
+
+        for (auto i = 0; i < 2; i++) {
+                clock.advance(test::am_config().time_reassembly_us);
+        }
+}
+
+/* Header of a status PDU with 12 bit SNs */
+constexpr std::size_t status_header = 3;
+
+}; // namespace
+
+TEST_CASE("Round trip time", "[arq]")
+{
+        test::clock clock;
+        auto conf = rtt_config();
+        test::entity tx(conf, clock.get());
+        test::entity rx(conf, clock.get());
+
+        /* Fixed until the first sample */
+        REQUIRE(rtt_get(tx).samples == 0);
+        REQUIRE(rtt_get(tx).poll_retransmit_us ==
+                conf.time_poll_retransmit_us);
+
+        round_trip(clock, tx, rx, 20000);
+
+        /* RFC 6298 section 2.2 */
+        auto rtt = rtt_get(tx);
+        REQUIRE(rtt.samples == 1);
+        REQUIRE(rtt.srtt_us == 20000);
+        REQUIRE(rtt.rttvar_us == 10000);
+        REQUIRE(rtt.poll_retransmit_us == 20000 + 4 * 10000);
+
+        SECTION("Smoothed")
+        {
+                /* RFC 6298 section 2.3 */
+                round_trip(clock, tx, rx, 28000);
+
+                rtt = rtt_get(tx);
+                REQUIRE(rtt.samples == 2);
+                REQUIRE(rtt.rttvar_us == (3 * 10000 + 8000) / 4);
+                REQUIRE(rtt.srtt_us == (7 * 20000 + 28000) / 8);
+                REQUIRE(rtt.poll_retransmit_us ==
+                        rtt.srtt_us + 4 * rtt.rttvar_us);
+        }
+
+        SECTION("Retransmitted polls are not sampled")
+        {
+                REQUIRE(tx.send(100) == 0);
+
+                auto pdus = tx.build(1000);
+                REQUIRE(pdus.size() == 1);
+
+                /* Backed off once it expires */
+                clock.advance(60000);
+                REQUIRE(rtt_get(tx).poll_retransmit_us == 2 * 60000);
+
+                auto retx = tx.build(1000);
+                REQUIRE(retx.size() == 1);
+
+                rx.receive(pdus);
+                rx.receive(retx);
+                tx.receive(rx.build(1000));
+
+                /* Karn's algorithm: the status PDU may answer either */
+                rtt = rtt_get(tx);
+                REQUIRE(tx.released.size() == 2);
+                REQUIRE(rtt.samples == 1);
+                REQUIRE(rtt.srtt_us == 20000);
+
+                /* The next sample ends the back off */
+                clock.advance(conf.time_status_prohibit_us);
+                round_trip(clock, tx, rx, 20000);
+
+                rtt = rtt_get(tx);
+                REQUIRE(rtt.samples == 2);
+                REQUIRE(rtt.poll_retransmit_us ==
+                        rtt.srtt_us + 4 * rtt.rttvar_us);
+        }
+}
+
+TEST_CASE("Poll retransmit bounds", "[arq]")
+{
+        test::clock clock;
+        auto conf = rtt_config();
+
+        SECTION("Lower")
+        {
+                conf.time_poll_retransmit_min_us = 80000;
+        }
+
+        SECTION("Upper")
+        {
+                conf.time_poll_retransmit_max_us = 40000;
+        }
+
+        test::entity tx(conf, clock.get());
+        test::entity rx(conf, clock.get());
+
+        round_trip(clock, tx, rx, 20000);
+
+        auto rtt = rtt_get(tx);
+        REQUIRE(rtt.srtt_us + 4 * rtt.rttvar_us == 60000);
+        REQUIRE(rtt.poll_retransmit_us ==
+                std::clamp<std::uint32_t>(60000,
+                                          conf.time_poll_retransmit_min_us,
+                                          conf.time_poll_retransmit_max_us));
+}
+
+TEST_CASE("Status PDU truncation", "[arq]")
+{
+        test::clock clock;
+        test::entity tx(test::am_config(), clock.get());
+        test::entity rx(test::am_config(), clock.get());
+        status result;
+
+        for (auto i = 0; i < 6; i++) {
+                REQUIRE(tx.send(100) == 0);
+        }
+
+        auto pdus = tx.build(1000);
+        REQUIRE(pdus.size() == 6);
+
+        /* A NACK_range entry for 1 and 2, and a NACK for 4 */
+        receive_lossy(clock, rx, pdus, {1, 2, 4});
+
+        SECTION("Every hole fits")
+        {
+                result = build_status(rx, 1000);
+
+                REQUIRE(result.ack_sn == 6);
+                REQUIRE(result.entries.size() == 2);
+                REQUIRE(result.entries[0].nack_sn == 1);
+                REQUIRE(result.entries[0].ext.has_range);
+                REQUIRE(result.entries[0].range == 2);
+                REQUIRE(result.entries[1].nack_sn == 4);
+                REQUIRE(!result.entries[1].ext.has_range);
+        }
+
+        SECTION("Truncated at the first hole left out")
+        {
+                result = build_status(rx, status_header + 3);
+
+                REQUIRE(result.ack_sn == 4);
+                REQUIRE(result.entries.size() == 1);
+                REQUIRE(result.entries[0].nack_sn == 1);
+                REQUIRE(result.entries[0].range == 2);
+        }
+
+        SECTION("Range reduced to its first SN")
+        {
+                result = build_status(rx, status_header + 2);
+
+                REQUIRE(result.ack_sn == 2);
+                REQUIRE(result.entries.size() == 1);
+                REQUIRE(result.entries[0].nack_sn == 1);
+                REQUIRE(!result.entries[0].ext.has_range);
+        }
+
+        SECTION("Room for the header only")
+        {
+                /* Acknowledges what comes before the first hole */
+                result = build_status(rx, status_header);
+
+                REQUIRE(result.ack_sn == 1);
+                REQUIRE(result.entries.empty());
+        }
+}
+
+TEST_CASE("Reassembly timeout", "[arq]")
+{
+        test::clock clock;
+        auto conf = test::am_config();
+        test::entity tx(conf, clock.get());
+        test::entity rx(conf, clock.get());
+
+        for (auto i = 0; i < 3; i++) {
+                REQUIRE(tx.send(100) == 0);
+        }
+
+        auto pdus = tx.build(1000);
+        REQUIRE(pdus.size() == 3);
+
+        rx.receive(pdus[0]);
+        rx.receive(pdus[2]);
+
+        /* The missing SDU is reported instead of skipped */
+        clock.advance(conf.time_reassembly_us);
+        REQUIRE(rx.delivered.size() == 1);
+
+        auto status = rx.build(1000);
+        REQUIRE(status.size() == 1);
+
+        auto result = decode_status(rx, status[0]);
+        REQUIRE(result.ack_sn == 3);
+        REQUIRE(result.entries.size() == 1);
+        REQUIRE(result.entries[0].nack_sn == 1);
+
+        tx.receive(status);
+        rx.receive(tx.build(1000));
+
+        REQUIRE(rx.delivered ==
+                std::vector<test::pdu>{test::pdu(100, 0), test::pdu(100, 1),
+                                       test::pdu(100, 2)});
+}
+
+TEST_CASE("Status PDU with separate holes", "[arq]")
+{
+        test::clock clock;
+        test::entity tx(test::am_config(), clock.get());
+        test::entity rx(test::am_config(), clock.get());
+
+        for (auto i = 0; i < 6; i++) {
+                REQUIRE(tx.send(100) == 0);
+        }
+
+        auto pdus = tx.build(1000);
+        REQUIRE(pdus.size() == 6);
+
+        receive_lossy(clock, rx, pdus, {0, 2, 4});
+
+        /* Each NACK is kept when another one follows it */
+        auto result = build_status(rx, 1000);
+
+        REQUIRE(result.ack_sn == 6);
+        REQUIRE(result.entries.size() == 3);
+
+        for (std::size_t i = 0; i < 3; i++) {
+                REQUIRE(result.entries[i].nack_sn == 2 * i);
+                REQUIRE(!result.entries[i].ext.has_range);
+                REQUIRE(!result.entries[i].ext.has_offset);
+        }
+}
+
+TEST_CASE("Status PDU segment offsets", "[arq]")
+{
+        test::clock clock;
+        test::entity tx(test::am_config(), clock.get());
+        test::entity rx(test::am_config(), clock.get());
+        status result;
+
+        SECTION("Dropped to report the whole SDU")
+        {
+                REQUIRE(tx.send(300) == 0);
+                REQUIRE(tx.send(100) == 0);
+
+                /* Bytes 98 to 194 of the first SDU are lost */
+                std::vector<test::pdu> pdus = {tx.build(100)[0],
+                                               tx.build(100)[0]};
+                auto rest = tx.build(1000);
+                pdus.insert(pdus.end(), rest.begin(), rest.end());
+
+                receive_lossy(clock, rx, pdus, {1});
+
+                SECTION("Fits")
+                {
+                        result = build_status(rx, status_header + 6);
+
+                        REQUIRE(result.ack_sn == 2);
+                        REQUIRE(result.entries.size() == 1);
+                        REQUIRE(result.entries[0].ext.has_offset);
+                        REQUIRE(result.entries[0].offset.start == 98);
+                }
+
+                SECTION("Does not fit")
+                {
+                        auto built = rx.build(8);
+                        REQUIRE(built.size() == 1);
+
+                        result = decode_status(rx, built[0]);
+
+                        REQUIRE(result.ack_sn == 2);
+                        REQUIRE(result.entries.size() == 1);
+                        REQUIRE(result.entries[0].nack_sn == 0);
+                        REQUIRE(!result.entries[0].ext.has_offset);
+
+                        tx.receive(built);
+                        REQUIRE(tx.buffer_status().retx_bytes == 300);
+                }
+        }
+
+        SECTION("Whole SDUs are reported once")
+        {
+                REQUIRE(tx.send(300) == 0);
+
+                /* Bytes 60 to 120 and 180 to 240 are lost */
+                std::vector<test::pdu> pdus = {
+                        tx.build(62)[0], tx.build(64)[0], tx.build(64)[0],
+                        tx.build(64)[0], tx.build(1000)[0]};
+
+                receive_lossy(clock, rx, pdus, {1, 3});
+
+                result = build_status(rx, status_header + 5);
+
+                REQUIRE(result.ack_sn == 1);
+                REQUIRE(result.entries.size() == 1);
+                REQUIRE(result.entries[0].nack_sn == 0);
+                REQUIRE(!result.entries[0].ext.has_offset);
+        }
+
+        SECTION("Dropped from a range")
+        {
+                REQUIRE(tx.send(300) == 0);
+                REQUIRE(tx.send(100) == 0);
+                REQUIRE(tx.send(300) == 0);
+                REQUIRE(tx.send(100) == 0);
+
+                /* From byte 98 of the first SDU to byte 98 of the third */
+                std::vector<test::pdu> pdus = {
+                        tx.build(100)[0], tx.build(206)[0], tx.build(102)[0],
+                        tx.build(100)[0]};
+                auto rest = tx.build(1000);
+                pdus.insert(pdus.end(), rest.begin(), rest.end());
+
+                receive_lossy(clock, rx, pdus, {1, 2, 3});
+
+                SECTION("Fits")
+                {
+                        result = build_status(rx, status_header + 7);
+
+                        REQUIRE(result.ack_sn == 4);
+                        REQUIRE(result.entries.size() == 1);
+                        REQUIRE(result.entries[0].range == 3);
+                        REQUIRE(result.entries[0].ext.has_offset);
+                }
+
+                SECTION("Does not fit")
+                {
+                        result = build_status(rx, status_header + 3);
+
+                        REQUIRE(result.ack_sn == 4);
+                        REQUIRE(result.entries.size() == 1);
+                        REQUIRE(result.entries[0].nack_sn == 0);
+                        REQUIRE(result.entries[0].range == 3);
+                        REQUIRE(!result.entries[0].ext.has_offset);
+                }
+        }
+}
+
+TEST_CASE("Status PDU suppression", "[arq]")
+{
+        test::clock clock;
+        auto conf = test::am_config();
+
+        /* Shorter than the time an unchanged status PDU is held back */
+        conf.time_poll_retransmit_us = 30000;
+
+        test::entity tx(conf, clock.get());
+        test::entity rx(conf, clock.get());
+
+        REQUIRE(tx.send(100) == 0);
+        rx.receive(tx.build(1000));
+
+        /* The first status PDU is lost */
+        REQUIRE(rx.build(1000).size() == 1);
+
+        clock.advance(conf.time_poll_retransmit_us);
+
+        auto retx = tx.build(1000);
+        REQUIRE(retx.size() == 1);
+        rx.receive(retx);
+
+        /* Unchanged, but answering a retransmitted poll */
+        auto status = rx.build(1000);
+        REQUIRE(status.size() == 1);
+
+        tx.receive(status);
+        REQUIRE(tx.released.size() == 1);
+}
+
+TEST_CASE("Unchanged status PDUs", "[arq]")
+{
+        test::clock clock;
+        auto conf = test::am_config();
+
+        /* Polls are retransmitted before the status PDU arrives */
+        conf.time_poll_retransmit_us = 4000;
+
+        test::entity tx(conf, clock.get());
+        test::entity rx(conf, clock.get());
+        ::rlc_rx_stats stats;
+
+        REQUIRE(tx.send(100) == 0);
+        rx.receive(tx.build(1000));
+
+        auto status = rx.build(1000);
+        REQUIRE(status.size() == 1);
+
+        /* Each retransmitted poll crosses the status PDU in flight */
+        for (auto i = 0; i < 2; i++) {
+                clock.advance(conf.time_poll_retransmit_us);
+
+                auto retx = tx.build(1000);
+                REQUIRE(retx.size() == 1);
+                rx.receive(retx);
+
+                REQUIRE(rx.build(1000).empty());
+        }
+
+        clock.advance(conf.time_status_prohibit_us -
+                      2 * conf.time_poll_retransmit_us);
+
+        /* Nothing has changed since the status PDU in flight */
+        REQUIRE(rx.build(1000).empty());
+
+        ::rlc_rx_stats_get(rx.context(), &stats);
+        REQUIRE(stats.polls == 3);
+        REQUIRE(stats.status_sent == 1);
+        REQUIRE(stats.status_suppressed == 1);
+
+        tx.receive(status);
+        REQUIRE(tx.released.size() == 1);
+}
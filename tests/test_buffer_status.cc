@@ -0,0 +1,190 @@
+#include <catch2/catch_all.hpp>
+
+#include <rlc/rlc.h>
+#include <rlc/sdu.h>
+#include <rlc/seg_list.h>
+
+#include "entity.hh"
+
+namespace
+{
+
+/* Buffer status counted byte by byte over the TX queue */
+struct walk {
+        std::size_t new_bytes = 0;
+        std::size_t retx_bytes = 0;
+        std::size_t new_sdus = 0;
+        std::size_t retx_segs = 0;
+        std::size_t queued_bytes = 0;
+        std::size_t queued_sdus = 0;
+};
+
+walk tx_walk(::rlc_context *ctx)
+{
+        walk result;
+        ::rlc_dlist_it it;
+
+        rlc_dlist_foreach(&ctx->tx.sdus, it)
+        {
+                auto sdu = rlc_sdu_from_it(it);
+                std::size_t new_bytes = 0;
+                ::rlc_dlist_it seg_it;
+
+                rlc_dlist_foreach(&sdu->tx.unsent, seg_it)
+                {
+                        auto item = ::rlc_seg_item_from_it(seg_it);
+                        std::size_t retx_bytes = 0;
+
+                        for (auto i = item->seg.start; i < item->seg.end;
+                             i++) {
+                                if (i < sdu->tx.sent) {
+                                        retx_bytes++;
+                                } else {
+                                        new_bytes++;
+                                }
+                        }
+
+                        result.retx_bytes += retx_bytes;
+                        result.retx_segs += retx_bytes > 0;
+                }
+
+                result.new_bytes += new_bytes;
+                result.new_sdus += new_bytes > 0;
+                result.queued_bytes += ::gabs_pbuf_size(sdu->tx.buffer);
+                result.queued_sdus++;
+        }
+
+        return result;
+}
+
+void check(test::entity &tx)
+{
+        auto ctx = tx.context();
+        auto expect = tx_walk(ctx);
+        auto status = tx.buffer_status();
+
+        REQUIRE(status.new_bytes == expect.new_bytes);
+        REQUIRE(status.retx_bytes == expect.retx_bytes);
+        REQUIRE(status.queued_bytes == expect.queued_bytes);
+        REQUIRE(status.queued_sdus == expect.queued_sdus);
+        REQUIRE(ctx->tx.bs.new_sdus == expect.new_sdus);
+        REQUIRE(ctx->tx.bs.retx_segs == expect.retx_segs);
+}
+
+}; // namespace
+
+TEST_CASE("Buffer status counters", "[buffer_status]")
+{
+        test::clock clock;
+        ::rlc_sdu *sdu;
+
+        auto conf = test::am_config();
+        conf.discard_timer_us = 100000;
+
+        test::entity tx(conf, clock.get());
+        test::entity rx(conf, clock.get());
+
+        for (auto i = 0; i < 5; i++) {
+                REQUIRE(tx.send(300) == 0);
+                check(tx);
+        }
+
+        REQUIRE(tx.buffer_status().new_bytes == 1500);
+
+        /* Segmented */
+        auto lost = tx.build(150);
+        REQUIRE(lost.size() == 1);
+        check(tx);
+
+        auto pdus = tx.build(700);
+        REQUIRE(pdus.size() == 3);
+        check(tx);
+
+        auto more = tx.build(2000);
+        REQUIRE(!more.empty());
+        pdus.insert(pdus.end(), more.begin(), more.end());
+        check(tx);
+
+        REQUIRE(tx.buffer_status().new_bytes == 0);
+
+        /* The first segment is reported missing once reassembly times out */
+        rx.receive(pdus);
+        clock.advance(conf.time_reassembly_us);
+
+        auto status_bytes = rx.buffer_status().status_bytes;
+        auto status = rx.build(1000);
+        REQUIRE(status.size() == 1);
+        REQUIRE(status[0].size() == status_bytes);
+        REQUIRE(rx.buffer_status().status_bytes == 0);
+
+        tx.receive(status);
+        REQUIRE(tx.buffer_status().retx_bytes == 148);
+        check(tx);
+
+        /* Retransmitted in two segments */
+        auto retx = tx.build(60);
+        REQUIRE(retx.size() == 1);
+        REQUIRE(tx.buffer_status().retx_bytes == 90);
+        check(tx);
+
+        /* Discarded by the timer, and on request */
+        REQUIRE(tx.send(300) == 0);
+        REQUIRE(tx.send(300) == 0);
+        check(tx);
+
+        clock.advance(conf.discard_timer_us);
+
+        REQUIRE(tx.send(200, &sdu) == 0);
+        REQUIRE(tx.buffer_status().new_bytes == 200);
+        check(tx);
+
+        REQUIRE(::rlc_tx_discard(tx.context(), sdu) == 0);
+        ::rlc_sdu_decref(sdu);
+        REQUIRE(tx.buffer_status().new_bytes == 0);
+        check(tx);
+
+        /* Acknowledged */
+        rx.receive(retx);
+        rx.receive(tx.build(1000));
+        clock.advance(conf.time_status_prohibit_us);
+        tx.receive(rx.build(1000));
+        check(tx);
+
+        REQUIRE(tx.buffer_status().queued_sdus == 0);
+        REQUIRE(rx.delivered.size() == 5);
+}
+
+TEST_CASE("Status PDU size", "[buffer_status]")
+{
+        test::clock clock;
+        auto conf = test::am_config();
+
+        test::entity tx(conf, clock.get());
+        test::entity rx(conf, clock.get());
+
+        for (auto i = 0; i < 4; i++) {
+                REQUIRE(tx.send(100) == 0);
+        }
+
+        /* Data is left in the buffer, so none of these is polled. The second
+         * SDU is held back. */
+        auto pdus = tx.build(1000, 3);
+        REQUIRE(pdus.size() == 3);
+        rx.receive(pdus[0]);
+        rx.receive(pdus[2]);
+
+        clock.advance(conf.time_reassembly_us);
+
+        /* Header and a NACK */
+        REQUIRE(rx.buffer_status().status_bytes == 5);
+
+        /* The hole is filled before the status PDU is sent */
+        rx.receive(pdus[1]);
+        REQUIRE(rx.delivered.size() == 3);
+        REQUIRE(rx.buffer_status().status_bytes == 3);
+
+        auto status = rx.build(1000);
+        REQUIRE(status.size() == 1);
+        REQUIRE(status[0].size() == 3);
+        REQUIRE(rx.buffer_status().status_bytes == 0);
+}
@@ -0,0 +1,200 @@
+#include <memory>
+
+#include <catch2/catch_all.hpp>
+
+#include <rlc/rlc.h>
+#include <rlc/lcp.h>
+
+#include "entity.hh"
+
+namespace
+{
+
+struct lcp {
+        ::rlc_lcp mux;
+
+        lcp()
+        {
+                REQUIRE(::rlc_lcp_init(&mux) == 0);
+        }
+
+        ~lcp()
+        {
+                (void)::rlc_lcp_deinit(&mux);
+        }
+};
+
+/* UM entity taking part in @p mux for as long as it lives */
+struct channel {
+        test::entity entity;
+        ::rlc_lcp_channel lcp;
+        ::rlc_lcp *mux;
+
+        channel(struct lcp &mux, ::rlc_vclock *vclock, unsigned int priority,
+                uint32_t pbr, uint32_t bsd_us)
+                : entity(test::um_config(), vclock), mux(&mux.mux)
+        {
+                ::rlc_lcp_channel_init(&lcp, entity.context(), priority, pbr,
+                                       bsd_us);
+                ::rlc_lcp_add(this->mux, &lcp);
+        }
+
+        ~channel()
+        {
+                ::rlc_lcp_remove(mux, &lcp);
+        }
+
+        void send(std::size_t count, std::size_t size)
+        {
+                for (std::size_t i = 0; i < count; i++) {
+                        REQUIRE(entity.send(size) == 0);
+                }
+        }
+
+        /* Bytes submitted so far */
+        std::size_t used() const
+        {
+                std::size_t sum = 0;
+
+                for (auto &pdu : entity.submitted) {
+                        sum += pdu.size();
+                }
+
+                return sum;
+        }
+};
+
+}; // namespace
+
+TEST_CASE("Bucket filling", "[lcp]")
+{
+        test::clock clock;
+        lcp mux;
+
+        /* 1000 bytes per second, with room for 100 ms */
+        channel chan(mux, clock.get(), 1, 1000, 100000);
+
+        SECTION("Parts of a byte are carried")
+        {
+                /* Half a byte per tick */
+                for (auto i = 0; i < 100; i++) {
+                        ::rlc_lcp_tick(&mux.mux, 500);
+                }
+
+                REQUIRE(chan.lcp.bucket == 50);
+        }
+
+        SECTION("Capped by the bucket size duration")
+        {
+                for (auto i = 0; i < 300; i++) {
+                        ::rlc_lcp_tick(&mux.mux, 500);
+                }
+
+                REQUIRE(chan.lcp.bucket == 100);
+        }
+}
+
+TEST_CASE("Grant split between channels", "[lcp]")
+{
+        test::clock clock;
+        lcp mux;
+
+        SECTION("Strict priority without prioritized bit rates")
+        {
+                channel low(mux, clock.get(), 2, 0, 0);
+                channel high(mux, clock.get(), 1, 0, 0);
+
+                low.send(10, 100);
+                high.send(10, 100);
+
+                auto left = ::rlc_lcp_grant(&mux.mux, 500);
+
+                REQUIRE(high.used() > 0);
+                REQUIRE(low.used() == 0);
+                REQUIRE(left == 500 - high.used());
+        }
+
+        SECTION("Prioritized bit rates served first")
+        {
+                channel low(mux, clock.get(), 2, 1000, 1000000);
+                channel high(mux, clock.get(), 1, 1000, 1000000);
+
+                low.send(10, 100);
+                high.send(10, 100);
+
+                /* 100 bytes in each bucket */
+                ::rlc_lcp_tick(&mux.mux, 100000);
+
+                auto left = ::rlc_lcp_grant(&mux.mux, 300);
+
+                /* The lower priority gets its bucket even though the higher
+                 * priority could use the whole grant, which gets the rest */
+                REQUIRE(low.used() > 0);
+                REQUIRE(low.used() <= 100);
+                REQUIRE(high.used() > 100);
+                REQUIRE(left == 300 - high.used() - low.used());
+
+                /* Buckets are debited with what was used */
+                REQUIRE(high.lcp.bucket == 100 - (std::int64_t)high.used());
+                REQUIRE(low.lcp.bucket == 100 - (std::int64_t)low.used());
+        }
+
+        SECTION("Leftover given in priority order")
+        {
+                channel low(mux, clock.get(), 3, 0, 0);
+                channel mid(mux, clock.get(), 2, 0, 0);
+                channel high(mux, clock.get(), 1, 1000, 1000000);
+
+                /* Less than its bucket */
+                high.send(1, 50);
+                mid.send(2, 100);
+                low.send(10, 100);
+
+                ::rlc_lcp_tick(&mux.mux, 100000);
+
+                auto left = ::rlc_lcp_grant(&mux.mux, 500);
+
+                /* Every SDU fits whole, with a byte of header each */
+                REQUIRE(high.used() == 51);
+                REQUIRE(mid.used() == 202);
+                REQUIRE(low.used() > 0);
+                REQUIRE(left ==
+                        500 - high.used() - mid.used() - low.used());
+
+                REQUIRE(high.entity.buffer_status().new_bytes == 0);
+                REQUIRE(mid.entity.buffer_status().new_bytes == 0);
+        }
+
+        SECTION("Same priority in the order added")
+        {
+                channel first(mux, clock.get(), 1, 0, 0);
+                auto removed = std::make_unique<channel>(mux, clock.get(), 1,
+                                                         0, 0);
+                channel second(mux, clock.get(), 1, 0, 0);
+
+                first.send(1, 100);
+                removed->send(1, 100);
+                second.send(1, 100);
+
+                removed.reset();
+
+                /* Room for one SDU, with a byte of header */
+                REQUIRE(::rlc_lcp_grant(&mux.mux, 101) == 0);
+                REQUIRE(first.used() == 101);
+                REQUIRE(second.used() == 0);
+
+                REQUIRE(::rlc_lcp_grant(&mux.mux, 101) == 0);
+                REQUIRE(second.used() == 101);
+        }
+
+        SECTION("Nothing pending")
+        {
+                channel chan(mux, clock.get(), 1, 1000, 1000000);
+
+                ::rlc_lcp_tick(&mux.mux, 100000);
+
+                REQUIRE(::rlc_lcp_grant(&mux.mux, 500) == 500);
+                REQUIRE(chan.used() == 0);
+                REQUIRE(chan.lcp.bucket == 100);
+        }
+}
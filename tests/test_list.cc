@@ -1,4 +1,5 @@
 
+#include <algorithm>
 #include <vector>
 #include <sstream>
 
@@ -242,3 +243,170 @@ TEST_CASE("list iterator", "[list]")
                 REQUIRE(::rlc_list_it_eoi(it));
         }
 }
+
+namespace
+{
+
+struct dlist_item {
+        std::uint32_t value;
+        ::rlc_dlist_node node;
+};
+
+dlist_item &dlist_item_from(::rlc_dlist_it it)
+{
+        return *rlc_dlist_it_item(it, dlist_item, node);
+}
+
+/* Values of @p list front to back, checking that the back links agree */
+std::vector<std::uint32_t> dlist_values(::rlc_dlist &list)
+{
+        std::vector<std::uint32_t> values;
+        std::vector<std::uint32_t> reverse;
+        ::rlc_dlist_it it;
+
+        rlc_dlist_foreach(&list, it)
+        {
+                values.push_back(dlist_item_from(it).value);
+        }
+
+        for (auto node = list.tail; node != nullptr; node = node->prev) {
+                reverse.insert(reverse.begin(),
+                               gabs_container_of(node, dlist_item, node)
+                                       ->value);
+        }
+
+        REQUIRE(values == reverse);
+        REQUIRE((list.head == nullptr) == (list.tail == nullptr));
+
+        return values;
+}
+
+}; // namespace
+
+TEST_CASE("dlist", "[list]")
+{
+        std::vector<std::uint32_t> truth;
+        std::vector<dlist_item> storage(10);
+        ::rlc_dlist list;
+
+        ::rlc_dlist_init(&list);
+        REQUIRE(::rlc_dlist_empty(&list));
+        REQUIRE(::rlc_dlist_count(&list) == 0);
+        REQUIRE(dlist_values(list).empty());
+
+        for (std::uint32_t i = 0; i < storage.size(); i++) {
+                storage[i].value = i;
+                ::rlc_dlist_node_init(&storage[i].node);
+                ::rlc_dlist_push_back(&list, &storage[i].node);
+
+                truth.push_back(i);
+        }
+
+        REQUIRE_FALSE(::rlc_dlist_empty(&list));
+        REQUIRE(::rlc_dlist_count(&list) == truth.size());
+        REQUIRE(dlist_values(list) == truth);
+        REQUIRE(list.tail == &storage.back().node);
+
+        SECTION("remove by reference")
+        {
+                ::rlc_dlist_remove(&list, &storage[5].node);
+                truth.erase(truth.begin() + 5);
+                REQUIRE(dlist_values(list) == truth);
+
+                ::rlc_dlist_remove(&list, &storage[0].node);
+                truth.erase(truth.begin());
+                REQUIRE(dlist_values(list) == truth);
+
+                ::rlc_dlist_remove(&list, &storage[9].node);
+                truth.pop_back();
+                REQUIRE(dlist_values(list) == truth);
+                REQUIRE(list.tail == &storage[8].node);
+
+                for (auto value : truth) {
+                        ::rlc_dlist_remove(&list, &storage[value].node);
+                }
+
+                REQUIRE(::rlc_dlist_empty(&list));
+                REQUIRE(::rlc_dlist_count(&list) == 0);
+                REQUIRE(list.tail == nullptr);
+        }
+
+        SECTION("insert")
+        {
+                dlist_item first = {100, {}};
+                dlist_item middle = {101, {}};
+                dlist_item last = {102, {}};
+
+                ::rlc_dlist_insert_after(&list, nullptr, &first.node);
+                ::rlc_dlist_insert_after(&list, &storage[4].node,
+                                         &middle.node);
+                ::rlc_dlist_insert_before(&list, nullptr, &last.node);
+
+                truth.insert(truth.begin(), 100);
+                truth.insert(truth.begin() + 6, 101);
+                truth.push_back(102);
+
+                REQUIRE(dlist_values(list) == truth);
+                REQUIRE(::rlc_dlist_count(&list) == truth.size());
+                REQUIRE(list.head == &first.node);
+                REQUIRE(list.tail == &last.node);
+        }
+
+        SECTION("pop/put front")
+        {
+                ::rlc_dlist_it it = ::rlc_dlist_it_init(&list);
+
+                REQUIRE(::rlc_dlist_it_node(it) == &storage[0].node);
+
+                it = ::rlc_dlist_it_pop(it, nullptr);
+                REQUIRE(::rlc_dlist_it_node(it) == &storage[1].node);
+                REQUIRE(::rlc_dlist_it_node(::rlc_dlist_it_next(it)) ==
+                        &storage[1].node);
+                REQUIRE(list.head == &storage[1].node);
+
+                it = ::rlc_dlist_it_init(&list);
+                it = ::rlc_dlist_it_put_front(it, &storage[0].node);
+                REQUIRE(::rlc_dlist_it_node(it) == &storage[1].node);
+                REQUIRE(::rlc_dlist_it_node(::rlc_dlist_it_next(it)) ==
+                        &storage[2].node);
+                REQUIRE(dlist_values(list) == truth);
+        }
+
+        SECTION("remove while iterating")
+        {
+                ::rlc_dlist_it it;
+
+                /* Remove every odd value, as the SDU queue walks do */
+                rlc_dlist_foreach(&list, it)
+                {
+                        if (dlist_item_from(it).value % 2 != 0) {
+                                it = ::rlc_dlist_it_pop(it, nullptr);
+                        }
+                }
+
+                truth.erase(std::remove_if(truth.begin(), truth.end(),
+                                           [](auto v) { return v % 2 != 0; }),
+                            truth.end());
+
+                REQUIRE(dlist_values(list) == truth);
+                REQUIRE(::rlc_dlist_count(&list) == truth.size());
+                REQUIRE(list.tail == &storage[8].node);
+        }
+
+        SECTION("put back at end")
+        {
+                ::rlc_dlist empty;
+                ::rlc_dlist_it it;
+
+                ::rlc_dlist_init(&empty);
+                it = ::rlc_dlist_it_init(&empty);
+
+                for (auto &item : storage) {
+                        ::rlc_dlist_remove(&list, &item.node);
+                        it = ::rlc_dlist_it_put_back(it, &item.node);
+                }
+
+                REQUIRE(dlist_values(empty) == truth);
+                REQUIRE(::rlc_dlist_empty(&list));
+        }
+}
@@ -0,0 +1,572 @@
+#include <cerrno>
+
+#include <catch2/catch_all.hpp>
+
+#include <rlc/rlc.h>
+
+#include "encode.h"
+#include "entity.hh"
+
+TEST_CASE("TX requests", "[tx]")
+{
+        test::clock clock;
+        test::entity tx(test::um_config(), clock.get());
+
+        SECTION("One request per opportunity")
+        {
+                for (auto i = 0; i < 8; i++) {
+                        REQUIRE(tx.send(100) == 0);
+                }
+
+                REQUIRE(tx.requests == 1);
+
+                /* Room for every SDU, so nothing is left to ask for */
+                REQUIRE(tx.avail(2000).size() == 8);
+                REQUIRE(tx.requests == 1);
+
+                REQUIRE(tx.send(100) == 0);
+                REQUIRE(tx.send(100) == 0);
+                REQUIRE(tx.requests == 2);
+        }
+
+        SECTION("Raised again while data remains")
+        {
+                for (auto i = 0; i < 4; i++) {
+                        REQUIRE(tx.send(100) == 0);
+                }
+
+                REQUIRE(tx.requests == 1);
+
+                for (std::size_t i = 0; i < 3; i++) {
+                        REQUIRE(tx.avail(101).size() == 1);
+                        REQUIRE(tx.requests == 2 + i);
+
+                        /* Already pending */
+                        REQUIRE(tx.send(100) == 0);
+                        REQUIRE(tx.requests == 2 + i);
+                }
+
+                /* Answering with an opportunity too small for anything
+                 * still leaves the data pending */
+                REQUIRE(tx.avail(1).empty());
+                REQUIRE(tx.requests == 5);
+
+                REQUIRE(tx.avail(2000).size() == 4);
+                REQUIRE(tx.requests == 5);
+        }
+
+        SECTION("Left to the caller when building")
+        {
+                for (auto i = 0; i < 4; i++) {
+                        REQUIRE(tx.send(100) == 0);
+                }
+
+                REQUIRE(tx.requests == 1);
+
+                REQUIRE(tx.build(101).size() == 1);
+                REQUIRE(tx.pending);
+                REQUIRE(tx.requests == 1);
+
+                /* The opportunity answered the request */
+                REQUIRE(tx.send(100) == 0);
+                REQUIRE(tx.requests == 2);
+
+                REQUIRE(tx.build(2000).size() == 4);
+                REQUIRE(!tx.pending);
+                REQUIRE(tx.requests == 2);
+        }
+
+        SECTION("Retried after a failed request")
+        {
+                tx.request_status = -EAGAIN;
+
+                REQUIRE(tx.send(100) == 0);
+                REQUIRE(tx.requests == 1);
+
+                /* Nothing will answer the failed request */
+                REQUIRE(tx.send(100) == 0);
+                REQUIRE(tx.requests == 2);
+
+                tx.request_status = 0;
+
+                REQUIRE(tx.send(100) == 0);
+                REQUIRE(tx.send(100) == 0);
+                REQUIRE(tx.requests == 3);
+        }
+}
+
+TEST_CASE("Building PDUs into caller memory", "[tx]")
+{
+        test::clock clock;
+        test::entity tx(test::am_config(), clock.get());
+        test::entity rx(test::am_config(), clock.get());
+
+        for (auto i = 0; i < 3; i++) {
+                REQUIRE(tx.send(100) == 0);
+        }
+
+        SECTION("Written PDUs decode")
+        {
+                auto pdus = tx.build(1000);
+
+                REQUIRE(pdus.size() == 3);
+
+                for (std::size_t i = 0; i < pdus.size(); i++) {
+                        ::rlc_pdu pdu;
+
+                        /* Two bytes of header with 12 bit SNs */
+                        REQUIRE(pdus[i].size() == 102);
+
+                        auto buf = ::gabs_pbuf_new(alloc, pdus[i].size());
+                        ::gabs_pbuf_put(&buf, pdus[i].data(), pdus[i].size());
+
+                        REQUIRE(::rlc_pdu_decode(rx.context(), &pdu, &buf) ==
+                                0);
+                        REQUIRE(pdu.sn == i);
+                        REQUIRE(pdu.flags.is_first);
+                        REQUIRE(pdu.flags.is_last);
+                        REQUIRE(!pdu.flags.is_status);
+
+                        /* Polled as the buffer is empty after the last */
+                        REQUIRE(pdu.flags.polled == (i == 2));
+                }
+
+                rx.receive(pdus);
+
+                REQUIRE(rx.delivered.size() == 3);
+
+                for (std::size_t i = 0; i < 3; i++) {
+                        REQUIRE(rx.delivered[i] ==
+                                test::pdu(100, static_cast<std::uint8_t>(i)));
+                }
+
+                REQUIRE(tx.buffer_status().new_bytes == 0);
+        }
+
+        SECTION("Full target")
+        {
+                std::vector<test::pdu> pdus;
+
+                /* No room for more PDUs */
+                pdus = tx.build(1000, 1);
+                REQUIRE(pdus.size() == 1);
+                REQUIRE(tx.buffer_status().new_bytes == 200);
+
+                /* No room for a header */
+                REQUIRE(tx.build(2).empty());
+                REQUIRE(tx.buffer_status().new_bytes == 200);
+
+                /* No room for the whole SDU */
+                auto segment = tx.build(50);
+                REQUIRE(segment.size() == 1);
+                REQUIRE(segment[0].size() == 50);
+                REQUIRE(tx.buffer_status().new_bytes == 152);
+                pdus.push_back(segment[0]);
+
+                auto rest = tx.build(1000);
+                REQUIRE(rest.size() == 2);
+                pdus.insert(pdus.end(), rest.begin(), rest.end());
+
+                rx.receive(pdus);
+
+                /* Every byte marked as sent was written */
+                REQUIRE(rx.delivered.size() == 3);
+
+                for (std::size_t i = 0; i < 3; i++) {
+                        REQUIRE(rx.delivered[i] ==
+                                test::pdu(100, static_cast<std::uint8_t>(i)));
+                }
+        }
+
+        SECTION("Status and poll in one opportunity")
+        {
+                auto pdus = tx.build(1000);
+
+                REQUIRE(pdus.size() == 3);
+
+                /* The other direction has data as well, with a poll that
+                 * calls for a status PDU */
+                REQUIRE(rx.send(100) == 0);
+                tx.receive(rx.build(1000));
+
+                /* Data lost, and the poll due again */
+                clock.advance(test::am_config().time_poll_retransmit_us);
+
+                /* Room for the status PDU, and part of an SDU */
+                pdus = tx.build(30);
+                REQUIRE(pdus.size() == 2);
+                REQUIRE((pdus[0][0] & 0x80) == 0);
+                REQUIRE((pdus[1][0] & 0xc0) == 0xc0);
+                REQUIRE(pdus[0].size() + pdus[1].size() <= 30);
+        }
+}
+
+TEST_CASE("Building a status PDU", "[tx]")
+{
+        test::clock clock;
+        auto conf = test::am_config();
+        test::entity tx(conf, clock.get());
+        test::entity rx(conf, clock.get());
+        ::rlc_mem_stats stats;
+
+        for (auto i = 0; i < 3; i++) {
+                REQUIRE(tx.send(100) == 0);
+        }
+
+        /* The second SDU is lost */
+        auto pdus = tx.build(1000);
+        REQUIRE(pdus.size() == 3);
+        rx.receive(pdus[0]);
+        rx.receive(pdus[2]);
+
+        clock.advance(conf.time_reassembly_us);
+        ::rlc_mem_usage(rx.context(), &stats, true);
+
+        auto status = rx.build(1000);
+        REQUIRE(status.size() == 1);
+
+        /* Header and NACK of SN 1 */
+        REQUIRE(status[0] == test::pdu{0x00, 0x03, 0x80, 0x00, 0x10});
+        REQUIRE(!rx.pending);
+
+        /* Neither a buffer nor a backend call was needed */
+        ::rlc_mem_usage(rx.context(), &stats, false);
+        REQUIRE(stats.kind[::RLC_MEM_OFFLOAD].peak_count == 0);
+        REQUIRE(stats.kind[::RLC_MEM_HEADER].peak_count == 0);
+
+        tx.receive(status);
+        REQUIRE(tx.buffer_status().retx_bytes == 100);
+}
+
+TEST_CASE("Acknowledged after a retransmission", "[tx]")
+{
+        test::clock clock;
+        auto conf = test::am_config();
+        test::entity tx(conf, clock.get());
+        test::entity rx(conf, clock.get());
+
+        REQUIRE(tx.send(300) == 0);
+
+        /* The first segment is lost */
+        REQUIRE(tx.build(150).size() == 1);
+        rx.receive(tx.build(1000));
+
+        clock.advance(conf.time_reassembly_us);
+        tx.receive(rx.build(1000));
+        REQUIRE(tx.buffer_status().retx_bytes == 148);
+
+        /* Not the end of the SDU, but nothing is left to send */
+        rx.receive(tx.build(1000));
+        REQUIRE(rx.delivered.size() == 1);
+
+        clock.advance(conf.time_status_prohibit_us);
+        tx.receive(rx.build(1000));
+
+        REQUIRE(tx.released.size() == 1);
+        REQUIRE(tx.buffer_status().queued_sdus == 0);
+}
+
+TEST_CASE("Stalled TX window", "[tx]")
+{
+        test::clock clock;
+        auto conf = test::am_config();
+        conf.window_size = 2;
+
+        test::entity tx(conf, clock.get());
+        test::entity rx(conf, clock.get());
+        ::rlc_sdu *last;
+
+        REQUIRE(tx.send(100) == 0);
+        REQUIRE(tx.send(100) == 0);
+        REQUIRE(tx.send(100, &last) == 0);
+
+        /* The last PDU before the stall is polled */
+        auto pdus = tx.build(1000);
+        REQUIRE(pdus.size() == 2);
+        REQUIRE(!tx.pending);
+        REQUIRE(last->sn == RLC_SN_NONE);
+
+        rx.receive(pdus);
+        tx.receive(rx.build(1000));
+
+        pdus = tx.build(1000);
+        REQUIRE(pdus.size() == 1);
+        REQUIRE(last->sn == 2);
+
+        rx.receive(pdus);
+        REQUIRE(rx.delivered.size() == 3);
+
+        ::rlc_sdu_decref(last);
+}
+
+TEST_CASE("Queue management", "[tx]")
+{
+        test::clock clock;
+        auto conf = test::am_config();
+        conf.aqm_target_us = 1000;
+        conf.aqm_interval_us = 10000;
+        conf.aqm_action = ::RLC_AQM_MARK;
+
+        test::entity tx(conf, clock.get());
+        ::rlc_tx_aqm_stats stats;
+
+        for (auto i = 0; i < 3; i++) {
+                REQUIRE(tx.send(100) == 0);
+        }
+
+        clock.advance(conf.aqm_target_us);
+
+        /* Opportunities too small for a PDU leave the SDUs alone */
+        for (auto i = 0; i < 3; i++) {
+                REQUIRE(tx.build(2).empty());
+                clock.advance(conf.aqm_interval_us);
+        }
+
+        ::rlc_tx_aqm_stats_get(tx.context(), &stats);
+        REQUIRE(stats.marked == 0);
+
+        /* Above target for an interval once served */
+        REQUIRE(tx.build(1000, 1).size() == 1);
+        clock.advance(conf.aqm_interval_us);
+        REQUIRE(tx.build(1000, 1).size() == 1);
+
+        ::rlc_tx_aqm_stats_get(tx.context(), &stats);
+        REQUIRE(stats.marked == 1);
+}
+
+TEST_CASE("Lost PDUs", "[tx]")
+{
+        test::clock clock;
+        test::entity tx(test::am_config(), clock.get());
+        test::entity rx(test::am_config(), clock.get());
+
+        SECTION("Segment past 16 bit offsets")
+        {
+                ::rlc_pdu pdu;
+
+                REQUIRE(tx.send(70000) == 0);
+
+                /* Two bytes of header, then four with the SO */
+                REQUIRE(tx.build(65537).size() == 1);
+                REQUIRE(tx.build(14).size() == 1);
+
+                REQUIRE(::rlc_tx_lost(tx.context(), tx.handles[0]) == 0);
+                REQUIRE(tx.buffer_status().retx_bytes == 10);
+
+                auto retx = tx.build(14);
+                REQUIRE(retx.size() == 1);
+                REQUIRE(retx[0].size() == 14);
+
+                auto buf = ::gabs_pbuf_new(alloc, retx[0].size());
+                ::gabs_pbuf_put(&buf, retx[0].data(), retx[0].size());
+
+                REQUIRE(::rlc_pdu_decode(rx.context(), &pdu, &buf) == 0);
+                REQUIRE(pdu.seg_offset == 65535);
+                REQUIRE(::gabs_pbuf_size(buf) == 10);
+                ::gabs_pbuf_decref(buf);
+        }
+
+        SECTION("Offsets that do not fit a handle")
+        {
+                REQUIRE(tx.send((1 << 20) + 1) == 0);
+                REQUIRE(tx.build((1 << 20) + 3).size() == 1);
+
+                REQUIRE(::rlc_tx_lost(tx.context(), tx.handles[0]) ==
+                        -EINVAL);
+                REQUIRE(tx.buffer_status().retx_bytes == 0);
+        }
+}
+
+TEST_CASE("Discard", "[tx]")
+{
+        constexpr int discarded =
+                decltype(::rlc_event::tx_release)::RLC_TX_RELEASE_DISCARD;
+        using released = std::vector<std::pair<std::uint32_t, int>>;
+
+        test::clock clock;
+        auto conf = test::am_config();
+        conf.discard_timer_us = 100000;
+
+        test::entity tx(conf, clock.get());
+        test::entity rx(conf, clock.get());
+
+        SECTION("Expired SDUs take no SN")
+        {
+                ::rlc_sdu *sdu;
+
+                for (auto i = 0; i < 3; i++) {
+                        REQUIRE(tx.send(100) == 0);
+                }
+
+                auto pdus = tx.build(1000, 1);
+                REQUIRE(pdus.size() == 1);
+
+                clock.advance(conf.discard_timer_us);
+
+                /* Takes the SN after the first SDU once submitted */
+                REQUIRE(tx.send(100, &sdu) == 0);
+                REQUIRE(sdu->sn == RLC_SN_NONE);
+                REQUIRE(tx.released == released{{RLC_SN_NONE, discarded},
+                                                {RLC_SN_NONE, discarded}});
+
+                auto rest = tx.build(1000);
+                REQUIRE(rest.size() == 1);
+                REQUIRE(sdu->sn == 1);
+                ::rlc_sdu_decref(sdu);
+                pdus.insert(pdus.end(), rest.begin(), rest.end());
+
+                /* No gap is seen by the peer */
+                rx.receive(pdus);
+                REQUIRE(rx.delivered ==
+                        std::vector<test::pdu>{test::pdu(100, 0),
+                                               test::pdu(100, 3)});
+        }
+
+        SECTION("Submitted SDUs are kept")
+        {
+                ::rlc_sdu *first;
+                ::rlc_sdu *last;
+
+                REQUIRE(tx.send(300, &first) == 0);
+                REQUIRE(tx.send(100) == 0);
+
+                auto pdus = tx.build(150);
+                REQUIRE(pdus.size() == 1);
+
+                clock.advance(conf.discard_timer_us);
+
+                REQUIRE(tx.send(100, &last) == 0);
+                REQUIRE(tx.released == released{{RLC_SN_NONE, discarded}});
+
+                REQUIRE(::rlc_tx_discard(tx.context(), first) == -EBUSY);
+
+                auto rest = tx.build(1000);
+                pdus.insert(pdus.end(), rest.begin(), rest.end());
+                REQUIRE(first->sn == 0);
+                REQUIRE(last->sn == 1);
+
+                rx.receive(pdus);
+                REQUIRE(rx.delivered ==
+                        std::vector<test::pdu>{test::pdu(300, 0),
+                                               test::pdu(100, 2)});
+
+                ::rlc_sdu_decref(first);
+                ::rlc_sdu_decref(last);
+        }
+
+        SECTION("Discarded on request")
+        {
+                ::rlc_sdu *sdus[4];
+
+                for (auto &sdu : sdus) {
+                        REQUIRE(tx.send(100, &sdu) == 0);
+                }
+
+                auto pdus = tx.build(1000, 1);
+                REQUIRE(pdus.size() == 1);
+
+                REQUIRE(::rlc_tx_discard(tx.context(), sdus[2]) == 0);
+                REQUIRE(tx.released == released{{RLC_SN_NONE, discarded}});
+
+                REQUIRE(::rlc_tx_discard(tx.context(), sdus[2]) == -ENOENT);
+                REQUIRE(::rlc_tx_discard(tx.context(), sdus[0]) == -EBUSY);
+
+                auto rest = tx.build(1000);
+                pdus.insert(pdus.end(), rest.begin(), rest.end());
+                REQUIRE(sdus[1]->sn == 1);
+                REQUIRE(sdus[3]->sn == 2);
+
+                rx.receive(pdus);
+                REQUIRE(rx.delivered ==
+                        std::vector<test::pdu>{test::pdu(100, 0),
+                                               test::pdu(100, 1),
+                                               test::pdu(100, 3)});
+
+                for (auto sdu : sdus) {
+                        ::rlc_sdu_decref(sdu);
+                }
+        }
+
+        SECTION("Empty SDUs are rejected")
+        {
+                ::rlc_sdu *sdu;
+
+                REQUIRE(tx.send(0) == -ENODATA);
+                REQUIRE(tx.send(100, &sdu) == 0);
+                REQUIRE(sdu->sn == RLC_SN_NONE);
+                REQUIRE(tx.buffer_status().queued_sdus == 1);
+
+                ::rlc_sdu_decref(sdu);
+        }
+}
+
+TEST_CASE("Requests on status PDUs", "[tx]")
+{
+        test::clock clock;
+        auto conf = test::am_config();
+        test::entity tx(conf, clock.get());
+        test::entity rx(conf, clock.get());
+        std::size_t requests;
+
+        SECTION("Acknowledgement only")
+        {
+                REQUIRE(tx.send(100) == 0);
+                rx.receive(tx.build(1000));
+
+                requests = tx.requests;
+                tx.receive(rx.build(1000));
+
+                REQUIRE(tx.released.size() == 1);
+                REQUIRE(tx.requests == requests);
+        }
+
+        SECTION("Retransmission")
+        {
+                REQUIRE(tx.send(100) == 0);
+                REQUIRE(tx.send(100) == 0);
+
+                /* The first SDU is lost */
+                REQUIRE(tx.build(1000, 1).size() == 1);
+                rx.receive(tx.build(1000));
+
+                clock.advance(conf.time_reassembly_us);
+
+                requests = tx.requests;
+                tx.receive(rx.build(1000));
+
+                REQUIRE(tx.buffer_status().retx_bytes == 100);
+                REQUIRE(tx.requests == requests + 1);
+        }
+}
+
+TEST_CASE("Unacknowledged SDUs", "[tx]")
+{
+        constexpr int done =
+                decltype(::rlc_event::tx_release)::RLC_TX_RELEASE_DONE;
+
+        test::clock clock;
+        test::entity tx(test::um_config(), clock.get());
+
+        for (auto i = 0; i < 4; i++) {
+                REQUIRE(tx.send(100 + i) == 0);
+        }
+
+        /* Each SDU is released as soon as it is served, while the rest of
+         * the queue is still walked */
+        SECTION("Submitted")
+        {
+                REQUIRE(tx.avail(2000).size() == 4);
+        }
+
+        SECTION("Built")
+        {
+                REQUIRE(tx.build(2000).size() == 4);
+        }
+
+        REQUIRE(tx.released.size() == 4);
+        for (const auto &item : tx.released) {
+                REQUIRE(item.second == done);
+        }
+
+        REQUIRE(tx.buffer_status().new_bytes == 0);
+}
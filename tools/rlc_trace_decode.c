@@ -0,0 +1,64 @@
+
+/*
+ * Print trace records dumped from `rlc_trace_read` as text.
+ *
+ * The input is a sequence of raw `struct rlc_trace_record`, as written by the
+ * same build of the library, read from a file or standard input.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <rlc/trace.h>
+
+static int decode(FILE *in)
+{
+        struct rlc_trace_record record;
+        char line[256];
+        size_t ret;
+
+        while ((ret = fread(&record, 1, sizeof(record), in)) ==
+               sizeof(record)) {
+                (void)rlc_trace_format(&record, line, sizeof(line));
+                (void)puts(line);
+        }
+
+        if (ferror(in)) {
+                perror("read");
+                return 1;
+        }
+
+        if (ret != 0) {
+                (void)fprintf(stderr, "Trailing %zu bytes ignored\n", ret);
+        }
+
+        return 0;
+}
+
+int main(int argc, char **argv)
+{
+        FILE *in;
+        int status;
+
+        if (argc > 2) {
+                (void)fprintf(stderr, "Usage: %s [FILE]\n", argv[0]);
+                return 2;
+        }
+
+        if (argc < 2 || strcmp(argv[1], "-") == 0) {
+                return decode(stdin);
+        }
+
+        in = fopen(argv[1], "rb");
+        if (in == NULL) {
+                (void)fprintf(stderr, "%s: %s\n", argv[1], strerror(errno));
+                return 1;
+        }
+
+        status = decode(in);
+
+        (void)fclose(in);
+
+        return status;
+}